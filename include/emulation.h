@@ -24,14 +24,60 @@
 #define __EMULATION_H__
 
 #include <stdlib.h>
+#include "vgascreen.h"
+#include "vgaring.h"
 #include "vgatext.h"
 #include "vgaterm.h"
 
+typedef struct _EmuData EmuData;
+typedef struct _VGARecorder VGARecorder;
+typedef void (*EmuSyncFunc) (EmuData * emu, gpointer user_data);
+typedef void (*EmuMorphFunc) (EmuData * emu, gpointer user_data);
 
+/* Flags for vga_term_emu_attach_fd_full() */
+typedef enum
+{
+	VGA_EMU_FD_MMAP = 1 << 0,	/* Map regular files instead of reading */
+	VGA_EMU_FD_CLOSE = 1 << 1,	/* Close the fd when detaching */
+	VGA_EMU_FD_SAUCE = 1 << 2	/* Art file: apply SAUCE, stop before it */
+} VGAEmuFdFlags;
+
+typedef void (*VGAEmuEofFunc) (GtkWidget * widget, gpointer user_data);
+
+/* Emulator state machine, working on a VGAScreen */
+EmuData * vga_emu_new(VGAScreen * scr);
+void vga_emu_destroy(EmuData * emu);
+void vga_emu_reset(EmuData * emu);
+void vga_emu_copy_state(EmuData * emu, EmuData * src);
+VGAScreen * vga_emu_get_screen(EmuData * emu);
+void vga_emu_set_sync_func(EmuData * emu, EmuSyncFunc func,
+		gpointer user_data);
+void vga_emu_set_morph_func(EmuData * emu, EmuMorphFunc func,
+		gpointer user_data);
+gboolean vga_emu_morph_step(EmuData * emu);
+void vga_emu_morph_finish(EmuData * emu);
+gboolean vga_emu_morph_pending(EmuData * emu);
+void vga_emu_writec(EmuData * emu, guchar c);
+void vga_emu_write(EmuData * emu, const guchar * buf, gsize len);
+void vga_emu_set_recorder(EmuData * emu, VGARecorder * rec);
+
+/* VGATerm widget methods */
 void vga_term_emu_init(GtkWidget * widget);
+EmuData * vga_term_emu_get_data(GtkWidget * widget);
 void vga_term_emu_writec(GtkWidget * widget, guchar c);
 void vga_term_emu_write(GtkWidget * widget, gchar * s);
+void vga_term_emu_writeln(GtkWidget * widget, gchar * s);
 int vga_term_emu_print(GtkWidget * widget, const gchar * format, ...);
+VGARing * vga_term_emu_attach_ring(GtkWidget * widget, gsize size);
+gboolean vga_term_emu_attach_fd(GtkWidget * widget, int fd);
+gboolean vga_term_emu_attach_fd_full(GtkWidget * widget, int fd,
+		VGAEmuFdFlags flags, VGAEmuEofFunc eof_func,
+		gpointer user_data);
+void vga_term_emu_detach_fd(GtkWidget * widget);
+void vga_term_emu_set_streaming(GtkWidget * widget, gboolean streaming);
+void vga_term_emu_set_budget(GtkWidget * widget, guint usec);
+void vga_term_emu_flush(GtkWidget * widget);
+gsize vga_term_emu_pending(GtkWidget * widget);
 gchar * vga_term_emu_vtkey(GtkWidget * widget, guchar c);
 
 #endif	/* __EMULATION_H__ */
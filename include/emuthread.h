@@ -0,0 +1,46 @@
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of version 2 of the GNU General Public License as
+ *  published by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ *****************************************************************************
+ *
+ *  Run the terminal emulator for a VGATerm on a worker thread.
+ *
+ *  Bytes written with vga_emu_thread_write() (from any thread) are parsed
+ *  on the worker into a private VGAScreen.  Whenever the worker catches up,
+ *  or at most every frame while it is flooded, it publishes a copy of that
+ *  screen to the main loop without taking any locks.  The main loop only
+ *  ever draws the newest published frame, so a slow display simply skips
+ *  frames rather than holding up the reader.
+ *
+ *  Don't use the vga_term_emu_* functions on a terminal that has a worker.
+ */
+
+#ifndef __EMU_THREAD_H__
+#define __EMU_THREAD_H__
+
+#include "vgaterm.h"
+#include "emulation.h"
+
+G_BEGIN_DECLS
+
+typedef struct _VGAEmuThread VGAEmuThread;
+
+VGAEmuThread *	vga_emu_thread_new	(GtkWidget * term);
+void		vga_emu_thread_write	(VGAEmuThread * et, const guchar * buf,
+						gsize len);
+void		vga_emu_thread_destroy	(VGAEmuThread * et);
+
+G_END_DECLS
+
+#endif	/* __EMU_THREAD_H__ */
@@ -0,0 +1,64 @@
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of version 2 of the GNU General Public License as
+ *  published by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ *****************************************************************************
+ *
+ *  Screen diffs.  A VGADiff remembers what a remote terminal is showing
+ *  and turns a new screen into the shortest byte stream it can find that
+ *  makes the remote terminal show that instead: only changed cells are
+ *  sent, the cheapest cursor movement is picked for each jump, attribute
+ *  changes are kept to a minimum, and runs of the same cell use the
+ *  dialect's repeat command if it has one.
+ *
+ *  The remote terminal is assumed to have a full-screen window of the
+ *  same size.  Its bottom right cell is never written, since that would
+ *  scroll most terminals.  Control characters that a terminal would act
+ *  on can't be sent; NULs are sent as spaces and the others as '?'.
+ */
+
+#ifndef __VGA_DIFF_H__
+#define __VGA_DIFF_H__
+
+#include "vgascreen.h"
+
+G_BEGIN_DECLS
+
+typedef enum
+{
+	VGA_DIFF_ANSI,		/* ANSI.SYS */
+	VGA_DIFF_AVATAR,	/* Avatar/0 */
+	VGA_DIFF_TEXTFX		/* TextFX, as understood by libvga */
+} VGADiffDialect;
+
+typedef struct _VGADiff VGADiff;
+
+VGADiff *	vga_diff_new		(VGADiffDialect dialect, int rows,
+						int cols);
+void		vga_diff_destroy	(VGADiff * diff);
+void		vga_diff_set_repeat	(VGADiff * diff, gboolean repeat);
+void		vga_diff_invalidate	(VGADiff * diff);
+gsize		vga_diff_update		(VGADiff * diff, GByteArray * out,
+						const vga_charcell * buf,
+						int cursor_x, int cursor_y);
+gsize		vga_diff_update_screen	(VGADiff * diff, GByteArray * out,
+						VGAScreen * scr);
+gsize		vga_diff_buffers	(VGADiffDialect dialect,
+						GByteArray * out,
+						const vga_charcell * from,
+						const vga_charcell * to,
+						int rows, int cols);
+
+G_END_DECLS
+
+#endif	/* __VGA_DIFF_H__ */
@@ -16,23 +16,61 @@
  *
  */
 
+#ifndef __VGA_FONT_H__
+#define __VGA_FONT_H__
+
 #include <stdio.h>
 #include <gtk/gtk.h>
 
 #include <gtk/gtk.h>
 #include <string.h>
 
+typedef enum
+{
+	FONT_DEFAULT, FONT_DEFAULT_8X8
+} StockFont;
+
 typedef struct _VGAFont	VGAFont;
 typedef struct _RenderedChar	RenderedChar;
 
+/*
+ * Fonts are reference counted and shared, between screens and between the
+ * widgets showing them, along with the bitmaps rendered from them.  Only a
+ * font nothing else holds may be changed; vga_font_dup() one that isn't.
+ */
 struct _VGAFont
 {
 	int width, height;		/* Pixel sizes, usually 8x16 */
 	guchar * data;
+
+	/* Private */
+	gint ref_count;
+	gboolean stock;			/* data is built in; never changed */
+	gpointer owner;			/* Holds data for us, or NULL */
+	GDestroyNotify owner_release;	/* Called on owner when we go */
+	GSList * bitmaps;		/* Rendered, one per display */
+
+	/* Render formats, derived from data whenever it changes */
+	guint serial;			/* Changes with data */
+	guint compiled_serial;		/* What the formats were made from */
+	guchar * xbm;			/* data, each row mirrored for XBM */
+	guchar * coverage;		/* A byte per pixel, 0 or 0xFF */
 };
 
+/* Each row byte of a glyph as 8 coverage bytes, leftmost pixel first */
+extern const guchar vga_font_row_expand[256][8];
+
 VGAFont	*	vga_font_new		(void);
+VGAFont *	vga_font_stock		(StockFont id);
+VGAFont *	vga_font_ref		(VGAFont * font);
 void		vga_font_destroy	(VGAFont * font);
+VGAFont *	vga_font_dup		(VGAFont * font);
+VGAFont *	vga_font_new_borrowed	(const guchar * data, int width,
+						int height, gpointer owner,
+						GDestroyNotify release);
+gboolean	vga_font_is_writable	(VGAFont * font);
+const guchar *	vga_font_get_xbm	(VGAFont * font);
+const guchar *	vga_font_get_coverage	(VGAFont * font);
 gboolean	vga_font_set_chars	(VGAFont * font, guchar * data,
 						guchar start_c, guchar end_c);
 gboolean	vga_font_load		(VGAFont * font, guchar * data,
@@ -42,3 +80,7 @@ void		vga_font_load_default	(VGAFont * font);
 void		vga_font_load_default_8x8(VGAFont * font);
 int		vga_font_pixels		(VGAFont * font);
 GdkBitmap *	vga_font_get_bitmap	(VGAFont * font, GdkWindow * win);
+GdkBitmap *	vga_font_get_scaled_bitmap(VGAFont * font, GdkWindow * win,
+						int scale);
+
+#endif	/* __VGA_FONT_H__ */
@@ -0,0 +1,63 @@
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of version 2 of the GNU General Public License as
+ *  published by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ *****************************************************************************
+ *
+ *  Font packs.  One file holds any number of fonts, with an index by name
+ *  and by a hash of the font data.  A pack is read through a memory map,
+ *  and each font is only made into a VGAFont when it is first asked for;
+ *  its data stays in the map, so switching between a pack's fonts copies
+ *  nothing.
+ */
+
+#ifndef __VGA_FONT_PACK_H__
+#define __VGA_FONT_PACK_H__
+
+#include "vgafont.h"
+
+G_BEGIN_DECLS
+
+#define VGA_FONT_PACK_ERROR	vga_font_pack_error_quark()
+#define VGA_FONT_PACK_NAME_MAX	31	/* Longest font name, in bytes */
+
+typedef enum
+{
+	VGA_FONT_PACK_ERROR_FORMAT,	/* Not a font pack, or damaged */
+	VGA_FONT_PACK_ERROR_FONT,	/* A font can't be put in a pack */
+	VGA_FONT_PACK_ERROR_IO		/* Couldn't write the file */
+} VGAFontPackError;
+
+typedef struct _VGAFontPack VGAFontPack;
+
+GQuark		vga_font_pack_error_quark(void);
+guint32		vga_font_pack_hash	(const guchar * data, gsize len);
+
+VGAFontPack *	vga_font_pack_open	(const gchar * filename,
+						GError ** error);
+void		vga_font_pack_close	(VGAFontPack * pack);
+guint		vga_font_pack_count	(VGAFontPack * pack);
+const gchar *	vga_font_pack_name	(VGAFontPack * pack, guint i);
+VGAFont *	vga_font_pack_get	(VGAFontPack * pack, guint i);
+VGAFont *	vga_font_pack_lookup	(VGAFontPack * pack,
+						const gchar * name);
+VGAFont *	vga_font_pack_lookup_hash(VGAFontPack * pack, guint32 hash);
+
+gboolean	vga_font_pack_write	(const gchar * filename,
+						const gchar * const * names,
+						VGAFont ** fonts, guint n,
+						GError ** error);
+
+G_END_DECLS
+
+#endif	/* __VGA_FONT_PACK_H__ */
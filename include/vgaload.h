@@ -0,0 +1,57 @@
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of version 2 of the GNU General Public License as
+ *  published by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ *****************************************************************************
+ *
+ *  Loading font and palette files without blocking the main loop.  The
+ *  file is read, checked and converted to the forms it is drawn from on a
+ *  worker thread, and the finished object is handed to a callback on the
+ *  main loop.  Everything here is called from the main loop.
+ */
+
+#ifndef __VGA_LOAD_H__
+#define __VGA_LOAD_H__
+
+#include "vgafont.h"
+#include "vgapalette.h"
+
+G_BEGIN_DECLS
+
+#define VGA_LOAD_ERROR		vga_load_error_quark()
+
+typedef enum
+{
+	VGA_LOAD_ERROR_FAILED		/* Unreadable, or not a font/palette */
+} VGALoadError;
+
+typedef struct _VGALoad VGALoad;
+
+/* The object is the callee's; it is NULL, and @error set, on failure */
+typedef void (*VGAFontLoadFunc) (VGAFont * font, const GError * error,
+					gpointer user_data);
+typedef void (*VGAPaletteLoadFunc) (VGAPalette * pal, const GError * error,
+					gpointer user_data);
+
+GQuark		vga_load_error_quark	(void);
+VGALoad *	vga_font_load_async	(const gchar * fname,
+						VGAFontLoadFunc func,
+						gpointer user_data);
+VGALoad *	vga_palette_load_async	(const gchar * fname,
+						VGAPaletteLoadFunc func,
+						gpointer user_data);
+void		vga_load_cancel		(VGALoad * load);
+
+G_END_DECLS
+
+#endif	/* __VGA_LOAD_H__ */
@@ -31,6 +31,7 @@
 
 #define PAL_REGS	256
 #define TO_GDK_RGB(vga_rgb)     (guint16) floor((vga_rgb * 1040.23809) + 0.5)
+#define FROM_GDK_RGB(gdk_rgb)	(guchar) (((guint32) (gdk_rgb) * 63 + 32767) / 65535)
 
 typedef enum
 {
@@ -39,13 +40,23 @@ typedef enum
 
 typedef struct _VGAPalette VGAPalette;
 
+/* The palette registers used for the 16 text attribute colors */
+extern const guchar vga_palette_text_regs[16];
+
 /* 
  * The VGA Palette structure here contains 256 registers.  However, only
  * only 64 of them are commonly used in VGA applications.
+ *
+ * vga[] holds the registers as the 6-bit DAC sees them, packed r, g, b,
+ * and is what the palette functions work on.  color[] and rgb[] (packed
+ * 8-bit) are the same registers converted, and are kept in step with it,
+ * so change registers only through the functions below.
  */
 struct _VGAPalette
 {
 	GdkColor color[PAL_REGS];
+	guchar vga[PAL_REGS * 3];
+	guchar rgb[PAL_REGS * 3];
 };
 
 
@@ -0,0 +1,64 @@
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of version 2 of the GNU General Public License as
+ *  published by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ *****************************************************************************
+ *
+ *  Play back ANSI art or a captured session on a VGATerm at a given speed.
+ *
+ *  A single frame clock drives playback: each tick parses just the bytes
+ *  that are due by then and draws once.  ANSI animations were made to be
+ *  watched at modem speed, so the rate is in characters per second; use
+ *  VGA_PLAYBACK_BAUD() to convert from a modem speed.
+ *
+ *  The playback uses the terminal's emulator (see vga_term_emu_init()), so
+ *  nothing else should write to the terminal while it is attached.
+ */
+
+#ifndef __VGA_PLAYBACK_H__
+#define __VGA_PLAYBACK_H__
+
+#include "vgaterm.h"
+#include "emulation.h"
+
+G_BEGIN_DECLS
+
+/* 8N1: ten bits on the wire per character */
+#define VGA_PLAYBACK_BAUD(bps)		((bps) / 10)
+#define VGA_PLAYBACK_UNLIMITED		0
+
+typedef struct _VGAPlayback VGAPlayback;
+typedef void (*VGAPlaybackFunc) (VGAPlayback * pb, gpointer user_data);
+
+VGAPlayback *	vga_playback_new	(GtkWidget * term, const guchar * data,
+						gsize len,
+						GDestroyNotify free_func);
+void		vga_playback_destroy	(VGAPlayback * pb);
+void		vga_playback_set_done_func(VGAPlayback * pb,
+						VGAPlaybackFunc func,
+						gpointer user_data);
+
+void		vga_playback_play	(VGAPlayback * pb);
+void		vga_playback_pause	(VGAPlayback * pb);
+gboolean	vga_playback_is_playing	(VGAPlayback * pb);
+void		vga_playback_set_rate	(VGAPlayback * pb, guint cps);
+guint		vga_playback_get_rate	(VGAPlayback * pb);
+void		vga_playback_seek	(VGAPlayback * pb, gsize pos);
+void		vga_playback_set_keyframe_interval(VGAPlayback * pb,
+						gsize bytes);
+gsize		vga_playback_get_position(VGAPlayback * pb);
+gsize		vga_playback_get_length	(VGAPlayback * pb);
+
+G_END_DECLS
+
+#endif	/* __VGA_PLAYBACK_H__ */
@@ -0,0 +1,62 @@
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of version 2 of the GNU General Public License as
+ *  published by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ *****************************************************************************
+ *
+ *  Headless rendering of a VGAScreen to 24-bit RGB, without a display or
+ *  any GTK+ calls.  Pixels come out the way VGAText draws them, with
+ *  blinking characters shown in their "on" state.  Nothing is cached
+ *  that depends on the screen's contents, so one VGARaster can render
+ *  any number of screens; it is not locked, so use one per thread.
+ *
+ *  Screens are rendered a text row at a time, so saving a PNG never needs
+ *  memory for more than one row of pixels however tall the screen is.
+ */
+
+#ifndef __VGA_RASTER_H__
+#define __VGA_RASTER_H__
+
+#include "vgascreen.h"
+
+G_BEGIN_DECLS
+
+#define VGA_RASTER_ERROR	vga_raster_error_quark()
+
+typedef enum
+{
+	VGA_RASTER_ERROR_IO	/* Couldn't write the file */
+} VGARasterError;
+
+typedef struct _VGARaster VGARaster;
+
+GQuark		vga_raster_error_quark	(void);
+
+VGARaster *	vga_raster_new		(void);
+void		vga_raster_destroy	(VGARaster * raster);
+void		vga_raster_set_scale	(VGARaster * raster, int scale);
+int		vga_raster_get_scale	(VGARaster * raster);
+int		vga_raster_width	(VGARaster * raster, VGAScreen * scr);
+int		vga_raster_height	(VGARaster * raster, VGAScreen * scr,
+						int rows);
+void		vga_raster_render	(VGARaster * raster, VGAScreen * scr,
+						int row, int rows,
+						guchar * pixels,
+						int rowstride);
+gboolean	vga_raster_save_png	(VGARaster * raster, VGAScreen * scr,
+						int rows, const gchar * filename,
+						GError ** error);
+
+G_END_DECLS
+
+#endif	/* __VGA_RASTER_H__ */
@@ -0,0 +1,81 @@
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of version 2 of the GNU General Public License as
+ *  published by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ *****************************************************************************
+ *
+ *  Session recordings.  A VGARecorder attached to an emulator with
+ *  vga_emu_set_recorder() writes everything the emulator parses to a file
+ *  as timestamped chunks, compressed a block at a time, along with
+ *  periodic snapshots of the terminal (see vgasnapshot.h).  An index at the
+ *  end of the file locates every block and snapshot by time and input
+ *  offset.
+ *
+ *  A VGARecording reads such a file through a memory map.  Seeking to a
+ *  point in time restores the last snapshot before it and replays at most
+ *  one snapshot interval of input.
+ */
+
+#ifndef __VGA_RECORD_H__
+#define __VGA_RECORD_H__
+
+#include "vgascreen.h"
+#include "emulation.h"
+
+G_BEGIN_DECLS
+
+#define VGA_RECORD_ERROR	vga_record_error_quark()
+
+typedef enum
+{
+	VGA_RECORD_ERROR_FORMAT,	/* Not a recording, or damaged */
+	VGA_RECORD_ERROR_IO		/* Couldn't write the file */
+} VGARecordError;
+
+/* VGARecorder is declared in emulation.h */
+typedef struct _VGARecording VGARecording;
+
+/* Return FALSE to stop */
+typedef gboolean (*VGARecordFunc) (guint64 usec, const guchar * data,
+					gsize len, gpointer user_data);
+
+GQuark		vga_record_error_quark	(void);
+
+/* Writing */
+VGARecorder *	vga_recorder_new	(const gchar * filename,
+						GError ** error);
+void		vga_recorder_set_keyframe_interval(VGARecorder * rec,
+						gsize bytes);
+void		vga_recorder_write	(VGARecorder * rec,
+						const guchar * data, gsize len);
+void		vga_recorder_feed	(VGARecorder * rec, EmuData * emu,
+						const guchar * data, gsize len);
+void		vga_recorder_keyframe	(VGARecorder * rec, VGAScreen * scr,
+						EmuData * emu);
+gboolean	vga_recorder_close	(VGARecorder * rec, GError ** error);
+
+/* Reading */
+VGARecording *	vga_recording_open	(const gchar * filename,
+						GError ** error);
+void		vga_recording_close	(VGARecording * rec);
+guint64		vga_recording_get_duration(VGARecording * rec);
+guint64		vga_recording_get_length(VGARecording * rec);
+gboolean	vga_recording_foreach	(VGARecording * rec, guint64 from,
+						VGARecordFunc func,
+						gpointer user_data);
+gboolean	vga_recording_seek	(VGARecording * rec, EmuData * emu,
+						guint64 usec);
+
+G_END_DECLS
+
+#endif	/* __VGA_RECORD_H__ */
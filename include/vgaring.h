@@ -0,0 +1,57 @@
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of version 2 of the GNU General Public License as
+ *  published by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ *****************************************************************************
+ *
+ *  A lock-free single-producer/single-consumer byte ring.  One thread may
+ *  write to it while another reads from it, with no locking in between.
+ *  Writes never block; they accept only as much as fits, which is how the
+ *  producer sees backpressure.
+ *
+ *  The consumer can go to sleep with vga_ring_wait(), in which case the
+ *  notify function is called (on the producer's thread) by the next write.
+ */
+
+#ifndef __VGA_RING_H__
+#define __VGA_RING_H__
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+typedef struct _VGARing VGARing;
+typedef void (*VGARingNotify) (VGARing * ring, gpointer user_data);
+
+VGARing *	vga_ring_new		(gsize size);
+void		vga_ring_destroy	(VGARing * ring);
+void		vga_ring_set_notify	(VGARing * ring, VGARingNotify func,
+						gpointer user_data);
+gsize		vga_ring_size		(VGARing * ring);
+gsize		vga_ring_length		(VGARing * ring);
+gsize		vga_ring_space		(VGARing * ring);
+
+/* Producer side */
+gsize		vga_ring_write		(VGARing * ring, const guchar * buf,
+						gsize len);
+
+/* Consumer side */
+gsize		vga_ring_peek		(VGARing * ring, const guchar ** buf);
+void		vga_ring_consume	(VGARing * ring, gsize len);
+gsize		vga_ring_read		(VGARing * ring, guchar * buf,
+						gsize len);
+gboolean	vga_ring_wait		(VGARing * ring);
+
+G_END_DECLS
+
+#endif	/* __VGA_RING_H__ */
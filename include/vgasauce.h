@@ -0,0 +1,80 @@
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of version 2 of the GNU General Public License as
+ *  published by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ *****************************************************************************
+ *
+ *  SAUCE records.  Most ANSI art ends with an EOF character (^Z), an
+ *  optional comment block and a 128 byte SAUCE record describing the
+ *  piece: its size, whether it uses iCE colors, and the font it was drawn
+ *  with.  Reading the record first lets the screen be set up before any
+ *  of the art is parsed, and tells where the art ends so that the record
+ *  isn't printed as garbage.
+ */
+
+#ifndef __VGA_SAUCE_H__
+#define __VGA_SAUCE_H__
+
+#include <gtk/gtk.h>
+#include "vgascreen.h"
+#include "vgafontpack.h"
+
+G_BEGIN_DECLS
+
+#define VGA_SAUCE_EOF		0x1A
+#define VGA_SAUCE_RECORD_LEN	128
+
+/* SAUCE data types */
+#define VGA_SAUCE_CHARACTER	1
+#define VGA_SAUCE_BINARYTEXT	5
+#define VGA_SAUCE_XBIN		6
+
+typedef struct
+{
+	gchar title[36];
+	gchar author[21];
+	gchar group[21];
+	gchar date[9];		/* CCYYMMDD */
+	guint32 file_size;
+	guchar data_type;
+	guchar file_type;
+	guint16 tinfo[4];
+	guchar comments;	/* Lines in the comment block */
+	guchar flags;
+	gchar font[23];
+
+	/* Worked out from the above */
+	gsize data_len;		/* Bytes before the comments and record */
+	int cols, rows;		/* 0 if not given */
+	gboolean has_icecolor;	/* Whether icecolor means anything */
+	gboolean icecolor;
+	int letter_spacing;	/* 8 or 9 pixels, 0 if not given */
+} VGASauce;
+
+gboolean	vga_sauce_parse		(const guchar * data, gsize len,
+						VGASauce * sauce);
+gboolean	vga_sauce_read_fd	(int fd, VGASauce * sauce);
+gsize		vga_sauce_content_length(const guchar * data, gsize len);
+int		vga_sauce_font_height	(const VGASauce * sauce);
+VGAFont *	vga_sauce_find_font	(const VGASauce * sauce,
+						VGAFontPack * fonts);
+void		vga_sauce_apply_screen	(const VGASauce * sauce,
+						VGAScreen * scr,
+						VGAFontPack * fonts);
+void		vga_sauce_apply		(const VGASauce * sauce,
+						GtkWidget * widget,
+						VGAFontPack * fonts);
+
+G_END_DECLS
+
+#endif	/* __VGA_SAUCE_H__ */
@@ -0,0 +1,173 @@
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of version 2 of the GNU General Public License as
+ *  published by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ *****************************************************************************
+ *
+ *  The VGA screen model.  A VGAScreen holds everything the VGAText and
+ *  VGATerm widgets display -- the video buffer, cursor, font, palette and
+ *  the terminal's window and text attribute -- but knows nothing about
+ *  GdkWindows or drawing.  Instead, every change is recorded as damage,
+ *  which the owning widget turns into drawing in vga_update().
+ *
+ *  This lets the emulator run against a screen that is not attached to
+ *  any widget, for example on a worker thread (see emuthread.h).  A
+ *  VGAScreen is not locked; it must only be used by one thread at a time.
+ *
+ *  Cell methods take 0-based absolute coordinates like VGAText.  Terminal
+ *  methods take 1-based coordinates relative to the window like VGATerm.
+ */
+
+#ifndef __VGA_SCREEN_H__
+#define __VGA_SCREEN_H__
+
+#include <glib.h>
+#include "vgafont.h"
+#include "vgapalette.h"
+
+/* Standard byte-representation helpers for VGA text-mode attributes */
+
+#define PURPLE MAGENTA
+#define GRAY GREY
+typedef enum
+{
+        BLACK, BLUE, GREEN, CYAN, RED, MAGENTA, BROWN, GREY
+} base_color;
+
+typedef enum
+{
+        DARKGREY=8, LIGHTBLUE, LIGHTGREEN, LIGHTCYAN, ORANGE, PINK, YELLOW, WHITE
+} bright_color;
+
+/* VGA text attribute byte manipulation */
+#define GETFG(attr) (attr & 0x0F)
+#define GETBG(attr) ((attr & 0x70) >> 4)
+#define GETBLINK(attr) (attr >> 7)
+#define BRIGHT(col) (col | 0x08)
+#define SETFG(attr, fg) ((attr & 0xF0) | fg)
+#define SETBG(attr, bg) ((attr & 0x8F) | (bg << 4))
+#define BLINK(col) (col | 0x80)
+#define ATTR(fg, bg) ((bg << 4) | fg)
+
+
+G_BEGIN_DECLS
+
+typedef struct
+{
+	guchar c;		/* The ASCII character */
+	guchar attr;		/* The text attribute */
+} vga_charcell;
+
+/* Flags for VGAScreen.changes */
+#define VGA_SCREEN_DIRTY	(1 << 0)	/* Repaint everything */
+#define VGA_SCREEN_PALETTE	(1 << 1)	/* Palette was modified */
+#define VGA_SCREEN_FONT		(1 << 2)	/* Font was modified */
+#define VGA_SCREEN_RESIZE	(1 << 3)	/* Rows/cols changed */
+#define VGA_SCREEN_CURSOR	(1 << 4)	/* Cursor shown/hidden */
+
+typedef struct _VGAScreen VGAScreen;
+
+struct _VGAScreen
+{
+	int rows;
+	int cols;
+	vga_charcell * video_buf;
+	VGAFont * font;
+	VGAPalette * pal;
+	guint font_serial;	/* Changes whenever font is modified */
+	guint pal_serial;	/* Changes whenever pal is modified */
+	gboolean icecolor;
+	gboolean cursor_visible;
+	int cursor_x;		/* 0-based */
+	int cursor_y;
+
+	/* Terminal state */
+	guchar textattr;
+	int win_top_left_x, win_top_left_y;
+	int win_bot_right_x, win_bot_right_y;
+	guchar last_char;
+
+	/* Damage since the last vga_screen_clear_damage() */
+	guint changes;
+	int * dirty_start;	/* Per row: first dirty column, -1 if clean */
+	int * dirty_end;	/* Per row: last dirty column + 1 */
+	int dirty_top;		/* First row that may be dirty */
+	int dirty_bottom;	/* Last row that may be dirty + 1 */
+	int scroll_lines;	/* Lines the view should follow the window */
+	int bells;
+};
+
+VGAScreen *	vga_screen_new		(int rows, int cols);
+VGAScreen *	vga_screen_dup		(VGAScreen * src);
+void		vga_screen_destroy	(VGAScreen * scr);
+void		vga_screen_copy_from	(VGAScreen * scr, VGAScreen * src);
+void		vga_screen_resize	(VGAScreen * scr, int rows, int cols);
+
+/* Damage tracking */
+void		vga_screen_damage	(VGAScreen * scr, int col, int row,
+						int cols, int rows);
+void		vga_screen_damage_all	(VGAScreen * scr);
+void		vga_screen_clear_damage	(VGAScreen * scr);
+void		vga_screen_font_changed	(VGAScreen * scr);
+void		vga_screen_glyphs_changed(VGAScreen * scr, guchar first,
+						guchar last);
+void		vga_screen_set_font	(VGAScreen * scr, VGAFont * font);
+VGAFont *	vga_screen_get_writable_font(VGAScreen * scr);
+void		vga_screen_palette_changed(VGAScreen * scr);
+void		vga_screen_palette_colors_changed(VGAScreen * scr,
+						guint colors);
+
+/* Character cell methods */
+void		vga_screen_put_char	(VGAScreen * scr, guchar c, guchar attr,
+						int col, int row);
+void		vga_screen_put_string	(VGAScreen * scr, const guchar * s,
+						guchar attr, int col, int row);
+void		vga_screen_clear_area	(VGAScreen * scr, guchar attr,
+						int top_left_x, int top_left_y,
+						int cols, int rows);
+void		vga_screen_cursor_move	(VGAScreen * scr, int x, int y);
+void		vga_screen_cursor_set_visible(VGAScreen * scr,
+						gboolean visible);
+void		vga_screen_set_icecolor	(VGAScreen * scr, gboolean status);
+
+/* Terminal methods */
+void		vga_screen_writec	(VGAScreen * scr, guchar c);
+void		vga_screen_write	(VGAScreen * scr, const guchar * s,
+						gsize len);
+void		vga_screen_window	(VGAScreen * scr, int x1, int y1,
+						int x2, int y2);
+void		vga_screen_gotoxy	(VGAScreen * scr, int x, int y);
+int		vga_screen_wherex	(VGAScreen * scr);
+int		vga_screen_wherey	(VGAScreen * scr);
+int		vga_screen_term_cols	(VGAScreen * scr);
+int		vga_screen_term_rows	(VGAScreen * scr);
+void		vga_screen_clrscr	(VGAScreen * scr);
+void		vga_screen_clrdown	(VGAScreen * scr);
+void		vga_screen_clrup	(VGAScreen * scr);
+void		vga_screen_clreol	(VGAScreen * scr);
+void		vga_screen_scroll_up	(VGAScreen * scr, int lines);
+void		vga_screen_scroll_down	(VGAScreen * scr, int lines);
+void		vga_screen_dellines_absolute(VGAScreen * scr, int top_row,
+						int lines);
+void		vga_screen_dellines	(VGAScreen * scr, int top_row,
+						int lines);
+void		vga_screen_inslines	(VGAScreen * scr, int top_row,
+						int lines);
+void		vga_screen_set_attr	(VGAScreen * scr, guchar textattr);
+guchar		vga_screen_get_attr	(VGAScreen * scr);
+void		vga_screen_set_fg	(VGAScreen * scr, guchar fg);
+void		vga_screen_set_bg	(VGAScreen * scr, guchar bg);
+
+G_END_DECLS
+
+#endif	/* __VGA_SCREEN_H__ */
@@ -0,0 +1,50 @@
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of version 2 of the GNU General Public License as
+ *  published by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ *****************************************************************************
+ *
+ *  Binary snapshots of a terminal: the screen (video buffer, cursor, text
+ *  attribute, window, font, palette and icecolor) and optionally the
+ *  emulator's parser state.  A snapshot restored into another process, or
+ *  after a crash, carries on exactly where the original left off, even in
+ *  the middle of an escape sequence.
+ *
+ *  The format is little-endian and does not depend on the machine, so
+ *  snapshots may be written to disk or sent over the network.
+ */
+
+#ifndef __VGA_SNAPSHOT_H__
+#define __VGA_SNAPSHOT_H__
+
+#include "vgascreen.h"
+#include "emulation.h"
+
+G_BEGIN_DECLS
+
+#define VGA_SNAPSHOT_VERSION	2
+
+void		vga_snapshot_append	(GByteArray * out, VGAScreen * scr,
+						EmuData * emu);
+GByteArray *	vga_snapshot_save	(VGAScreen * scr, EmuData * emu);
+gboolean	vga_snapshot_restore	(VGAScreen * scr, EmuData * emu,
+						const guchar * data, gsize len);
+
+/* VGATerm widgets, with vga_term_emu_init() done */
+GByteArray *	vga_term_snapshot_save	(GtkWidget * term);
+gboolean	vga_term_snapshot_restore(GtkWidget * term,
+						const guchar * data, gsize len);
+
+G_END_DECLS
+
+#endif	/* __VGA_SNAPSHOT_H__ */
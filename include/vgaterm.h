@@ -51,12 +51,8 @@ struct _VGATerm
 	VGAText vga;
 	GtkAdjustment *adjustment;	/* Scrolling adjustment */
 
-	/* <public> -- though should be read-only really */
+	/* The text attribute and window are in vga_get_screen(term) */
 
-	guchar textattr;
-	int win_top_left_x, win_top_left_y;
-	int win_bot_right_x, win_bot_right_y;
-	
 	/* <private> */
 	struct _VGATermPrivate * pvt;
 };
@@ -69,6 +65,9 @@ struct _VGATermClass
 GType		vga_term_get_type	(void)	G_GNUC_CONST;
   GtkWidget * 	vga_term_new		(GtkAdjustment *adjustment, int lines);
 void            vga_term_set_adjustment (GtkWidget *term, GtkAdjustment *adjustment);
+void		vga_term_update		(GtkWidget * widget);
+void		vga_term_set_fast_forward(GtkWidget * widget,
+						gboolean status);
 void		vga_term_writec		(GtkWidget * widget, guchar c);
 gint		vga_term_write		(GtkWidget * widget, guchar * s);
 gint		vga_term_writeln	(GtkWidget * widget, guchar * s);
@@ -30,6 +30,10 @@
  *  video buffer directly requires that you call the appropriate refresh
  *  method before any drawing actually takes place.
  *
+ *  The display contents themselves live in a VGAScreen (see vgascreen.h),
+ *  which records what changed rather than drawing it.  Modify the screen
+ *  returned by vga_get_screen() and call vga_update() to draw the damage.
+ *
  *  This is *NOT* a terminal widget.  See VGATerm for a terminal widget
  *  implemented using this (VGAText).
  *
@@ -54,40 +58,18 @@
 #include <gtk/gtk.h>
 #include "vgafont.h"
 #include "vgapalette.h"
-
-
-/* Standard byte-representation helpers for VGA text-mode attributes */
-
-#define PURPLE MAGENTA
-#define GRAY GREY
-typedef enum
-{
-        BLACK, BLUE, GREEN, CYAN, RED, MAGENTA, BROWN, GREY
-} base_color;
-
-typedef enum
-{
-        DARKGREY=8, LIGHTBLUE, LIGHTGREEN, LIGHTCYAN, ORANGE, PINK, YELLOW, WHITE
-} bright_color;
-
-/* VGA text attribute byte manipulation */
-#define GETFG(attr) (attr & 0x0F)
-#define GETBG(attr) ((attr & 0x70) >> 4)
-#define GETBLINK(attr) (attr >> 7)
-#define BRIGHT(col) (col | 0x08)
-#define SETFG(attr, fg) ((attr & 0xF0) | fg)
-#define SETBG(attr, bg) ((attr & 0x8F) | (bg << 4))
-#define BLINK(col) (col | 0x80)
-#define ATTR(fg, bg) ((bg << 4) | fg)
+#include "vgascreen.h"
 
 
 G_BEGIN_DECLS
 
-typedef struct
+/* How the widget draws; see vga_set_renderer() */
+typedef enum
 {
-	guchar c;		/* The ASCII character */
-	guchar attr;		/* The text attribute */
-} vga_charcell;
+	VGA_RENDERER_GC,	/* Stippled GC fills, on any display */
+	VGA_RENDERER_XRENDER,	/* XRender glyph sets */
+	VGA_RENDERER_XSHM	/* Client-side images, in shared memory */
+} VGARenderer;
 
 /* The widget itself */
 typedef struct _VGAText
@@ -168,6 +150,16 @@ void		vga_clear_area(GtkWidget * widget, guchar attr, int top_left_x,
 				int top_left_y, int cols, int rows);
 int             vga_video_buf_size(GtkWidget * widget);
 void		vga_video_buf_clear(GtkWidget * widget);
+VGAScreen *	vga_get_screen(GtkWidget * widget);
+void		vga_update(GtkWidget * widget);
+void		vga_set_fast_forward(GtkWidget * widget, gboolean status);
+gboolean	vga_get_fast_forward(GtkWidget * widget);
+void		vga_set_deferred_drawing(GtkWidget * widget, gboolean status);
+gboolean	vga_get_deferred_drawing(GtkWidget * widget);
+void		vga_set_zoom(GtkWidget * widget, int zoom);
+int		vga_get_zoom(GtkWidget * widget);
+gboolean	vga_set_renderer(GtkWidget * widget, VGARenderer renderer);
+VGARenderer	vga_get_renderer(GtkWidget * widget);
 
 G_END_DECLS
 
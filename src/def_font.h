@@ -3,7 +3,7 @@
 #ifndef __DEF_FONT_H__
 #define __DEF_FONT_H__
 
-static unsigned char default_font [] = {  // 4096 bytes
+static const unsigned char default_font [] = {  // 4096 bytes
 
 0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
 0x00,0x00,0x00,0x7e,0x81,0xa5,0x81,0x81,0xbd,0x99,0x81,0x81,0x7e,0x00,0x00,
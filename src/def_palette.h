@@ -3,7 +3,7 @@
 #ifndef __DEF_PALETTE_H__
 #define __DEF_PALETTE_H__
 
-unsigned char default_palette [] = {
+static const unsigned char default_palette [] = {
 
 0x00,0x00,0x00,0x00,0x00,0x2a,0x00,0x2a,0x00,0x00,0x2a,0x2a,0x2a,0x00,0x00,
 0x2a,0x00,0x2a,0x2a,0x2a,0x00,0x2a,0x2a,0x2a,0x00,0x00,0x15,0x00,0x00,0x3f,
@@ -22,11 +22,18 @@
  *  methods.  Based on ideas from Iniquity BBS's emulator, some of which
  *  originally came from Turbo Pascal SWAG.  The ANSI and TextFX support
  *  are most complete (since they're what really matters).
+ *
+ *  The emulator itself only works on a VGAScreen, so it can also run
+ *  away from the widget, e.g. on a worker thread (see emuthread.c).
  */
 
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
 #include "emulation.h"
-
-#define TFX_NUM_UPALS	3
+#include "emuprivate.h"
+#include "vgasauce.h"
 
 /* Attribute flags for vt100 */
 #define AVT_DEFAULT 0
@@ -40,44 +47,28 @@
 
 typedef guchar PalData[192];
 
-typedef struct
-{
-	/* Individual emulation enablers */
-	gboolean ansi, vt100, avatar, textfx;
-	
-	int tfx_stage;
-	guchar tfx_param[4096];
-	guchar tfx_cmd;
-	int tfx_num;		/* param length for tfx_cmd */
-	guchar tfx_def_attr;
-	guchar tfx_save_x, tfx_save_y, tfx_save_attr;
-	VGAPalette * tfx_user_pal[TFX_NUM_UPALS];
-
-	GString * ansi_code;
-	guchar ansi_save_x, ansi_save_y;
-	guchar ansi_esc;
-	
-	guchar avt_cmd, avt_stage, avt_par1, avt_par2;
-
-	GString * vt_code;
-	guchar vt_stage, vt_cmd, vt_save_x, vt_save_y, vt_save_attr;
-	guchar vt_attr;
-	guchar vt_buf[3];
-
-} EmuData;
-
-	
 static void vt_init(EmuData * data);
 static void ansi_init(EmuData * data);
-static void ansi_detect_reply(GtkWidget * widget);
+static void ansi_detect_reply(VGAScreen * scr);
 
-void vga_term_emu_init(GtkWidget * widget)
+/**
+ * vga_emu_new:
+ * @scr: Screen the emulator writes to
+ *
+ * Create a new emulator.  It does not touch any widget, so it may be used
+ * on any one thread at a time along with @scr.
+ *
+ * Returns: a new EmuData
+ */
+EmuData * vga_emu_new(VGAScreen * scr)
 {
 	EmuData * emu;
 	int i;
-	/* Initialize extended widget properties */
-	emu = g_malloc(sizeof(EmuData));
-	g_object_set_data(G_OBJECT(widget), "emu_data", emu);
+
+	g_return_val_if_fail(scr != NULL, NULL);
+
+	emu = g_new0(EmuData, 1);
+	emu->screen = scr;
 
 	emu->tfx_stage = -1;
 	emu->tfx_def_attr = 0x07;
@@ -91,16 +82,254 @@ void vga_term_emu_init(GtkWidget * widget)
 
 	vt_init(emu);
 	ansi_init(emu);
+
+	return emu;
+}
+
+void vga_emu_destroy(EmuData * emu)
+{
+	int i;
+
+	g_return_if_fail(emu != NULL);
+
+	for (i = 0; i < TFX_NUM_UPALS; i++)
+		vga_palette_destroy(emu->tfx_user_pal[i]);
+	if (emu->morph_to)
+		vga_palette_destroy(emu->morph_to);
+	g_string_free(emu->ansi_code, TRUE);
+	g_string_free(emu->vt_code, TRUE);
+	g_free(emu);
+}
+
+/**
+ * vga_emu_reset:
+ * @emu: Emulator
+ *
+ * Forget any half-parsed escape sequence and saved cursor positions, and
+ * clear the TextFX user palettes, as if the emulator were new.  A palette
+ * morph in progress is dropped where it is.  The screen is not touched.
+ */
+void vga_emu_reset(EmuData * emu)
+{
+	int i;
+
+	g_return_if_fail(emu != NULL);
+
+	if (emu->morph_to)
+	{
+		vga_palette_destroy(emu->morph_to);
+		emu->morph_to = NULL;
+	}
+
+	emu->tfx_cmd = 0;
+	emu->tfx_num = 0;
+	emu->tfx_def_attr = 0x07;
+	emu->tfx_save_x = 1;
+	emu->tfx_save_y = 1;
+	emu->tfx_save_attr = emu->tfx_def_attr;
+	for (i = 0; i < TFX_NUM_UPALS; i++)
+		memset(emu->tfx_user_pal[i], 0, sizeof(VGAPalette));
+
+	g_string_free(emu->ansi_code, TRUE);
+	g_string_free(emu->vt_code, TRUE);
+	vt_init(emu);
+	ansi_init(emu);
+}
+
+/**
+ * vga_emu_copy_state:
+ * @emu: Emulator
+ * @src: Emulator to copy from
+ *
+ * Make @emu's parser state (including any half-parsed escape sequence,
+ * saved cursor positions, TextFX user palettes and any palette morph in
+ * progress) the same as @src's.  Each keeps its own screen, sync function
+ * and morph function.
+ */
+void vga_emu_copy_state(EmuData * emu, EmuData * src)
+{
+	EmuData keep;
+	int i;
+
+	g_return_if_fail(emu != NULL);
+	g_return_if_fail(src != NULL);
+
+	if (emu == src)
+		return;
+
+	/* Copy the plain fields wholesale, then put back what we own */
+	keep = *emu;
+	*emu = *src;
+	emu->screen = keep.screen;
+	emu->sync_func = keep.sync_func;
+	emu->sync_data = keep.sync_data;
+	emu->ansi_code = keep.ansi_code;
+	emu->vt_code = keep.vt_code;
+	emu->recorder = keep.recorder;
+	emu->morph_to = keep.morph_to;
+	emu->morph_func = keep.morph_func;
+	emu->morph_data = keep.morph_data;
+
+	g_string_truncate(emu->ansi_code, 0);
+	g_string_append_len(emu->ansi_code, src->ansi_code->str,
+			src->ansi_code->len);
+	g_string_truncate(emu->vt_code, 0);
+	g_string_append_len(emu->vt_code, src->vt_code->str,
+			src->vt_code->len);
+
+	for (i = 0; i < TFX_NUM_UPALS; i++)
+	{
+		emu->tfx_user_pal[i] = keep.tfx_user_pal[i];
+		vga_palette_copy_from(emu->tfx_user_pal[i],
+				src->tfx_user_pal[i]);
+	}
+
+	if (emu->morph_to && !src->morph_to)
+	{
+		vga_palette_destroy(emu->morph_to);
+		emu->morph_to = NULL;
+	}
+	else if (src->morph_to)
+	{
+		if (emu->morph_to)
+			vga_palette_copy_from(emu->morph_to, src->morph_to);
+		else
+			emu->morph_to = vga_palette_dup(src->morph_to);
+		if (emu->morph_func)
+			emu->morph_func(emu, emu->morph_data);
+	}
+}
+
+VGAScreen * vga_emu_get_screen(EmuData * emu)
+{
+	g_return_val_if_fail(emu != NULL, NULL);
+
+	return emu->screen;
+}
+
+/**
+ * vga_emu_set_sync_func:
+ * @emu: Emulator
+ * @func: Function to call, or NULL
+ * @user_data: Data passed to @func
+ *
+ * Set the function called when a command needs an intermediate state of
+ * the screen to be shown before it continues, such as each step of a
+ * TextFX palette morph.
+ */
+void vga_emu_set_sync_func(EmuData * emu, EmuSyncFunc func,
+		gpointer user_data)
+{
+	g_return_if_fail(emu != NULL);
+
+	emu->sync_func = func;
+	emu->sync_data = user_data;
+}
+
+static
+void emu_sync(EmuData * data)
+{
+	if (data->sync_func)
+		data->sync_func(data, data->sync_data);
+}
+
+/**
+ * vga_emu_set_morph_func:
+ * @emu: Emulator
+ * @func: Function to call, or NULL
+ * @user_data: Data passed to @func
+ *
+ * Have TextFX palette morphs run as animations.  @func is called when one
+ * starts (or is copied in by vga_emu_copy_state()), and should arrange
+ * for vga_emu_morph_step() to be called once a frame until it returns
+ * FALSE.  Parsing carries on in the meantime; a later command that uses
+ * the palette finishes the morph first.
+ *
+ * Without a morph function, a morph runs to the end before parsing goes
+ * on, showing each frame through the sync function.
+ */
+void vga_emu_set_morph_func(EmuData * emu, EmuMorphFunc func,
+		gpointer user_data)
+{
+	g_return_if_fail(emu != NULL);
+
+	emu->morph_func = func;
+	emu->morph_data = user_data;
+}
+
+/**
+ * vga_emu_morph_step:
+ * @emu: Emulator
+ *
+ * Do one frame of the palette morph in progress.  Only the cells whose
+ * colors changed are damaged.
+ *
+ * Returns: TRUE if there are more frames to go
+ */
+gboolean vga_emu_morph_step(EmuData * emu)
+{
+	VGAScreen * scr;
+	guchar before[16][3];
+	const guchar * c;
+	guint colors = 0;
+	int i, n;
+
+	g_return_val_if_fail(emu != NULL, FALSE);
+
+	if (emu->morph_to == NULL)
+		return FALSE;
+	scr = emu->screen;
+
+	for (i = 0; i < 16; i++)
+		memcpy(before[i], &scr->pal->vga[vga_palette_text_regs[i] * 3], 3);
+
+	n = MIN(emu->morph_stride, emu->morph_left);
+	for (i = 0; i < n; i++)
+		vga_palette_morph_to_step(scr->pal, emu->morph_to);
+	emu->morph_left -= n;
+
+	for (i = 0; i < 16; i++)
+	{
+		c = &scr->pal->vga[vga_palette_text_regs[i] * 3];
+		if (memcmp(c, before[i], 3) != 0)
+			colors |= 1 << i;
+	}
+	vga_screen_palette_colors_changed(scr, colors);
+
+	if (emu->morph_left > 0)
+		return TRUE;
+
+	vga_palette_destroy(emu->morph_to);
+	emu->morph_to = NULL;
+	return FALSE;
+}
+
+/* Jump to the end of the palette morph in progress, if any */
+void vga_emu_morph_finish(EmuData * emu)
+{
+	g_return_if_fail(emu != NULL);
+
+	if (emu->morph_to == NULL)
+		return;
+
+	vga_palette_copy_from(emu->screen->pal, emu->morph_to);
+	vga_screen_palette_changed(emu->screen);
+	vga_palette_destroy(emu->morph_to);
+	emu->morph_to = NULL;
+}
+
+gboolean vga_emu_morph_pending(EmuData * emu)
+{
+	g_return_val_if_fail(emu != NULL, FALSE);
+
+	return emu->morph_to != NULL;
 }
 
 /* Get a palette object pointer from the character given */
 /* Return NULL on error */
 static
-VGAPalette * tfx_get_pal(GtkWidget * widget, guchar c)
+VGAPalette * tfx_get_pal(VGAScreen * scr, EmuData * data, guchar c)
 {
-	EmuData * data;
-	data = g_object_get_data(G_OBJECT(widget), "emu_data");
-
 	if (c >= '1' && c < ('1' + TFX_NUM_UPALS))
 		return data->tfx_user_pal[c-'1'];
 	else
@@ -113,7 +342,7 @@ VGAPalette * tfx_get_pal(GtkWidget * widget, guchar c)
 			case 'B':
 				return vga_palette_stock(PAL_BLACK);
 			case 'C':
-				return vga_get_palette(widget);
+				return scr->pal;
 			case 'D':
 				return vga_palette_stock(PAL_DEFAULT);
 			case 'E':
@@ -124,50 +353,52 @@ VGAPalette * tfx_get_pal(GtkWidget * widget, guchar c)
 }
 
 static
-void tfx_command(GtkWidget * widget, EmuData * data, guchar cmd)
+void tfx_command(VGAScreen * scr, EmuData * data, guchar cmd)
 {
 	guchar x, z, c;
-	VGAFont * font;
 	VGAPalette * pal, * p;
-	VGATerm * term;
-	gboolean b = FALSE;
-	gchar * s;
+	VGAFont * font;
+
+	/* Commands that use the palette see a morph in progress as done, the
+	 * same as if it had run before parsing went on */
+	if (data->morph_to && cmd && strchr("pPQRXzZ", cmd))
+		vga_emu_morph_finish(data);
 
 	switch (cmd)
 	{
 		case 'a':
-			vga_term_gotoxy(widget, vga_term_wherex(widget),
-					vga_term_wherey(widget) - 1);
+			vga_screen_gotoxy(scr, vga_screen_wherex(scr),
+					vga_screen_wherey(scr) - 1);
 			break;
 		case 'A':
-			vga_term_gotoxy(widget, vga_term_wherex(widget),
-				vga_term_wherey(widget) - data->tfx_param[0]);
+			vga_screen_gotoxy(scr, vga_screen_wherex(scr),
+				vga_screen_wherey(scr) - data->tfx_param[0]);
 			break;
 		case 'b':
-			vga_term_gotoxy(widget, vga_term_wherex(widget),
-					vga_term_wherey(widget) + 1);
+			vga_screen_gotoxy(scr, vga_screen_wherex(scr),
+					vga_screen_wherey(scr) + 1);
 			break;
 		case 'B':
-			vga_term_gotoxy(widget, vga_term_wherex(widget),
-				vga_term_wherey(widget) + data->tfx_param[0]);
+			vga_screen_gotoxy(scr, vga_screen_wherex(scr),
+				vga_screen_wherey(scr) + data->tfx_param[0]);
 			break;
 		case 'c':
-			vga_term_gotoxy(widget, vga_term_wherex(widget) + 1,
-					vga_term_wherey(widget));
+			vga_screen_gotoxy(scr, vga_screen_wherex(scr) + 1,
+					vga_screen_wherey(scr));
 			break;
 		case 'C':
-			vga_term_gotoxy(widget,
-				vga_term_wherex(widget) + data->tfx_param[0],
-				vga_term_wherey(widget));
+			vga_screen_gotoxy(scr,
+				vga_screen_wherex(scr) + data->tfx_param[0],
+				vga_screen_wherey(scr));
 			break;
 		case 'd':
-			vga_term_gotoxy(widget, vga_term_wherex(widget) - 1,
-					vga_term_wherey(widget));
+			vga_screen_gotoxy(scr, vga_screen_wherex(scr) - 1,
+					vga_screen_wherey(scr));
 			break;
 		case 'D':
-			vga_term_gotoxy(widget,
-				vga_term_wherex(widget) - data->tfx_param[0],
-				vga_term_wherey(widget));
+			vga_screen_gotoxy(scr,
+				vga_screen_wherex(scr) - data->tfx_param[0],
+				vga_screen_wherey(scr));
 			break;
 		case 'E':
 			/* We would send <esc>ENVgtermix v1.00<null> */
@@ -175,142 +406,131 @@ void tfx_command(GtkWidget * widget, EmuData * data, guchar cmd)
 			 * on the widget */
 			break;
 		case 'F':
-			font = vga_get_font(widget);
+			font = vga_font_new();
 			if (vga_font_load(font, data->tfx_param, 8, 16))
-			{
-				vga_refresh_font(widget);
-				vga_refresh(widget);
-			}
+				vga_screen_set_font(scr, font);
 			else
 				g_error("Unable to load TextFX font");
+			vga_font_destroy(font);
 			data->tfx_stage = -1;
 			break;
 		case 'G':
-			font = vga_get_font(widget);
+			/* Glyphs for characters tfx_param[0] to tfx_param[1];
+			 * they only fit an 8x16 font */
+			if (data->tfx_param[0] > data->tfx_param[1] ||
+				scr->font->width != 8 ||
+				scr->font->height != TFX_GLYPH_BYTES)
+				break;
+			font = vga_screen_get_writable_font(scr);
 			if (vga_font_set_chars(font, &(data->tfx_param[2]),
-				data->tfx_param[0], data->tfx_param[1]+1))
-			{
-				vga_refresh_font(widget);
-				vga_refresh(widget);
-			}
+				data->tfx_param[0], data->tfx_param[1]))
+				vga_screen_glyphs_changed(scr,
+					data->tfx_param[0], data->tfx_param[1]);
 			else
 				g_error("Unable to load TextFX font");
 			break;
 		case 'h':
-			vga_term_gotoxy(widget, 1, 1);
+			vga_screen_gotoxy(scr, 1, 1);
 			break;
 		case 'H':
-			vga_term_gotoxy(widget, data->tfx_param[0],
+			vga_screen_gotoxy(scr, data->tfx_param[0],
 					data->tfx_param[1]);
 			break;
 		case 'i':
-			vga_term_set_attr(widget, data->tfx_save_attr);
+			vga_screen_set_attr(scr, data->tfx_save_attr);
 			break;
 		case 'I':
-			term = VGA_TERM(widget);
-			data->tfx_save_attr = term->textattr;
+			data->tfx_save_attr = vga_screen_get_attr(scr);
 			break;
 		case 'j':
-			vga_term_set_attr(widget, data->tfx_def_attr);
-			vga_term_clrscr(widget);
+			vga_screen_set_attr(scr, data->tfx_def_attr);
+			vga_screen_clrscr(scr);
 			break;
 		case 'J':
-			vga_term_clrscr(widget);
+			vga_screen_clrscr(scr);
 			break;
 		case 'k':
-			vga_term_set_attr(widget, data->tfx_def_attr);
-			vga_term_clreol(widget);
+			vga_screen_set_attr(scr, data->tfx_def_attr);
+			vga_screen_clreol(scr);
 			break;
 		case 'K':
-			vga_term_clreol(widget);
+			vga_screen_clreol(scr);
 			break;
 		case 'l':
 			data->tfx_def_attr = data->tfx_param[0];
 			break;
 		case 'M':
-			vga_term_set_attr(widget, data->tfx_param[0]);
+			vga_screen_set_attr(scr, data->tfx_param[0]);
 			break;
 		case 'n':
-			vga_cursor_set_visible(widget, FALSE);
+			vga_screen_cursor_set_visible(scr, FALSE);
 			break;
 		case 'N':
-			vga_cursor_set_visible(widget, TRUE);
+			vga_screen_cursor_set_visible(scr, TRUE);
 			break;
 		case 'p':
-			pal = vga_get_palette(widget);
-			p = tfx_get_pal(widget, data->tfx_param[1]);
-			if (p && p != pal)
+			p = tfx_get_pal(scr, data, data->tfx_param[1]);
+			if (p && p != scr->pal)
 			{
-				vga_palette_destroy(pal);
-				vga_set_palette(widget,
-						vga_palette_dup(p));
-				vga_refresh(widget);
+				vga_palette_copy_from(scr->pal, p);
+				vga_screen_palette_changed(scr);
 			}
 			break;
 		case 'P':
-			vga_palette_load(vga_get_palette(widget),
-					data->tfx_param, 192);
-			vga_refresh(widget);
+			vga_palette_load(scr->pal, data->tfx_param, 192);
+			vga_screen_palette_changed(scr);
 			break;
 		case 'Q':
 			c = data->tfx_param[0];
 			if (c >= '1' && c < ('1' + TFX_NUM_UPALS))
 			{
-				pal = vga_get_palette(widget);
-				g_free(data->tfx_user_pal[c-'1']);
-				data->tfx_user_pal[c-'1'] =
-					vga_palette_dup(pal);
+				vga_palette_copy_from(
+					data->tfx_user_pal[c-'1'], scr->pal);
 				g_debug("Current palette saved to User Palette %c (stored at %p)", c, data->tfx_user_pal[c-'1']);
 			}
 			break;
 		case 'r':
 			g_debug("TextFX: repeat command.  char %d, %d times",
 					data->tfx_param[0], data->tfx_param[1]);
-			s = g_strnfill(data->tfx_param[1], data->tfx_param[0]);
-			vga_term_write(widget, s);
-			g_free(s);
-			/*
 			for (z = 0; z < data->tfx_param[1]; z++)
-				vga_term_writec(widget, data->tfx_param[0]);
-			*/
+				vga_screen_writec(scr, data->tfx_param[0]);
 			break;
 		case 'R':
-			pal = vga_get_palette(widget);
-			vga_palette_set_reg(pal, data->tfx_param[0],
+			vga_palette_set_reg(scr->pal, data->tfx_param[0],
 					data->tfx_param[1],
 					data->tfx_param[2],
 					data->tfx_param[3]);
-			vga_refresh(widget);
+			vga_screen_palette_changed(scr);
 			break;
 		case 's':
-			vga_term_gotoxy(widget, data->tfx_save_x,
+			vga_screen_gotoxy(scr, data->tfx_save_x,
 					data->tfx_save_y);
 			break;
 		case 'S':
-			data->tfx_save_x = vga_term_wherex(widget);
-			data->tfx_save_y = vga_term_wherey(widget);
+			data->tfx_save_x = vga_screen_wherex(scr);
+			data->tfx_save_y = vga_screen_wherey(scr);
 			break;
 		case 't':
-			vga_term_inslines(widget, vga_term_wherey(widget),
+			vga_screen_inslines(scr, vga_screen_wherey(scr),
 					1);
 			break;
 		case 'T':
-			vga_term_inslines(widget, vga_term_wherey(widget),
+			vga_screen_inslines(scr, vga_screen_wherey(scr),
 					data->tfx_param[0]);
 			break;
 		case 'u':
-			vga_term_dellines(widget, vga_term_wherey(widget),
+			vga_screen_dellines(scr, vga_screen_wherey(scr),
 					1);
 			break;
 		case 'U':
-			vga_term_dellines(widget, vga_term_wherey(widget),
+			vga_screen_dellines(scr, vga_screen_wherey(scr),
 					data->tfx_param[0]);
 			break;
 		case 'V':
 			// would put string <esc>TFX<#2>
 			break;
 		case 'W':
-			vga_term_window(widget, data->tfx_param[0],
+			vga_screen_window(scr, data->tfx_param[0],
 					data->tfx_param[1],
 					data->tfx_param[2],
 					data->tfx_param[3]);
@@ -320,117 +540,132 @@ void tfx_command(GtkWidget * widget, EmuData * data, guchar cmd)
 					data->tfx_param[1]);
 			
 			/* Start pal */
-			pal = tfx_get_pal(widget, data->tfx_param[0]);
+			pal = tfx_get_pal(scr, data, data->tfx_param[0]);
 			
 			/* End pal */
-			p = tfx_get_pal(widget, data->tfx_param[1]);
+			p = tfx_get_pal(scr, data, data->tfx_param[1]);
 			if (data->tfx_param[2])
 				x = MAX(63 / data->tfx_param[2], 1);
 			else x = 0;
 			g_debug("Morphing from %p to %p", pal, p);
 			if (p && pal && x > 0)
 			{
-				vga_palette_copy_from(vga_get_palette(widget),
-						pal);
-				vga_refresh(widget);
-				pal = vga_get_palette(widget);
-				for (z = 0; z < 63; z++)
-				{
-					vga_palette_morph_to_step(pal, p);
-					if (z % x == 0)
-						vga_refresh(widget);
-				}
+				/* The end palette may be the current one */
+				data->morph_to = vga_palette_dup(p);
+				data->morph_left = 63;
+				data->morph_stride = x;
+				if (pal != scr->pal)
+					vga_palette_copy_from(scr->pal, pal);
+				vga_screen_palette_changed(scr);
+				emu_sync(data);
+
+				if (data->morph_func)
+					data->morph_func(data,
+							data->morph_data);
+				else if (data->sync_func == NULL)
+					vga_emu_morph_finish(data);
+				else
+					while (vga_emu_morph_step(data))
+						emu_sync(data);
 			}
 			break;
 		case 'z':
 			if (data->tfx_param[0])
-				vga_term_window(widget, 1, 1, 80, 25);
+				vga_screen_window(scr, 1, 1, 80, 25);
 			if (data->tfx_param[1])
 			{
-				vga_palette_load_default(
-						vga_get_palette(widget));
-				b = TRUE; /* refresh */
+				vga_palette_load_default(scr->pal);
+				vga_screen_palette_changed(scr);
 			}
 			if (data->tfx_param[2])
-			{
-				vga_font_load_default(vga_get_font(widget));
-				vga_refresh_font(widget);
-				b = TRUE; /* refresh */
-			}
-			if (b)
-				vga_refresh(widget);
+				vga_screen_set_font(scr,
+					vga_font_stock(FONT_DEFAULT));
 			break;
 		case 'Z':
-			vga_term_window(widget, 1, 1, 80, 25);
-			vga_set_icecolor(widget, TRUE);
-			vga_term_set_attr(widget, data->tfx_def_attr);
-			vga_palette_load_default(vga_get_palette(widget));
-			vga_term_clrscr(widget);
-			vga_font_load_default(vga_get_font(widget));
-			vga_refresh_font(widget);
+			vga_screen_window(scr, 1, 1, 80, 25);
+			vga_screen_set_icecolor(scr, TRUE);
+			vga_screen_set_attr(scr, data->tfx_def_attr);
+			vga_palette_load_default(scr->pal);
+			vga_screen_palette_changed(scr);
+			vga_screen_clrscr(scr);
+			vga_screen_set_font(scr, vga_font_stock(FONT_DEFAULT));
 			break;
 	}
 	data->tfx_stage = -1;
 }
 
+/*
+ * How many parameter bytes TextFX command @cmd takes, or -1 if it isn't
+ * one.  @have is how many of them are in @param so far, since 'G' goes on
+ * with a glyph for each character in the range its first two give.
+ */
+int emu_tfx_param_len(guchar cmd, const guchar * param, int have)
+{
+	switch (cmd)
+	{
+		case 'a':case 'b':case 'c':case 'd':case 'E':
+		case 'h':case 'i':case 'I':case 'j':case 'J':
+		case 'k':case 'K':case 'n':case 'N':case 's':
+		case 'S':case 't':case 'u':case 'V':case 'Z':
+			return 0;
+		case 'A':case 'B':case 'C':case 'D':case 'l':
+		case 'M':case 'p':case 'Q':case 'T':case 'U':
+			return 1;
+		case 'G':
+			if (have >= 2 && param[0] <= param[1])
+				return 2 + TFX_GLYPH_BYTES *
+					(param[1] - param[0] + 1);
+			return 2;
+		case 'H':
+		case 'r':
+			return 2;
+		case 'z':
+		case 'X':
+			return 3;
+		case 'R':
+		case 'W':
+			return 4;
+		case 'P':
+			return 192;
+		case 'F':
+			return 4096;
+		default:
+			return -1;
+	}
+}
+
 static
-void tfx_out(GtkWidget * widget, EmuData * data, guchar c)
+void tfx_out(VGAScreen * scr, EmuData * data, guchar c)
 {
 	if (data->tfx_stage == -1)
 	{
 		if (c == 27)
 			data->tfx_stage = 0;
 		else
-			vga_term_writec(widget, c);
+			vga_screen_writec(scr, c);
 	}
 	else
 	if (data->tfx_stage == 0)
 	{
 		data->tfx_cmd = c;
-		switch (c)
+		data->tfx_num = emu_tfx_param_len(c, data->tfx_param, 0);
+		if (data->tfx_num < 0)
 		{
-			case 'a':case 'b':case 'c':case 'd':case 'E':
-			case 'h':case 'i':case 'I':case 'j':case 'J':
-			case 'k':case 'K':case 'n':case 'N':case 's':
-			case 'S':case 't':case 'u':case 'V':case 'Z':
-				data->tfx_num = 0;
-				break;
-			case 'A':case 'B':case 'C':case 'D':case 'l':
-			case 'M':case 'p':case 'Q':case 'T':case 'U':
-				data->tfx_num = 1;
-				break;
-			case 'G':
-			case 'H':
-			case 'r':
-				data->tfx_num = 2;
-				break;
-			case 'z':
-			case 'X':
-				data->tfx_num = 3;
-				break;
-			case 'R':
-			case 'W':
-				data->tfx_num = 4;
-				break;
-			case 'P':
-				data->tfx_num = 192;
-				break;
-			case 'F':
-				data->tfx_num = 4096;
-				break;
-			default:
-				data->tfx_stage = -1;
-				vga_term_writec(widget, c);
+			data->tfx_stage = -1;
+			vga_screen_writec(scr, c);
 		}
-		if (data->tfx_stage == data->tfx_num)
-			tfx_command(widget, data, data->tfx_cmd);
+		else if (data->tfx_stage == data->tfx_num)
+			tfx_command(scr, data, data->tfx_cmd);
 		else data->tfx_stage++;
 	} /* stage == 0 */
 	else
 	{
 		data->tfx_param[data->tfx_stage - 1] = c;
+		if (data->tfx_cmd == 'G' && data->tfx_stage == 2)
+			data->tfx_num = emu_tfx_param_len(data->tfx_cmd,
+					data->tfx_param, 2);
 		if (data->tfx_stage == data->tfx_num)
-			tfx_command(widget, data, data->tfx_cmd);
+			tfx_command(scr, data, data->tfx_cmd);
 		else data->tfx_stage++;
 	}
 }
@@ -549,128 +784,126 @@ guchar vt_num(EmuData * data)
 
 /* Go to the next tab position */
 static
-void vt_tab(GtkWidget * widget)
+void vt_tab(VGAScreen * scr)
 {
-	EmuData * data;
 	int cols;
-	guchar x = vga_term_wherex(widget) + 1;
+	guchar x = vga_screen_wherex(scr) + 1;
 	
-	data = g_object_get_data(G_OBJECT(widget), "emu_data");
-	cols = vga_term_cols(widget);
+	cols = vga_screen_term_cols(scr);
 	if (x > cols)
 		x = cols;
 	else
 	while (x < cols && ((x-1) % 8 != 0))
 		x++;
-	vga_term_gotoxy(widget, x, vga_term_wherey(widget));
+	vga_screen_gotoxy(scr, x, vga_screen_wherey(scr));
 }
 
 static
-void vt_process_attr(GtkWidget * widget, EmuData * data, guchar c)
+void vt_process_attr(VGAScreen * scr, EmuData * data, guchar c)
 {
 	switch (c)
 	{
 		case 0:
-			vga_term_set_attr(widget, 0x07);
+			vga_screen_set_attr(scr, 0x07);
 			data->vt_attr = AVT_DEFAULT;
 			break;
 		case 1:
-			vga_term_set_attr(widget,
-					BRIGHT(vga_term_get_attr(widget)));
+			vga_screen_set_attr(scr,
+					BRIGHT(vga_screen_get_attr(scr)));
 			data->vt_attr = data->vt_attr | AVT_BOLD;
 			if (AVT_REVERSE & data->vt_attr ||
 				       AVT_ULINE & data->vt_attr)
 			{
-				vga_term_set_attr(widget,
+				vga_screen_set_attr(scr,
 					get_vt_color_attr(data->vt_attr));
 			}
 			break;
 		case 2:
 			data->vt_attr = data->vt_attr | AVT_LOWINT;
-			vga_term_set_attr(widget,
+			vga_screen_set_attr(scr,
 					get_vt_color_attr(data->vt_attr));
 			break;
 		case 4:
 			data->vt_attr = data->vt_attr | AVT_ULINE;
-			vga_term_set_attr(widget,
+			vga_screen_set_attr(scr,
 					get_vt_color_attr(data->vt_attr));
 			break;
 		case 5:
 			data->vt_attr = data->vt_attr | AVT_BLINK;
-			vga_term_set_attr(widget,
+			vga_screen_set_attr(scr,
 					get_vt_color_attr(data->vt_attr));
 			break;
 		case 7:
 			data->vt_attr = data->vt_attr | AVT_REVERSE;
-			vga_term_set_attr(widget,
+			vga_screen_set_attr(scr,
 					get_vt_color_attr(data->vt_attr));
 			break;
 		case 8:
 			data->vt_attr = data->vt_attr | AVT_INVIS;
-			vga_term_set_attr(widget,
+			vga_screen_set_attr(scr,
 					get_vt_color_attr(data->vt_attr));
 			break;
 		case 30:
-			vga_term_set_attr(widget,
-					(vga_term_get_attr(widget) & 0xF8)+0);
+			vga_screen_set_attr(scr,
+					(vga_screen_get_attr(scr) & 0xF8)+0);
 			break;
 		case 31:
-			vga_term_set_attr(widget,
-					(vga_term_get_attr(widget) & 0xF8)+4);
+			vga_screen_set_attr(scr,
+					(vga_screen_get_attr(scr) & 0xF8)+4);
 			break;
 		case 32:
-			vga_term_set_attr(widget,
-					(vga_term_get_attr(widget) & 0xF8)+2);
+			vga_screen_set_attr(scr,
+					(vga_screen_get_attr(scr) & 0xF8)+2);
 			break;
 		case 33:
-			vga_term_set_attr(widget,
-					(vga_term_get_attr(widget) & 0xF8)+6);
+			vga_screen_set_attr(scr,
+					(vga_screen_get_attr(scr) & 0xF8)+6);
 			break;
 		case 34:
-			vga_term_set_attr(widget,
-					(vga_term_get_attr(widget) & 0xF8)+1);
+			vga_screen_set_attr(scr,
+					(vga_screen_get_attr(scr) & 0xF8)+1);
 			break;
 		case 35:
-			vga_term_set_attr(widget,
-					(vga_term_get_attr(widget) & 0xF8)+5);
+			vga_screen_set_attr(scr,
+					(vga_screen_get_attr(scr) & 0xF8)+5);
 			break;
 		case 36:
-			vga_term_set_attr(widget,
-					(vga_term_get_attr(widget) & 0xF8)+3);
+			vga_screen_set_attr(scr,
+					(vga_screen_get_attr(scr) & 0xF8)+3);
 			break;
 		case 37:
-			vga_term_set_attr(widget,
-					(vga_term_get_attr(widget) & 0xF8)+7);
+			vga_screen_set_attr(scr,
+					(vga_screen_get_attr(scr) & 0xF8)+7);
 			break;
 		case 40:
-			vga_term_set_bg(widget, 0);
+			vga_screen_set_bg(scr, 0);
 			break;
 		case 41:
-			vga_term_set_bg(widget, 4);
+			vga_screen_set_bg(scr, 4);
 			break;
 		case 42:
-			vga_term_set_bg(widget, 2);
+			vga_screen_set_bg(scr, 2);
 			break;
 		case 43:
-			vga_term_set_bg(widget, 6);
+			vga_screen_set_bg(scr, 6);
 			break;
 		case 44:
-			vga_term_set_bg(widget, 1);
+			vga_screen_set_bg(scr, 1);
 			break;
 		case 45:
-			vga_term_set_bg(widget, 5);
+			vga_screen_set_bg(scr, 5);
 			break;
 		case 46:
-			vga_term_set_bg(widget, 3);
+			vga_screen_set_bg(scr, 3);
 			break;
 		case 47:
-			vga_term_set_bg(widget, 7);
+			vga_screen_set_bg(scr, 7);
 			break;
 	}
 }
 
 static
-void vt_out(GtkWidget * widget, EmuData * data, guchar c)
+void vt_out(VGAScreen * scr, EmuData * data, guchar c)
 {
 	int x;
 
@@ -684,62 +917,62 @@ void vt_out(GtkWidget * widget, EmuData * data, guchar c)
 				vt_init(data);
 				break;
 			case 'D':
-				vga_term_inslines(widget,
-						vga_term_wherey(widget), 1);
+				vga_screen_inslines(scr,
+						vga_screen_wherey(scr), 1);
 				vt_reset(data);
 				break;
 			case 'M':
-				vga_term_dellines(widget,
-						vga_term_wherey(widget), 1);
+				vga_screen_dellines(scr,
+						vga_screen_wherey(scr), 1);
 				vt_reset(data);
-				vga_term_gotoxy(widget, 1,1);
+				vga_screen_gotoxy(scr, 1,1);
 				break;
 			case 'E':
-				vga_term_writec(widget, 10);
+				vga_screen_writec(scr, 10);
 				break;
 			case '7':
-				data->vt_save_x = vga_term_wherex(widget);
-				data->vt_save_y = vga_term_wherey(widget);
-				data->vt_save_attr = vga_term_get_attr(widget);
+				data->vt_save_x = vga_screen_wherex(scr);
+				data->vt_save_y = vga_screen_wherey(scr);
+				data->vt_save_attr = vga_screen_get_attr(scr);
 				vt_reset(data);
 				break;
 			case '8':
-				vga_term_gotoxy(widget, data->vt_save_x,
+				vga_screen_gotoxy(scr, data->vt_save_x,
 						data->vt_save_y);
-				vga_term_set_attr(widget, data->vt_save_attr);
+				vga_screen_set_attr(scr, data->vt_save_attr);
 				vt_reset(data);
 				break;
 			case 'A':
-				vga_term_gotoxy(widget,
-						vga_term_wherex(widget),
-						vga_term_wherey(widget)-1);
+				vga_screen_gotoxy(scr,
+						vga_screen_wherex(scr),
+						vga_screen_wherey(scr)-1);
 				vt_reset(data);
 				break;
 			case 'B':
-				vga_term_gotoxy(widget,
-						vga_term_wherex(widget),
-						vga_term_wherey(widget)+1);
+				vga_screen_gotoxy(scr,
+						vga_screen_wherex(scr),
+						vga_screen_wherey(scr)+1);
 				vt_reset(data);
 				break;
 			case 'C':
-				vga_term_gotoxy(widget,
-						vga_term_wherex(widget)+1,
-						vga_term_wherey(widget));
+				vga_screen_gotoxy(scr,
+						vga_screen_wherex(scr)+1,
+						vga_screen_wherey(scr));
 				vt_reset(data);
 				break;
 			/*case 'D':   not sure if this is standard
-				vga_term_gotoxy(widget,
-						vga_term_wherex(widget)-1,
-						vga_term_wherey(widget));
+				vga_screen_gotoxy(scr,
+						vga_screen_wherex(scr)-1,
+						vga_screen_wherey(scr));
 				vt_reset(data);
 				break;
 				*/
 			case 'H':
-				vga_term_gotoxy(widget, 1, 1);
+				vga_screen_gotoxy(scr, 1, 1);
 				vt_reset(data);
 				break;
 			case 'K':
-				vga_term_clreol(widget);
+				vga_screen_clreol(scr);
 				vt_reset(data);
 				break;
 			case '(':
@@ -764,7 +997,7 @@ void vt_out(GtkWidget * widget, EmuData * data, guchar c)
 					g_string_assign(data->vt_code, "0");
 				while (data->vt_code->len > 0)
 				{
-					vt_process_attr(widget, data,
+					vt_process_attr(scr, data,
 							vt_num(data));
 					vt_reset(data);
 				}
@@ -773,45 +1006,45 @@ void vt_out(GtkWidget * widget, EmuData * data, guchar c)
 				x = vt_num(data);
 				if (x == 0)
 					x = 1;
-				vga_term_gotoxy(widget,
-						vga_term_wherex(widget),
-						vga_term_wherey(widget)-x);
+				vga_screen_gotoxy(scr,
+						vga_screen_wherex(scr),
+						vga_screen_wherey(scr)-x);
 				vt_reset(data);
 				break;
 			case 'B':
 				x = vt_num(data);
 				if (x == 0)
 					x = 1;
-				vga_term_gotoxy(widget,
-						vga_term_wherex(widget),
-						vga_term_wherey(widget)+x);
+				vga_screen_gotoxy(scr,
+						vga_screen_wherex(scr),
+						vga_screen_wherey(scr)+x);
 				vt_reset(data);
 				break;
 			case 'C':
 				x = vt_num(data);
 				if (x == 0)
 					x = 1;
-				vga_term_gotoxy(widget,
-						vga_term_wherex(widget)+x,
-						vga_term_wherey(widget));
+				vga_screen_gotoxy(scr,
+						vga_screen_wherex(scr)+x,
+						vga_screen_wherey(scr));
 				vt_reset(data);
 				break;
 			case 'D':
 				x = vt_num(data);
 				if (x == 0)
 					x = 1;
-				vga_term_gotoxy(widget,
-						vga_term_wherex(widget)-x,
-						vga_term_wherey(widget));
+				vga_screen_gotoxy(scr,
+						vga_screen_wherex(scr)-x,
+						vga_screen_wherey(scr));
 				vt_reset(data);
 				break;
 			case 'H':
 			case 'f':
 				x = vt_num(data);
 				if (x == 0)
-					vga_term_gotoxy(widget, 1, 1);
+					vga_screen_gotoxy(scr, 1, 1);
 				else
-					vga_term_gotoxy(widget,
+					vga_screen_gotoxy(scr,
 							vt_num(data), x);
 				vt_reset(data);
 				break;
@@ -819,27 +1052,27 @@ void vt_out(GtkWidget * widget, EmuData * data, guchar c)
 				switch (vt_num(data))
 				{
 					case 0: 
-						vga_term_clrdown(widget);
+						vga_screen_clrdown(scr);
 						break;
 					case 1: 
-						vga_term_clrup(widget);
+						vga_screen_clrup(scr);
 						break;
 					case 2:
-						vga_term_clrscr(widget);
+						vga_screen_clrscr(scr);
 						break;
 				}
 				vt_reset(data);
 				break;
 			case 'K':
 				if (vt_num(data) == 0)
-					vga_term_clreol(widget);
+					vga_screen_clreol(scr);
 				vt_reset(data);
 				break;
 			case 'r':
-				vga_term_window(widget, 1,
+				vga_screen_window(scr, 1,
 						vt_num(data), 80,
 						vt_num(data));
-				vga_term_gotoxy(widget, 1, 1);
+				vga_screen_gotoxy(scr, 1, 1);
 				vt_reset(data);
 				break;
 			default:
@@ -860,14 +1093,14 @@ void vt_out(GtkWidget * widget, EmuData * data, guchar c)
 			data->vt_cmd = 1;
 			break;
 		case 9:
-			vt_tab(widget);
+			vt_tab(scr);
 			break;
 		case 12:
-			vga_term_clrscr(widget);
+			vga_screen_clrscr(scr);
 			break;
 		case '[':
 			data->vt_buf[2] = '[';
-			vga_term_writec(widget, c);
+			vga_screen_writec(scr, c);
 			break;
 		case 15:
 			/* ??? */
@@ -875,23 +1108,23 @@ void vt_out(GtkWidget * widget, EmuData * data, guchar c)
 		case 2:
 			/* Toggle bold attribute */
 			data->vt_attr = data->vt_attr ^ AVT_BOLD;
-			vga_term_set_attr(widget,
+			vga_screen_set_attr(scr,
 					get_vt_color_attr(data->vt_attr));
 			break;
 		case 22:
 			/* Toggle reverse video attribute */
 			data->vt_attr = data->vt_attr ^ AVT_REVERSE;
-			vga_term_set_attr(widget,
+			vga_screen_set_attr(scr,
 					get_vt_color_attr(data->vt_attr));
 			break;
 		case 31:
 			/* Toggle underline attribute */
 			data->vt_attr = data->vt_attr ^ AVT_ULINE;
-			vga_term_set_attr(widget,
+			vga_screen_set_attr(scr,
 					get_vt_color_attr(data->vt_attr));
 			break;
 		default:
-			vga_term_writec(widget, c);
+			vga_screen_writec(scr, c);
 	}
 }
 
@@ -911,11 +1144,11 @@ void ansi_init(EmuData * data)
 }
 
 static
-void ansi_detect_reply(GtkWidget * widget)
+void ansi_detect_reply(VGAScreen * scr)
 {
 	guchar str[8];
 	g_snprintf(str, 8, "\033[%d;%dR",
-			vga_term_wherey(widget), vga_term_wherex(widget));
+			vga_screen_wherey(scr), vga_screen_wherex(scr));
 #if 0 // JJS - just removing termix function until i figure out if it is needed
 	termix_send_data(str, strlen(str));
 #endif
@@ -923,7 +1156,7 @@ void ansi_detect_reply(GtkWidget * widget)
 
 
 static
-void ansi_cmd(GtkWidget * widget, EmuData * data, guchar c)
+void ansi_cmd(VGAScreen * scr, EmuData * data, guchar c)
 {
 	int col, y;
 	guchar attr;
@@ -940,7 +1173,7 @@ void ansi_cmd(GtkWidget * widget, EmuData * data, guchar c)
 			break;
 		case 'm':
 			data->ansi_esc = 0;
-			attr = vga_term_get_attr(widget);
+			attr = vga_screen_get_attr(scr);
 			if (data->ansi_code->len == 0)
 				g_string_assign(data->ansi_code, "0");
 			while (data->ansi_code->len > 0)
@@ -1012,13 +1245,13 @@ void ansi_cmd(GtkWidget * widget, EmuData * data, guchar c)
 						break;
 				}
 			}
-			vga_term_set_attr(widget, attr);
+			vga_screen_set_attr(scr, attr);
 			break;
 		case 'H':
 		case 'f':
 			data->ansi_esc = 0;
 			y = emu_parse_num(data->ansi_code);
-			vga_term_gotoxy(widget, 
+			vga_screen_gotoxy(scr, 
 					emu_parse_num(data->ansi_code), y);
 			break;
 		case 'A':
@@ -1026,56 +1259,56 @@ void ansi_cmd(GtkWidget * widget, EmuData * data, guchar c)
 			y = emu_parse_num(data->ansi_code);
 			if (y == 0)
 				y = 1;
-			y = vga_term_wherey(widget) - y;
-			vga_term_gotoxy(widget,
-					vga_term_wherex(widget), y);
+			y = vga_screen_wherey(scr) - y;
+			vga_screen_gotoxy(scr,
+					vga_screen_wherex(scr), y);
 			break;
 		case 'B':
 			data->ansi_esc = 0;
 			y = emu_parse_num(data->ansi_code);
 			if (y == 0)
 				y = 1;
-			y += vga_term_wherey(widget);
-			vga_term_gotoxy(widget, vga_term_wherex(widget), y);
+			y += vga_screen_wherey(scr);
+			vga_screen_gotoxy(scr, vga_screen_wherex(scr), y);
 			break;
 		case 'C':
 			data->ansi_esc = 0;
 			y = emu_parse_num(data->ansi_code);
 			if (y == 0)
 				y = 1;
-			y += vga_term_wherex(widget);
-			vga_term_gotoxy(widget, y, vga_term_wherey(widget));
+			y += vga_screen_wherex(scr);
+			vga_screen_gotoxy(scr, y, vga_screen_wherey(scr));
 			break;
 		case 'D':
 			data->ansi_esc = 0;
 			y = emu_parse_num(data->ansi_code);
 			if (y == 0)
 				y = 1;
-			y = vga_term_wherex(widget) - y;
-			vga_term_gotoxy(widget, y, vga_term_wherey(widget));
+			y = vga_screen_wherex(scr) - y;
+			vga_screen_gotoxy(scr, y, vga_screen_wherey(scr));
 			break;
 		case 's':
 			data->ansi_esc = 0;
-			data->ansi_save_x = vga_term_wherex(widget);
-			data->ansi_save_y = vga_term_wherey(widget);
+			data->ansi_save_x = vga_screen_wherex(scr);
+			data->ansi_save_y = vga_screen_wherey(scr);
 			break;
 		case 'u':
 			data->ansi_esc = 0;
-			vga_term_gotoxy(widget, data->ansi_save_x,
+			vga_screen_gotoxy(scr, data->ansi_save_x,
 					data->ansi_save_y);
 			break;
 		case 'J':
 			data->ansi_esc = 0;
-			vga_term_clrscr(widget);
+			vga_screen_clrscr(scr);
 			break;
 		case 'K':
 			data->ansi_esc = 0;
-			vga_term_clreol(widget);
+			vga_screen_clreol(scr);
 			break;
 		case 'n':
 			data->ansi_esc = 0;
 #if 0 // JJS - not sure what this does, but it relies on a termix function
-			ansi_detect_reply(widget);
+			ansi_detect_reply(scr);
 #endif
 			break;
 		default:
@@ -1083,11 +1316,21 @@ void ansi_cmd(GtkWidget * widget, EmuData * data, guchar c)
 	}
 }
 
-void vga_term_emu_writec(GtkWidget * widget, guchar c)
+/**
+ * vga_emu_writec:
+ * @data: Emulator
+ * @c: Character to process
+ *
+ * Run a character through the emulator.  This only updates the screen
+ * model; drawing is up to whoever owns the screen.
+ */
+static
+void emu_writec(EmuData * data, guchar c)
 {
-	EmuData * data;
-	gchar * s;
-	data = g_object_get_data(G_OBJECT(widget), "emu_data");
+	VGAScreen * scr;
+	guchar z;
+
+	scr = data->screen;
 
 	/*
 	if (c > 31 && c < 127)
@@ -1103,10 +1346,10 @@ void vga_term_emu_writec(GtkWidget * widget, guchar c)
 
 	/* vt100 is exclusive */
 	if (data->vt100)
-		vt_out(widget, data, c);
+		vt_out(scr, data, c);
 	else
 	if (data->tfx_stage > 0)
-		tfx_out(widget, data, c);
+		tfx_out(scr, data, c);
 	else
 	if (data->avt_cmd == 100)
 	{
@@ -1118,9 +1361,8 @@ void vga_term_emu_writec(GtkWidget * widget, guchar c)
 		else
 		if (data->avt_stage == 2)
 		{
-			s = g_strnfill(c, data->avt_par1);
-			vga_term_write(widget, s);
-			g_free(s);
+			for (z = 0; z < data->avt_par1; z++)
+				vga_screen_writec(scr, c);
 			data->avt_cmd = 0;
 		}
 	}
@@ -1140,13 +1382,13 @@ void vga_term_emu_writec(GtkWidget * widget, guchar c)
 				{
 					data->ansi_esc = 0;
 					data->tfx_stage = 0;
-					tfx_out(widget, data, c);
+					tfx_out(scr, data, c);
 				}
 				else
 					data->ansi_esc = 0;
 				break;
 			case 2:
-				ansi_cmd(widget, data, c);
+				ansi_cmd(scr, data, c);
 				break;
 			default:
 				data->ansi_esc = 0;
@@ -1159,7 +1401,7 @@ void vga_term_emu_writec(GtkWidget * widget, guchar c)
 		switch (data->avt_cmd)
 		{
 			case 2:
-				vga_term_set_attr(widget, c);
+				vga_screen_set_attr(scr, c);
 				data->avt_cmd = 0;
 				break;
 			case 3:
@@ -1170,14 +1412,17 @@ void vga_term_emu_writec(GtkWidget * widget, guchar c)
 						data->avt_stage++;
 						break;
 					case 2:
+						/* ^V^H row col */
 						data->avt_par2 = c;
-						vga_term_gotoxy(widget,
-								data->avt_par1,
-								data->avt_par2);
+						vga_screen_gotoxy(scr,
+								data->avt_par2,
+								data->avt_par1);
 						data->avt_cmd = 0;
+						break;
 					default:
 						data->avt_cmd = 0;
 				}
+				break;
 			default:
 				data->avt_cmd = 0;
 		}
@@ -1192,36 +1437,36 @@ void vga_term_emu_writec(GtkWidget * widget, guchar c)
 				data->avt_stage = 1;
 				break;
 			case 2:
-				vga_term_set_attr(widget,
-					BLINK(vga_term_get_attr(widget)));
+				vga_screen_set_attr(scr,
+					BLINK(vga_screen_get_attr(scr)));
 				data->avt_cmd = 0;
 				break;
 			case 3:
-				vga_term_gotoxy(widget,
-						vga_term_wherex(widget),
-						vga_term_wherey(widget) - 1);
+				vga_screen_gotoxy(scr,
+						vga_screen_wherex(scr),
+						vga_screen_wherey(scr) - 1);
 				data->avt_cmd = 0;
 				break;
 			case 4:
-				vga_term_gotoxy(widget,
-						vga_term_wherex(widget),
-						vga_term_wherey(widget) + 1);
+				vga_screen_gotoxy(scr,
+						vga_screen_wherex(scr),
+						vga_screen_wherey(scr) + 1);
 				data->avt_cmd = 0;
 				break;
 			case 5:
-				vga_term_gotoxy(widget,
-						vga_term_wherex(widget) - 1,
-						vga_term_wherey(widget));
+				vga_screen_gotoxy(scr,
+						vga_screen_wherex(scr) - 1,
+						vga_screen_wherey(scr));
 				data->avt_cmd = 0;
 				break;
 			case 6:
-				vga_term_gotoxy(widget,
-						vga_term_wherex(widget),
-						vga_term_wherey(widget) + 1);
+				vga_screen_gotoxy(scr,
+						vga_screen_wherex(scr) + 1,
+						vga_screen_wherey(scr));
 				data->avt_cmd = 0;
 				break;
 			case 7:
-				vga_term_clreol(widget);
+				vga_screen_clreol(scr);
 				data->avt_cmd = 0;
 				break;
 			case 8:
@@ -1256,38 +1501,467 @@ void vga_term_emu_writec(GtkWidget * widget, guchar c)
 				data->ansi_esc = 1;
 				break;
 			case 9:
-				vt_tab(widget);
+				vt_tab(scr);
 				break;
 			case 12:
-				vga_term_clrscr(widget);
+				vga_screen_clrscr(scr);
 				break;
 			default:
-				//g_print("vga_term_writec(widget, %c); ", c);
-				vga_term_writec(widget, c);
+				//g_print("vga_screen_writec(scr, %c); ", c);
+				vga_screen_writec(scr, c);
 				//g_print("done\n");
 		}
 	}
 }
 
-void vga_term_emu_write(GtkWidget * widget, gchar * s)
+void vga_emu_writec(EmuData * data, guchar c)
 {
-	int i = 0;
+	g_return_if_fail(data != NULL);
+
+	if (data->recorder)
+		vga_recorder_feed(data->recorder, data, &c, 1);
+	emu_writec(data, c);
+}
+
+void vga_emu_write(EmuData * data, const guchar * buf, gsize len)
+{
+	gsize i;
+
+	g_return_if_fail(data != NULL);
+
+	if (data->recorder)
+		vga_recorder_feed(data->recorder, data, buf, len);
+
 	/* FIXME: Could optimize out some unnecessary cursor movement */
-	while (s[i])
-		vga_term_emu_writec(widget, s[i++]);
+	for (i = 0; i < len; i++)
+		emu_writec(data, buf[i]);
+}
+
+/**
+ * vga_emu_set_recorder:
+ * @emu: Emulator
+ * @rec: Recorder, or NULL to stop recording
+ *
+ * Record everything @emu parses from now on.  A keyframe of the current
+ * state is taken first, so the recording can be played back from its
+ * start.  The recorder still belongs to the caller.
+ */
+void vga_emu_set_recorder(EmuData * emu, VGARecorder * rec)
+{
+	g_return_if_fail(emu != NULL);
+
+	emu->recorder = rec;
+	if (rec)
+		vga_recorder_keyframe(rec, emu->screen, emu);
+}
+
+
+/*************************************
+ * VGATerm widget methods
+ *************************************/
+
+/*
+ * Input that isn't parsed right away (from the ring, or from writes in
+ * streaming mode) is parsed in slices of at most stream->budget seconds
+ * from a default priority idle, so input events and redraws still get in
+ * between slices but otherwise parsing gets all the time there is.  What
+ * has been parsed is drawn once per EMU_FRAME_MS, and when the backlog
+ * runs out.
+ */
+#define EMU_DEFAULT_BUDGET	0.002
+#define EMU_SLICE_BYTES		4096	/* Check the clock this often */
+#define EMU_FRAME_MS		16
+#define EMU_FD_READ_SIZE	65536
+
+/* Widget-side state for feeding the emulator from the main loop */
+typedef struct
+{
+	GtkWidget * widget;
+	VGARing * ring;
+	gboolean streaming;
+	GQueue * pending;	/* GByteArrays queued in streaming mode */
+	gsize pending_pos;	/* Bytes of the first one already parsed */
+	gsize pending_bytes;
+	gdouble budget;		/* Seconds of parsing per slice */
+	GTimer * timer;
+	GTimer * frame;		/* Since the last draw */
+	guint drain_id;
+
+	/* File descriptor input */
+	int fd;			/* -1 if none */
+	VGAEmuFdFlags fd_flags;
+	GIOChannel * channel;
+	guint watch_id;		/* Only while waiting for more to read */
+	guchar * fd_buf;
+	guchar * map;		/* The whole file, if mapped */
+	gsize map_size;
+	const guchar * input;	/* Read or mapped, not yet parsed */
+	gsize input_len;
+	gsize input_pos;
+	gboolean fd_done;	/* Nothing more to read past the input */
+	goffset fd_left;	/* Art still to read before SAUCE, or -1 */
+	VGAEmuEofFunc eof_func;
+	gpointer eof_data;
+
+	guint morph_id;		/* Palette morph frame timeout */
+} EmuStream;
+
+static gboolean emu_stream_drain(gpointer user_data);
+static void emu_fd_finish(EmuStream * stream, gboolean eof);
+
+/* Draw the intermediate state of a command on the widget right away */
+static
+void emu_term_sync(EmuData * data, gpointer user_data)
+{
+	vga_term_update(GTK_WIDGET(user_data));
+}
+
+static EmuStream * emu_stream_get(GtkWidget * widget);
+
+/* One palette morph frame, paced like the streaming drain */
+static
+gboolean emu_term_morph_frame(gpointer user_data)
+{
+	EmuStream * stream = user_data;
+	EmuData * emu;
+	gboolean more;
+
+	emu = vga_term_emu_get_data(stream->widget);
+	if (vga_get_fast_forward(stream->widget))
+	{
+		vga_emu_morph_finish(emu);
+		more = FALSE;
+	}
+	else
+		more = vga_emu_morph_step(emu);
+
+	/* Only the cells showing colors that changed are redrawn */
+	vga_term_update(stream->widget);
+
+	if (!more)
+		stream->morph_id = 0;
+	return more;
+}
+
+static
+void emu_term_morph(EmuData * emu, gpointer user_data)
+{
+	GtkWidget * widget = user_data;
+	EmuStream * stream;
+
+	/* Nobody would see the frames */
+	if (vga_get_fast_forward(widget))
+	{
+		vga_emu_morph_finish(emu);
+		return;
+	}
+
+	stream = emu_stream_get(widget);
+	if (stream->morph_id == 0)
+		stream->morph_id = g_timeout_add(EMU_FRAME_MS,
+				emu_term_morph_frame, stream);
+}
+
+void vga_term_emu_init(GtkWidget * widget)
+{
+	EmuData * emu;
+
+	g_return_if_fail(widget != NULL);
+	g_return_if_fail(VGA_IS_TERM(widget));
+
+	/* Initialize extended widget properties */
+	emu = vga_emu_new(vga_get_screen(widget));
+	vga_emu_set_sync_func(emu, emu_term_sync, widget);
+	vga_emu_set_morph_func(emu, emu_term_morph, widget);
+	g_object_set_data_full(G_OBJECT(widget), "emu_data", emu,
+			(GDestroyNotify) vga_emu_destroy);
+}
+
+/* Get the emulator attached to the widget by vga_term_emu_init() */
+EmuData * vga_term_emu_get_data(GtkWidget * widget)
+{
+	g_return_val_if_fail(widget != NULL, NULL);
+
+	return g_object_get_data(G_OBJECT(widget), "emu_data");
+}
+
+static
+void emu_stream_free(EmuStream * stream)
+{
+	GByteArray * chunk;
+
+	emu_fd_finish(stream, FALSE);
+
+	/* Drop any drain still scheduled */
+	while (g_source_remove_by_user_data(stream))
+		;
+
+	while ((chunk = g_queue_pop_head(stream->pending)) != NULL)
+		g_byte_array_free(chunk, TRUE);
+	g_queue_free(stream->pending);
+
+	if (stream->ring)
+		vga_ring_destroy(stream->ring);
+	g_timer_destroy(stream->timer);
+	g_timer_destroy(stream->frame);
+	g_free(stream);
+}
+
+static
+EmuStream * emu_stream_get(GtkWidget * widget)
+{
+	EmuStream * stream;
+
+	stream = g_object_get_data(G_OBJECT(widget), "emu_stream");
+	if (stream == NULL)
+	{
+		stream = g_new0(EmuStream, 1);
+		stream->widget = widget;
+		stream->pending = g_queue_new();
+		stream->budget = EMU_DEFAULT_BUDGET;
+		stream->timer = g_timer_new();
+		stream->frame = g_timer_new();
+		stream->fd = -1;
+		stream->fd_left = -1;
+		g_object_set_data_full(G_OBJECT(widget), "emu_stream", stream,
+				(GDestroyNotify) emu_stream_free);
+	}
+
+	return stream;
+}
+
+/* Make sure a drain is on its way.  Main loop only. */
+static
+void emu_stream_schedule(EmuStream * stream)
+{
+	if (stream->drain_id == 0)
+		stream->drain_id = g_idle_add(emu_stream_drain, stream);
+}
+
+/*
+ * Get the next run of input to parse: queued writes first, then input from
+ * the fd, then the ring.  Returns its length.
+ */
+static
+gsize emu_stream_peek(EmuStream * stream, const guchar ** buf)
+{
+	GByteArray * chunk;
+
+	if ((chunk = g_queue_peek_head(stream->pending)) != NULL)
+	{
+		*buf = chunk->data + stream->pending_pos;
+		return chunk->len - stream->pending_pos;
+	}
+	if (stream->input_pos < stream->input_len)
+	{
+		*buf = stream->input + stream->input_pos;
+		return stream->input_len - stream->input_pos;
+	}
+	if (stream->ring)
+		return vga_ring_peek(stream->ring, buf);
+
+	return 0;
+}
+
+/* Drop @len bytes of what emu_stream_peek() returned */
+static
+void emu_stream_consume(EmuStream * stream, gsize len)
+{
+	GByteArray * chunk;
+
+	if ((chunk = g_queue_peek_head(stream->pending)) != NULL)
+	{
+		stream->pending_pos += len;
+		stream->pending_bytes -= len;
+		if (stream->pending_pos == chunk->len)
+		{
+			g_byte_array_free(g_queue_pop_head(stream->pending),
+					TRUE);
+			stream->pending_pos = 0;
+		}
+	}
+	else if (stream->input_pos < stream->input_len)
+		stream->input_pos += len;
+	else
+		vga_ring_consume(stream->ring, len);
+}
+
+static
+gboolean emu_stream_backlog(EmuStream * stream)
+{
+	const guchar * buf;
+
+	return emu_stream_peek(stream, &buf) > 0;
+}
+
+/* Parse a slice's worth of input, and draw if a frame is due */
+static
+void emu_stream_slice(EmuStream * stream)
+{
+	EmuData * data;
+	const guchar * buf;
+	gsize n;
+
+	data = vga_term_emu_get_data(stream->widget);
+
+	g_timer_start(stream->timer);
+	do
+	{
+		n = emu_stream_peek(stream, &buf);
+		if (n == 0)
+			break;
+		n = MIN(n, EMU_SLICE_BYTES);
+		vga_emu_write(data, buf, n);
+		emu_stream_consume(stream, n);
+	}
+	while (g_timer_elapsed(stream->timer, NULL) < stream->budget);
+
+	if (!emu_stream_backlog(stream) ||
+		g_timer_elapsed(stream->frame, NULL) * 1000 >=
+			EMU_FRAME_MS)
+	{
+		vga_term_update(stream->widget);
+		g_timer_start(stream->frame);
+	}
+}
+
+static gboolean emu_fd_readable(GIOChannel * channel, GIOCondition cond,
+		gpointer user_data);
+
+/* Wait for the fd again once everything read from it has been parsed */
+static
+void emu_fd_resume(EmuStream * stream)
+{
+	if (stream->channel && stream->watch_id == 0 && !stream->fd_done &&
+		stream->input_pos == stream->input_len)
+	{
+		stream->watch_id = g_io_add_watch(stream->channel,
+				G_IO_IN | G_IO_HUP | G_IO_ERR,
+				emu_fd_readable, stream);
+	}
+}
+
+static
+gboolean emu_stream_drain(gpointer user_data)
+{
+	EmuStream * stream = user_data;
+
+	emu_stream_slice(stream);
+
+	/* Keep going while there's a backlog */
+	if (emu_stream_backlog(stream))
+		return TRUE;
+
+	/* Otherwise sleep until more input comes */
+	stream->drain_id = 0;
+	emu_fd_resume(stream);
+	if (stream->ring && vga_ring_wait(stream->ring))
+		emu_stream_schedule(stream);
+
+	/* A mapped file, or one cut short by its EOF character, is done
+	 * once it has all been parsed.  This goes last, since the EOF
+	 * function may destroy the widget. */
+	if ((stream->map || stream->fd_done) &&
+		stream->input_pos == stream->input_len)
+		emu_fd_finish(stream, TRUE);
+
+	return FALSE;
+}
+
+/* Main loop side of the ring's notify function */
+static
+gboolean emu_stream_wake(gpointer user_data)
+{
+	emu_stream_schedule(user_data);
+	return FALSE;
+}
+
+/* Called on the producer's thread */
+static
+void emu_stream_notify(VGARing * ring, gpointer user_data)
+{
+	g_idle_add(emu_stream_wake, user_data);
+}
+
+/* Copy data onto the streaming mode queue */
+static
+void emu_stream_queue(EmuStream * stream, const guchar * data, gsize len)
+{
+	GByteArray * chunk;
+
+	if (len == 0)
+		return;
+
+	/* Small writes get merged into the last chunk */
+	chunk = g_queue_peek_tail(stream->pending);
+	if (chunk == NULL || chunk->len >= EMU_SLICE_BYTES)
+	{
+		chunk = g_byte_array_sized_new(MAX(len, EMU_SLICE_BYTES));
+		g_queue_push_tail(stream->pending, chunk);
+	}
+	g_byte_array_append(chunk, data, len);
+
+	stream->pending_bytes += len;
+	emu_stream_schedule(stream);
+}
+
+static
+EmuStream * emu_stream_if_streaming(GtkWidget * widget)
+{
+	EmuStream * stream;
+
+	stream = g_object_get_data(G_OBJECT(widget), "emu_stream");
+	return (stream && stream->streaming) ? stream : NULL;
+}
+
+void vga_term_emu_writec(GtkWidget * widget, guchar c)
+{
+	EmuData * data;
+	EmuStream * stream;
+
+	data = vga_term_emu_get_data(widget);
+	g_return_if_fail(data != NULL);
+
+	if ((stream = emu_stream_if_streaming(widget)) != NULL)
+	{
+		emu_stream_queue(stream, &c, 1);
+		return;
+	}
+
+	vga_emu_writec(data, c);
+	vga_term_update(widget);
+}
+
+void vga_term_emu_write(GtkWidget * widget, gchar * s)
+{
+	EmuData * data;
+	EmuStream * stream;
+
+	data = vga_term_emu_get_data(widget);
+	g_return_if_fail(data != NULL);
+
+	if ((stream = emu_stream_if_streaming(widget)) != NULL)
+	{
+		emu_stream_queue(stream, (guchar *) s, strlen(s));
+		return;
+	}
+
+	/* Only draw the end result of the whole string */
+	vga_emu_write(data, (guchar *) s, strlen(s));
+	vga_term_update(widget);
 }
 
 void vga_term_emu_writeln(GtkWidget * widget, gchar * s)
 {
 	vga_term_emu_write(widget, s);
-	vga_term_emu_writec(widget, 13);
-	vga_term_emu_writec(widget, 10);
+	vga_term_emu_write(widget, "\r\n");
 }
 
 int vga_term_emu_print(GtkWidget * widget, const gchar * format, ...)
 {
 	va_list args;
 	gchar * string;
+	int len;
 
 	g_return_val_if_fail(format != NULL, 0);
 
@@ -1297,8 +1971,347 @@ int vga_term_emu_print(GtkWidget * widget, const gchar * format, ...)
 
 	vga_term_emu_write(widget, string);
 
+	len = strlen(string);
 	g_free(string);
-	return strlen(string);
+	return len;
+}
+
+/**
+ * vga_term_emu_attach_ring:
+ * @widget: VGATerm widget, with vga_term_emu_init() already done
+ * @size: Size of the ring in bytes
+ *
+ * Give the terminal an input ring.  One other thread (the producer) may
+ * vga_ring_write() into it without any locking; the main loop parses what
+ * arrives whenever it is otherwise idle.  When the main loop falls behind
+ * the ring fills up and the producer's writes come up short.
+ *
+ * The producer must stop writing before the widget is destroyed.
+ *
+ * Returns: The ring, which belongs to the widget.
+ */
+VGARing * vga_term_emu_attach_ring(GtkWidget * widget, gsize size)
+{
+	EmuStream * stream;
+
+	g_return_val_if_fail(widget != NULL, NULL);
+	g_return_val_if_fail(vga_term_emu_get_data(widget) != NULL, NULL);
+
+	stream = emu_stream_get(widget);
+	g_return_val_if_fail(stream->ring == NULL, stream->ring);
+
+	stream->ring = vga_ring_new(size);
+	vga_ring_set_notify(stream->ring, emu_stream_notify, stream);
+
+	return stream->ring;
+}
+
+/*
+ * Read the next chunk from the fd.  The watch is removed until the chunk
+ * has been parsed, so a slow display pushes back on the writer instead of
+ * piling data up in memory.
+ */
+static
+gboolean emu_fd_readable(GIOChannel * channel, GIOCondition cond,
+		gpointer user_data)
+{
+	EmuStream * stream = user_data;
+	GIOStatus status;
+	GError * error = NULL;
+	gsize want = EMU_FD_READ_SIZE;
+	gsize n = 0;
+
+	/* Don't read into the SAUCE record */
+	if (stream->fd_left >= 0 && stream->fd_left < want)
+		want = stream->fd_left;
+
+	status = want ? g_io_channel_read_chars(channel,
+			(gchar *) stream->fd_buf, want, &n, &error) :
+		G_IO_STATUS_EOF;
+
+	if (stream->fd_left >= 0)
+	{
+		stream->fd_left -= n;
+		if (stream->fd_left == 0)
+		{
+			/* Leave out the EOF character before the record */
+			if (n > 0 && stream->fd_buf[n - 1] == VGA_SAUCE_EOF)
+				n--;
+			stream->fd_done = TRUE;
+			status = G_IO_STATUS_EOF;
+		}
+	}
+
+	if (n > 0)
+	{
+		stream->input = stream->fd_buf;
+		stream->input_len = n;
+		stream->input_pos = 0;
+		stream->watch_id = 0;
+		emu_stream_schedule(stream);
+		return FALSE;
+	}
+
+	switch (status)
+	{
+	case G_IO_STATUS_AGAIN:
+		return TRUE;
+	case G_IO_STATUS_ERROR:
+		g_warning("Error reading terminal input: %s", error->message);
+		g_error_free(error);
+		break;
+	default:
+		break;
+	}
+
+	/* EOF or error.  Returning FALSE takes care of the watch. */
+	stream->watch_id = 0;
+	emu_fd_finish(stream, TRUE);
+	return FALSE;
+}
+
+/* Let go of the fd, and call the EOF function if @eof */
+static
+void emu_fd_finish(EmuStream * stream, gboolean eof)
+{
+	VGAEmuEofFunc func;
+	gpointer data;
+
+	if (stream->fd < 0)
+		return;
+
+	if (stream->watch_id)
+		g_source_remove(stream->watch_id);
+	if (stream->channel)
+		g_io_channel_unref(stream->channel);
+	if (stream->map)
+		munmap(stream->map, stream->map_size);
+	if (stream->fd_flags & VGA_EMU_FD_CLOSE)
+		close(stream->fd);
+	g_free(stream->fd_buf);
+
+	func = stream->eof_func;
+	data = stream->eof_data;
+
+	stream->fd = -1;
+	stream->channel = NULL;
+	stream->watch_id = 0;
+	stream->map = NULL;
+	stream->fd_buf = NULL;
+	stream->input = NULL;
+	stream->input_len = stream->input_pos = 0;
+	stream->fd_done = FALSE;
+	stream->fd_left = -1;
+	stream->eof_func = NULL;
+
+	if (eof && func)
+		func(stream->widget, data);
+}
+
+/* Map a regular file from the current offset on.  FALSE if we can't. */
+static
+gboolean emu_fd_map(EmuStream * stream)
+{
+	struct stat st;
+	off_t offset;
+	void * map;
+
+	if (fstat(stream->fd, &st) < 0 || !S_ISREG(st.st_mode) ||
+		st.st_size == 0 || (guint64) st.st_size > G_MAXSIZE)
+		return FALSE;
+
+	offset = lseek(stream->fd, 0, SEEK_CUR);
+	if (offset < 0 || offset > st.st_size)
+		return FALSE;
+
+	map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, stream->fd, 0);
+	if (map == MAP_FAILED)
+		return FALSE;
+
+	stream->map = map;
+	stream->map_size = st.st_size;
+	stream->input = stream->map;
+	stream->input_len = st.st_size;
+	stream->input_pos = offset;
+
+	return TRUE;
+}
+
+/**
+ * vga_term_emu_attach_fd_full:
+ * @widget: VGATerm widget, with vga_term_emu_init() already done
+ * @fd: File descriptor to read terminal output from
+ * @flags: #VGAEmuFdFlags
+ * @eof_func: Function to call at end of file, or NULL
+ * @user_data: Data for @eof_func
+ *
+ * Feed everything read from @fd to the emulator.  The fd is switched to
+ * non-blocking mode and read in large chunks from the main loop, which
+ * parses them in idle time like streaming mode does.  No more is read
+ * until the last chunk has been parsed, so a pipe fills up and blocks the
+ * writer if the display can't keep up.
+ *
+ * With %VGA_EMU_FD_MMAP, a regular file is mapped and parsed in place
+ * instead of being read, from the current file offset to the end.  Pipes,
+ * ttys and sockets are read as usual.
+ *
+ * With %VGA_EMU_FD_SAUCE, the input is taken to be an art file.  If it's
+ * a regular file with a SAUCE record, the widget is set up for the art
+ * with vga_sauce_apply() before anything is parsed, and parsing stops
+ * before the record and the EOF character just ahead of it.  Input with
+ * no record is parsed to the end.
+ *
+ * At end of file (or on a read error) the fd is detached and @eof_func is
+ * called.  It may attach another fd.
+ *
+ * Returns: FALSE if an fd is already attached
+ */
+gboolean vga_term_emu_attach_fd_full(GtkWidget * widget, int fd,
+		VGAEmuFdFlags flags, VGAEmuEofFunc eof_func,
+		gpointer user_data)
+{
+	EmuStream * stream;
+	VGASauce sauce;
+	off_t offset;
+
+	g_return_val_if_fail(widget != NULL, FALSE);
+	g_return_val_if_fail(vga_term_emu_get_data(widget) != NULL, FALSE);
+	g_return_val_if_fail(fd >= 0, FALSE);
+
+	stream = emu_stream_get(widget);
+	g_return_val_if_fail(stream->fd < 0, FALSE);
+
+	stream->fd = fd;
+	stream->fd_flags = flags;
+	stream->eof_func = eof_func;
+	stream->eof_data = user_data;
+	stream->fd_left = -1;
+
+	if ((flags & VGA_EMU_FD_SAUCE) && vga_sauce_read_fd(fd, &sauce))
+	{
+		vga_sauce_apply(&sauce, widget, NULL);
+		offset = lseek(fd, 0, SEEK_CUR);
+		if (offset >= 0)
+			stream->fd_left = MAX(0, (goffset) sauce.data_len - offset);
+	}
+
+	if ((flags & VGA_EMU_FD_MMAP) && emu_fd_map(stream))
+	{
+		if (flags & VGA_EMU_FD_SAUCE)
+			stream->input_len = MAX(stream->input_pos,
+				vga_sauce_content_length(stream->map,
+						stream->map_size));
+
+		/* All of it is already here, just parse it */
+		emu_stream_schedule(stream);
+		return TRUE;
+	}
+
+	stream->fd_buf = g_malloc(EMU_FD_READ_SIZE);
+	stream->channel = g_io_channel_unix_new(fd);
+	g_io_channel_set_encoding(stream->channel, NULL, NULL);
+	g_io_channel_set_buffered(stream->channel, FALSE);
+	g_io_channel_set_flags(stream->channel, G_IO_FLAG_NONBLOCK, NULL);
+	emu_fd_resume(stream);
+
+	return TRUE;
+}
+
+/* Attach @fd with no flags and no EOF function */
+gboolean vga_term_emu_attach_fd(GtkWidget * widget, int fd)
+{
+	return vga_term_emu_attach_fd_full(widget, fd, 0, NULL, NULL);
+}
+
+/* Stop reading from the attached fd, dropping anything not yet parsed */
+void vga_term_emu_detach_fd(GtkWidget * widget)
+{
+	EmuStream * stream;
+
+	g_return_if_fail(widget != NULL);
+
+	stream = g_object_get_data(G_OBJECT(widget), "emu_stream");
+	if (stream)
+		emu_fd_finish(stream, FALSE);
+}
+
+/**
+ * vga_term_emu_set_streaming:
+ * @widget: VGATerm widget, with vga_term_emu_init() already done
+ * @streaming: Whether to use streaming mode
+ *
+ * In streaming mode vga_term_emu_write() and friends only queue their
+ * input and return.  The main loop parses it in time-bounded slices and
+ * draws what it has got to once a frame, so a big write doesn't freeze
+ * the window and most intermediate screens are never drawn.
+ *
+ * Turning streaming off parses whatever is still queued.
+ */
+void vga_term_emu_set_streaming(GtkWidget * widget, gboolean streaming)
+{
+	EmuStream * stream;
+
+	g_return_if_fail(widget != NULL);
+	g_return_if_fail(vga_term_emu_get_data(widget) != NULL);
+
+	stream = emu_stream_get(widget);
+	stream->streaming = streaming;
+	if (!streaming)
+		vga_term_emu_flush(widget);
+}
+
+/**
+ * vga_term_emu_set_budget:
+ * @widget: VGATerm widget
+ * @usec: Microseconds of parsing per slice
+ *
+ * Set how long each slice of parsing queued input may take (default
+ * 2000).  Slices run whenever the main loop has nothing else to do, so
+ * this is how long input and redraws may have to wait.  Larger values
+ * cost less per slice; smaller ones keep the widget more responsive.
+ */
+void vga_term_emu_set_budget(GtkWidget * widget, guint usec)
+{
+	g_return_if_fail(widget != NULL);
+	g_return_if_fail(usec > 0);
+
+	emu_stream_get(widget)->budget = usec / 1000000.0;
+}
+
+/* Parse everything that is queued right now, then draw */
+void vga_term_emu_flush(GtkWidget * widget)
+{
+	EmuStream * stream;
+	EmuData * data;
+	const guchar * buf;
+	gsize n;
+
+	g_return_if_fail(widget != NULL);
+
+	stream = g_object_get_data(G_OBJECT(widget), "emu_stream");
+	if (stream == NULL)
+		return;
+	data = vga_term_emu_get_data(widget);
+
+	while ((n = emu_stream_peek(stream, &buf)) > 0)
+	{
+		vga_emu_write(data, buf, n);
+		emu_stream_consume(stream, n);
+	}
+
+	vga_term_update(widget);
+	emu_fd_resume(stream);
+}
+
+/* Number of bytes queued in streaming mode but not yet parsed */
+gsize vga_term_emu_pending(GtkWidget * widget)
+{
+	EmuStream * stream;
+
+	g_return_val_if_fail(widget != NULL, 0);
+
+	stream = g_object_get_data(G_OBJECT(widget), "emu_stream");
+	return stream ? stream->pending_bytes : 0;
 }
 
 gchar * vga_term_emu_vtkey(GtkWidget * widget, guchar c)
@@ -0,0 +1,71 @@
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of version 2 of the GNU General Public License as
+ *  published by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ *****************************************************************************
+ *
+ *  The emulator's internals, shared by the files in src/ that need to save
+ *  or restore its state.  Not installed.
+ */
+
+#ifndef __EMU_PRIVATE_H__
+#define __EMU_PRIVATE_H__
+
+#include "emulation.h"
+#include "vgarecord.h"
+
+#define TFX_NUM_UPALS	3
+#define TFX_GLYPH_BYTES	16	/* TextFX fonts are 8x16 */
+#define TFX_PARAM_MAX	(2 + 256 * TFX_GLYPH_BYTES)	/* 'G', every glyph */
+
+struct _EmuData
+{
+	VGAScreen * screen;	/* Where output goes */
+	EmuSyncFunc sync_func;	/* Called to show intermediate states */
+	gpointer sync_data;
+	VGARecorder * recorder;	/* Gets a copy of all input, or NULL */
+
+	/* Individual emulation enablers */
+	gboolean ansi, vt100, avatar, textfx;
+	
+	int tfx_stage;
+	guchar tfx_param[TFX_PARAM_MAX];
+	guchar tfx_cmd;
+	int tfx_num;		/* param length for tfx_cmd */
+	guchar tfx_def_attr;
+	guchar tfx_save_x, tfx_save_y, tfx_save_attr;
+	VGAPalette * tfx_user_pal[TFX_NUM_UPALS];
+
+	/* Palette morph in progress */
+	VGAPalette * morph_to;	/* NULL if none */
+	int morph_left;		/* Steps to go */
+	int morph_stride;	/* Steps per frame */
+	EmuMorphFunc morph_func;
+	gpointer morph_data;
+
+	GString * ansi_code;
+	guchar ansi_save_x, ansi_save_y;
+	guchar ansi_esc;
+	
+	guchar avt_cmd, avt_stage, avt_par1, avt_par2;
+
+	GString * vt_code;
+	guchar vt_stage, vt_cmd, vt_save_x, vt_save_y, vt_save_attr;
+	guchar vt_attr;
+	guchar vt_buf[3];
+
+};
+
+int emu_tfx_param_len(guchar cmd, const guchar * param, int have);
+
+#endif	/* __EMU_PRIVATE_H__ */
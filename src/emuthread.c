@@ -0,0 +1,290 @@
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of version 2 of the GNU General Public License as
+ *  published by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ *****************************************************************************
+ *
+ *  Worker thread emulation for VGATerm.
+ *
+ *  Frames are handed from the worker to the main loop through a triple
+ *  buffer.  The worker owns the "back" frame and the main loop owns the
+ *  "front" frame; the third one sits in the middle.  Either side swaps its
+ *  frame with the middle one using a single compare-and-swap on the state
+ *  word, which also carries a flag telling whether the middle frame is
+ *  newer than what the main loop has already drawn.
+ */
+
+#include "emuthread.h"
+
+#define FRAME_INDEX		0x03
+#define FRAME_FRESH		0x04
+
+/* Publish at least this often (in seconds) while input keeps coming */
+#define PUBLISH_INTERVAL	0.016
+
+typedef struct
+{
+	VGAScreen * scr;
+	/* Running totals, so that frames the main loop skipped aren't lost */
+	int scroll_total;
+	int bell_total;
+} EmuFrame;
+
+struct _VGAEmuThread
+{
+	GtkWidget * term;
+	GThread * thread;
+	GAsyncQueue * queue;	/* GByteArrays to parse; empty one to quit */
+
+	/* Worker side */
+	EmuData * emu;
+	VGAScreen * work;	/* Screen the emulator writes to */
+	int back;
+	int scroll_total;
+	int bell_total;
+
+	/* Shared */
+	EmuFrame frames[3];
+	gint state;		/* Middle frame index | FRAME_FRESH */
+	gint idle_pending;
+
+	/* Main loop side */
+	int front;
+	int scroll_drawn;
+	int bell_drawn;
+};
+
+/* Swap the frame at @index with the middle one; returns the old state */
+static gint
+emu_thread_swap(VGAEmuThread * et, int index, gboolean fresh)
+{
+	gint old;
+
+	do
+		old = g_atomic_int_get(&et->state);
+	while (!g_atomic_int_compare_and_exchange(&et->state, old,
+				index | (fresh ? FRAME_FRESH : 0)));
+
+	return old;
+}
+
+/* Main loop: draw the newest published frame */
+static gboolean
+emu_thread_idle(gpointer data)
+{
+	VGAEmuThread * et = data;
+	EmuFrame * frame;
+	VGAScreen * scr;
+
+	/* Clear this first, so a frame published from now on adds an idle */
+	g_atomic_int_set(&et->idle_pending, 0);
+
+	if (!(g_atomic_int_get(&et->state) & FRAME_FRESH))
+		return FALSE;
+
+	GDK_THREADS_ENTER();
+	et->front = emu_thread_swap(et, et->front, FALSE) & FRAME_INDEX;
+	frame = &et->frames[et->front];
+
+	/* Only the cells that differ get damaged */
+	scr = vga_get_screen(et->term);
+	vga_screen_copy_from(scr, frame->scr);
+	scr->scroll_lines += frame->scroll_total - et->scroll_drawn;
+	scr->bells += frame->bell_total - et->bell_drawn;
+	et->scroll_drawn = frame->scroll_total;
+	et->bell_drawn = frame->bell_total;
+
+	vga_term_update(et->term);
+
+	GDK_THREADS_LEAVE();
+
+	return FALSE;
+}
+
+/* Worker: hand a copy of the work screen to the main loop */
+static void
+emu_thread_publish(VGAEmuThread * et)
+{
+	EmuFrame * frame;
+
+	et->scroll_total += et->work->scroll_lines;
+	et->bell_total += et->work->bells;
+	vga_screen_clear_damage(et->work);
+
+	frame = &et->frames[et->back];
+	vga_screen_copy_from(frame->scr, et->work);
+	vga_screen_clear_damage(frame->scr);
+	frame->scroll_total = et->scroll_total;
+	frame->bell_total = et->bell_total;
+
+	et->back = emu_thread_swap(et, et->back, TRUE) & FRAME_INDEX;
+
+	if (g_atomic_int_compare_and_exchange(&et->idle_pending, 0, 1))
+		g_idle_add(emu_thread_idle, et);
+}
+
+/* Worker: show intermediate states of commands such as palette morphs */
+static void
+emu_thread_sync(EmuData * emu, gpointer user_data)
+{
+	emu_thread_publish(user_data);
+}
+
+static gpointer
+emu_thread_main(gpointer data)
+{
+	VGAEmuThread * et = data;
+	GByteArray * chunk;
+	GTimer * timer;
+
+	timer = g_timer_new();
+
+	for (;;)
+	{
+		chunk = g_async_queue_pop(et->queue);
+		if (chunk->len == 0)
+		{
+			g_byte_array_free(chunk, TRUE);
+			break;
+		}
+
+		vga_emu_write(et->emu, chunk->data, chunk->len);
+		g_byte_array_free(chunk, TRUE);
+
+		/* Publish when caught up, or once a frame if flooded */
+		if (g_async_queue_length(et->queue) <= 0 ||
+			g_timer_elapsed(timer, NULL) >= PUBLISH_INTERVAL)
+		{
+			emu_thread_publish(et);
+			g_timer_start(timer);
+		}
+	}
+
+	g_timer_destroy(timer);
+	return NULL;
+}
+
+/**
+ * vga_emu_thread_new:
+ * @term: VGATerm widget to display the output
+ *
+ * Start a worker thread emulating for @term.  Must be called from the
+ * thread running the main loop.
+ *
+ * Returns: a new VGAEmuThread, or NULL if the thread couldn't be created
+ */
+VGAEmuThread *
+vga_emu_thread_new(GtkWidget * term)
+{
+	VGAEmuThread * et;
+	GError * error = NULL;
+	int i;
+
+	g_return_val_if_fail(term != NULL, NULL);
+	g_return_val_if_fail(VGA_IS_TERM(term), NULL);
+
+	if (!g_thread_supported())
+		g_thread_init(NULL);
+
+	/* The stock palettes are created on first use, which isn't safe to
+	 * do from the worker */
+	for (i = PAL_DEFAULT; i <= PAL_GREYSCALE; i++)
+		vga_palette_stock(i);
+
+	et = g_new0(VGAEmuThread, 1);
+	et->term = term;
+	g_object_ref(term);
+	et->queue = g_async_queue_new();
+
+	et->work = vga_screen_dup(vga_get_screen(term));
+	et->emu = vga_emu_new(et->work);
+	vga_emu_set_sync_func(et->emu, emu_thread_sync, et);
+
+	for (i = 0; i < 3; i++)
+		et->frames[i].scr = vga_screen_dup(et->work);
+	et->front = 0;
+	et->state = 1;
+	et->back = 2;
+
+	et->thread = g_thread_create(emu_thread_main, et, TRUE, &error);
+	if (et->thread == NULL)
+	{
+		g_warning("Unable to start emulator thread: %s",
+				error->message);
+		g_error_free(error);
+		vga_emu_thread_destroy(et);
+		return NULL;
+	}
+
+	return et;
+}
+
+/**
+ * vga_emu_thread_write:
+ * @et: VGAEmuThread
+ * @buf: Data to emulate
+ * @len: Length of @buf
+ *
+ * Queue data for the worker.  This never waits on the worker or the
+ * display, and may be called from any thread.
+ */
+void
+vga_emu_thread_write(VGAEmuThread * et, const guchar * buf, gsize len)
+{
+	GByteArray * chunk;
+
+	g_return_if_fail(et != NULL);
+	g_return_if_fail(buf != NULL);
+	if (len == 0)
+		return;
+
+	chunk = g_byte_array_sized_new(len);
+	g_byte_array_append(chunk, buf, len);
+	g_async_queue_push(et->queue, chunk);
+}
+
+/**
+ * vga_emu_thread_destroy:
+ * @et: VGAEmuThread
+ *
+ * Stop the worker, dropping any data it hasn't gotten to yet, and free
+ * everything.  Must be called from the thread running the main loop.
+ */
+void
+vga_emu_thread_destroy(VGAEmuThread * et)
+{
+	GByteArray * chunk;
+	int i;
+
+	g_return_if_fail(et != NULL);
+
+	if (et->thread)
+	{
+		while ((chunk = g_async_queue_try_pop(et->queue)) != NULL)
+			g_byte_array_free(chunk, TRUE);
+		g_async_queue_push(et->queue, g_byte_array_new());
+		g_thread_join(et->thread);
+	}
+
+	/* Nothing can add one anymore, so this can't race */
+	if (g_atomic_int_get(&et->idle_pending))
+		g_source_remove_by_user_data(et);
+
+	g_async_queue_unref(et->queue);
+	vga_emu_destroy(et->emu);
+	vga_screen_destroy(et->work);
+	for (i = 0; i < 3; i++)
+		vga_screen_destroy(et->frames[i].scr);
+	g_object_unref(et->term);
+	g_free(et);
+}
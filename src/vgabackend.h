@@ -0,0 +1,46 @@
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of version 2 of the GNU General Public License as
+ *  published by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ *****************************************************************************
+ *
+ *  Drawing backends for VGAText, other than the stippled GC fills in
+ *  vgatext.c that every display supports.  A backend is set up when the
+ *  widget is realized and draws whole areas of the window; it picks up
+ *  font, palette and zoom changes itself when it next draws.  Not
+ *  installed.
+ */
+
+#ifndef __VGA_BACKEND_H__
+#define __VGA_BACKEND_H__
+
+#include "vgatext.h"
+
+typedef struct
+{
+	/* Set up for a realized widget; NULL if the display can't do it */
+	gpointer (*new) (GtkWidget * widget);
+	void (*destroy) (gpointer data);
+	/* Draw every cell @area touches, clipped to @area */
+	void (*draw) (gpointer data, GtkWidget * widget, GdkRectangle * area);
+} VGABackend;
+
+extern const VGABackend vga_xrender_backend;
+extern const VGABackend vga_xshm_backend;
+
+/* The palette indexes a cell with @attr is drawn in right now, given
+ * iCE color and the blink state.  Starts blinking if it needs to. */
+void	vga_text_attr_colors	(GtkWidget * widget, guchar attr,
+					guchar * fg, guchar * bg);
+
+#endif	/* __VGA_BACKEND_H__ */
@@ -0,0 +1,636 @@
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of version 2 of the GNU General Public License as
+ *  published by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ *****************************************************************************
+ *
+ *  The screen is scanned in order, so the remote cursor usually only has
+ *  to hop over runs of unchanged cells.  For each hop the candidates are
+ *  an absolute move, a relative move, a CR or CR/LF (plus a relative
+ *  move), or simply writing the unchanged cells again when they already
+ *  have the current attribute; the cheapest one in bytes wins.
+ *
+ *  Cells are compared the way they look: every blank character is a
+ *  space, and a blank's foreground color doesn't matter.  That lets a
+ *  cleared screen match whether the remote terminal clears with the
+ *  current attribute or with the background only (as libvga does).
+ */
+
+#include <string.h>
+#include "vgadiff.h"
+
+#define DIFF_MAX_REPEAT		255
+#define DIFF_IMPOSSIBLE		(G_MAXINT / 2)
+
+struct _VGADiff
+{
+	VGADiffDialect dialect;
+	int rows, cols;
+	vga_charcell * sent;	/* What the remote terminal shows */
+	gboolean valid;		/* FALSE if sent can't be trusted */
+	gboolean repeat;	/* Use the repeat command */
+	int x, y;		/* Remote cursor, 0-based; x is -1 if unknown */
+	int attr;		/* Remote text attribute, -1 if unknown */
+};
+
+/* VGA color number to ANSI color number */
+static const guchar ansi_color[8] = { 0, 4, 2, 6, 1, 5, 3, 7 };
+
+/* What the remote terminal will show if sent @cell */
+static vga_charcell
+diff_normalize(VGADiff * diff, vga_charcell cell)
+{
+	switch (cell.c)
+	{
+		case 0:
+		case ' ':
+		case 255:
+			cell.c = ' ';
+			cell.attr &= 0xF0;
+			break;
+		case 7: case 8: case 9: case 10:
+		case 12: case 13: case 22: case 27:
+			cell.c = '?';
+			break;
+		case 25:
+			if (diff->dialect == VGA_DIFF_AVATAR)
+				cell.c = '?';
+			break;
+	}
+	return cell;
+}
+
+static gboolean
+cell_equal(vga_charcell a, vga_charcell b)
+{
+	return a.c == b.c && a.attr == b.attr;
+}
+
+/* Can @cell (normalized) be written without changing the attribute? */
+static gboolean
+diff_attr_ok(VGADiff * diff, vga_charcell cell)
+{
+	if (diff->attr < 0)
+		return FALSE;
+	if (cell.c == ' ')
+		return (diff->attr & 0xF0) == cell.attr;
+	return diff->attr == cell.attr;
+}
+
+static int
+ndigits(int n)
+{
+	return n >= 100 ? 3 : n >= 10 ? 2 : 1;
+}
+
+static void
+put_bytes(GByteArray * out, const gchar * s)
+{
+	g_byte_array_append(out, (const guchar *) s, strlen(s));
+}
+
+static void
+put_byte(GByteArray * out, guchar c)
+{
+	g_byte_array_append(out, &c, 1);
+}
+
+/*************************************
+ * Cursor movement
+ *************************************/
+
+static int
+diff_goto_cost(VGADiff * diff, int x, int y)
+{
+	if (diff->dialect != VGA_DIFF_ANSI)
+		return 4;
+	if (x == 0)
+		return y == 0 ? 3 : 3 + ndigits(y + 1);
+	return 4 + ndigits(y + 1) + ndigits(x + 1);
+}
+
+static void
+diff_put_goto(VGADiff * diff, GByteArray * out, int x, int y)
+{
+	gchar buf[16];
+
+	switch (diff->dialect)
+	{
+		case VGA_DIFF_ANSI:
+			if (x == 0 && y == 0)
+				put_bytes(out, "\033[H");
+			else
+			if (x == 0)
+			{
+				g_snprintf(buf, sizeof(buf), "\033[%dH", y + 1);
+				put_bytes(out, buf);
+			}
+			else
+			{
+				g_snprintf(buf, sizeof(buf), "\033[%d;%dH",
+						y + 1, x + 1);
+				put_bytes(out, buf);
+			}
+			break;
+		case VGA_DIFF_AVATAR:
+			put_byte(out, 22);
+			put_byte(out, 8);
+			put_byte(out, y + 1);
+			put_byte(out, x + 1);
+			break;
+		case VGA_DIFF_TEXTFX:
+			put_byte(out, 27);
+			put_byte(out, 'H');
+			put_byte(out, x + 1);
+			put_byte(out, y + 1);
+			break;
+	}
+}
+
+static int
+diff_forward_cost(VGADiff * diff, int n)
+{
+	if (n == 0)
+		return 0;
+
+	switch (diff->dialect)
+	{
+		case VGA_DIFF_ANSI:
+			return n == 1 ? 3 : 3 + ndigits(n);
+		case VGA_DIFF_AVATAR:
+			return 2 * n;
+		case VGA_DIFF_TEXTFX:
+			if (n > 255)
+				return DIFF_IMPOSSIBLE;
+			return n == 1 ? 2 : 3;
+	}
+	return DIFF_IMPOSSIBLE;
+}
+
+static void
+diff_put_forward(VGADiff * diff, GByteArray * out, int n)
+{
+	gchar buf[16];
+
+	if (n == 0)
+		return;
+
+	switch (diff->dialect)
+	{
+		case VGA_DIFF_ANSI:
+			if (n == 1)
+				put_bytes(out, "\033[C");
+			else
+			{
+				g_snprintf(buf, sizeof(buf), "\033[%dC", n);
+				put_bytes(out, buf);
+			}
+			break;
+		case VGA_DIFF_AVATAR:
+			while (n--)
+			{
+				put_byte(out, 22);
+				put_byte(out, 6);
+			}
+			break;
+		case VGA_DIFF_TEXTFX:
+			put_byte(out, 27);
+			if (n == 1)
+				put_byte(out, 'c');
+			else
+			{
+				put_byte(out, 'C');
+				put_byte(out, n);
+			}
+			break;
+	}
+}
+
+/* Move the remote cursor to @tx, @ty the cheapest way */
+static void
+diff_move(VGADiff * diff, GByteArray * out, int tx, int ty)
+{
+	enum { M_GOTO, M_FORWARD, M_REWRITE, M_CR, M_CRLF } how = M_GOTO;
+	const vga_charcell * sent;
+	int best, cost, i;
+
+	if (diff->x == tx && diff->y == ty)
+		return;
+
+	best = diff_goto_cost(diff, tx, ty);
+
+	if (diff->x >= 0)
+	{
+		if (ty == diff->y && tx > diff->x)
+		{
+			cost = diff_forward_cost(diff, tx - diff->x);
+			if (cost < best)
+			{
+				best = cost;
+				how = M_FORWARD;
+			}
+
+			/* Cells already sent are safe to send again */
+			if (tx - diff->x < best)
+			{
+				sent = diff->sent + ty * diff->cols;
+				for (i = diff->x; i < tx; i++)
+					if (!diff_attr_ok(diff, sent[i]))
+						break;
+				if (i == tx)
+				{
+					best = tx - diff->x;
+					how = M_REWRITE;
+				}
+			}
+		}
+
+		cost = 1 + diff_forward_cost(diff, tx);
+		if (ty == diff->y && cost < best)
+		{
+			best = cost;
+			how = M_CR;
+		}
+		if (ty == diff->y + 1 && cost + 1 < best)
+		{
+			best = cost + 1;
+			how = M_CRLF;
+		}
+	}
+
+	switch (how)
+	{
+		case M_GOTO:
+			diff_put_goto(diff, out, tx, ty);
+			break;
+		case M_FORWARD:
+			diff_put_forward(diff, out, tx - diff->x);
+			break;
+		case M_REWRITE:
+			sent = diff->sent + ty * diff->cols;
+			for (i = diff->x; i < tx; i++)
+				put_byte(out, sent[i].c);
+			break;
+		case M_CR:
+			put_byte(out, 13);
+			diff_put_forward(diff, out, tx);
+			break;
+		case M_CRLF:
+			put_byte(out, 13);
+			put_byte(out, 10);
+			diff_put_forward(diff, out, tx);
+			break;
+	}
+
+	diff->x = tx;
+	diff->y = ty;
+}
+
+/*************************************
+ * Attributes
+ *************************************/
+
+static void
+sgr_add(gchar * buf, gboolean * first, int n)
+{
+	gchar num[8];
+
+	g_snprintf(num, sizeof(num), *first ? "%d" : ";%d", n);
+	strcat(buf, num);
+	*first = FALSE;
+}
+
+/* Shortest SGR sequence from @from (-1 if unknown) to @to */
+static void
+diff_put_sgr(GByteArray * out, int from, guchar to)
+{
+	gchar reset[32], incr[32];
+	gboolean first;
+
+	/* From scratch */
+	strcpy(reset, "\033[0");
+	first = FALSE;
+	if (to & 0x08)
+		sgr_add(reset, &first, 1);
+	if (to & 0x80)
+		sgr_add(reset, &first, 5);
+	if ((to & 0x07) != GREY)
+		sgr_add(reset, &first, 30 + ansi_color[to & 0x07]);
+	if (GETBG(to) != BLACK)
+		sgr_add(reset, &first, 40 + ansi_color[GETBG(to)]);
+	strcat(reset, "m");
+
+	/* From the current attribute, if nothing has to be turned off */
+	if (from < 0 || (from & ~to & 0x88))
+	{
+		put_bytes(out, reset);
+		return;
+	}
+
+	strcpy(incr, "\033[");
+	first = TRUE;
+	if ((to & 0x08) && !(from & 0x08))
+		sgr_add(incr, &first, 1);
+	if ((to & 0x80) && !(from & 0x80))
+		sgr_add(incr, &first, 5);
+	if ((to & 0x07) != (from & 0x07))
+		sgr_add(incr, &first, 30 + ansi_color[to & 0x07]);
+	if (GETBG(to) != GETBG(from))
+		sgr_add(incr, &first, 40 + ansi_color[GETBG(to)]);
+	strcat(incr, "m");
+
+	put_bytes(out, strlen(incr) < strlen(reset) ? incr : reset);
+}
+
+static void
+diff_set_attr(VGADiff * diff, GByteArray * out, guchar attr)
+{
+	switch (diff->dialect)
+	{
+		case VGA_DIFF_ANSI:
+			diff_put_sgr(out, diff->attr, attr);
+			break;
+		case VGA_DIFF_AVATAR:
+			/* ^A can't set blink on its own */
+			put_byte(out, 22);
+			put_byte(out, 1);
+			put_byte(out, attr & 0x7F);
+			if (attr & 0x80)
+			{
+				put_byte(out, 22);
+				put_byte(out, 2);
+			}
+			break;
+		case VGA_DIFF_TEXTFX:
+			put_byte(out, 27);
+			put_byte(out, 'M');
+			put_byte(out, attr);
+			break;
+	}
+	diff->attr = attr;
+}
+
+/*************************************
+ * Public methods
+ *************************************/
+
+/**
+ * vga_diff_new:
+ * @dialect: What the remote terminal understands
+ * @rows: Rows on the remote screen
+ * @cols: Columns on the remote screen
+ *
+ * Create a diff for a remote terminal in an unknown state.  The first
+ * update clears its screen and sends everything.
+ *
+ * Returns: a new VGADiff
+ */
+VGADiff *
+vga_diff_new(VGADiffDialect dialect, int rows, int cols)
+{
+	VGADiff * diff;
+
+	g_return_val_if_fail(rows > 0 && cols > 0, NULL);
+	/* Avatar and TextFX send coordinates as single bytes */
+	g_return_val_if_fail(dialect == VGA_DIFF_ANSI ||
+			(rows <= 255 && cols <= 255), NULL);
+
+	diff = g_new0(VGADiff, 1);
+	diff->dialect = dialect;
+	diff->rows = rows;
+	diff->cols = cols;
+	diff->sent = g_new(vga_charcell, rows * cols);
+
+	/* libvga's own Avatar parser takes ^Y literally */
+	diff->repeat = (dialect == VGA_DIFF_TEXTFX);
+
+	vga_diff_invalidate(diff);
+
+	return diff;
+}
+
+void
+vga_diff_destroy(VGADiff * diff)
+{
+	g_return_if_fail(diff != NULL);
+
+	g_free(diff->sent);
+	g_free(diff);
+}
+
+/**
+ * vga_diff_set_repeat:
+ * @diff: VGADiff
+ * @repeat: Whether to use the repeat command
+ *
+ * Turn the dialect's repeat command (Avatar ^Y, TextFX r) on or off.  It
+ * is on by default for TextFX.  For Avatar it is off, since many
+ * terminals, including this library's, show ^Y as a character.  ANSI has
+ * no repeat command.
+ */
+void
+vga_diff_set_repeat(VGADiff * diff, gboolean repeat)
+{
+	g_return_if_fail(diff != NULL);
+
+	diff->repeat = repeat && diff->dialect != VGA_DIFF_ANSI;
+}
+
+/* Forget what the remote terminal shows; the next update repaints it */
+void
+vga_diff_invalidate(VGADiff * diff)
+{
+	g_return_if_fail(diff != NULL);
+
+	diff->valid = FALSE;
+	diff->x = -1;
+	diff->y = 0;
+	diff->attr = -1;
+}
+
+/* Clear the remote screen, so that only non-blank cells need sending */
+static void
+diff_clear(VGADiff * diff, GByteArray * out)
+{
+	vga_charcell blank;
+	int i;
+
+	if (diff->dialect == VGA_DIFF_AVATAR)
+	{
+		diff_set_attr(diff, out, 0x07);
+		put_byte(out, 12);
+	}
+	else
+	{
+		put_bytes(out, "\033[0m\033[2J");
+		diff->attr = 0x07;
+	}
+
+	blank.c = ' ';
+	blank.attr = 0x00;
+	for (i = 0; i < diff->rows * diff->cols; i++)
+		diff->sent[i] = blank;
+
+	/* Not every terminal homes the cursor */
+	diff->x = -1;
+	diff->valid = TRUE;
+}
+
+/**
+ * vga_diff_update:
+ * @diff: VGADiff
+ * @out: Where to append the update
+ * @buf: Screen contents, @diff's size
+ * @cursor_x: Where to leave the remote cursor (0-based), or -1
+ * @cursor_y: Where to leave the remote cursor
+ *
+ * Append the bytes that make the remote terminal show @buf, and remember
+ * that it does.
+ *
+ * Returns: The number of bytes appended
+ */
+gsize
+vga_diff_update(VGADiff * diff, GByteArray * out, const vga_charcell * buf,
+		int cursor_x, int cursor_y)
+{
+	const vga_charcell * row;
+	vga_charcell * sent, t;
+	guchar attr;
+	gsize start;
+	int x, y, end, run, cost;
+
+	g_return_val_if_fail(diff != NULL, 0);
+	g_return_val_if_fail(out != NULL, 0);
+	g_return_val_if_fail(buf != NULL, 0);
+
+	start = out->len;
+	if (!diff->valid)
+		diff_clear(diff, out);
+
+	cost = (diff->dialect == VGA_DIFF_AVATAR) ? 3 : 4;
+
+	for (y = 0; y < diff->rows; y++)
+	{
+		row = buf + y * diff->cols;
+		sent = diff->sent + y * diff->cols;
+
+		/* Writing the last cell would scroll the screen */
+		end = (y == diff->rows - 1) ? diff->cols - 1 : diff->cols;
+
+		for (x = 0; x < end; )
+		{
+			t = diff_normalize(diff, row[x]);
+			if (cell_equal(t, sent[x]))
+			{
+				x++;
+				continue;
+			}
+
+			diff_move(diff, out, x, y);
+
+			if (!diff_attr_ok(diff, t))
+			{
+				/* A blank's foreground is free, keep ours */
+				attr = t.attr;
+				if (t.c == ' ' && diff->attr >= 0)
+					attr |= diff->attr & 0x0F;
+				diff_set_attr(diff, out, attr);
+			}
+
+			run = 1;
+			if (diff->repeat)
+				while (x + run < end && run < DIFF_MAX_REPEAT &&
+					cell_equal(t, diff_normalize(diff,
+							row[x + run])))
+					run++;
+
+			if (run > cost)
+			{
+				put_byte(out, diff->dialect ==
+						VGA_DIFF_AVATAR ? 25 : 27);
+				if (diff->dialect == VGA_DIFF_TEXTFX)
+					put_byte(out, 'r');
+				put_byte(out, t.c);
+				put_byte(out, run);
+			}
+			else
+			{
+				run = 1;
+				put_byte(out, t.c);
+			}
+
+			for (; run > 0; run--)
+				sent[x++] = t;
+
+			/* Terminals differ on what happens at the edge */
+			diff->x = (x < diff->cols) ? x : -1;
+		}
+	}
+
+	if (cursor_x >= 0 && cursor_x < diff->cols &&
+		cursor_y >= 0 && cursor_y < diff->rows)
+		diff_move(diff, out, cursor_x, cursor_y);
+
+	return out->len - start;
+}
+
+/* Update from a screen of the same size, leaving the cursor where it is */
+gsize
+vga_diff_update_screen(VGADiff * diff, GByteArray * out, VGAScreen * scr)
+{
+	g_return_val_if_fail(diff != NULL, 0);
+	g_return_val_if_fail(scr != NULL, 0);
+	g_return_val_if_fail(scr->rows == diff->rows &&
+			scr->cols == diff->cols, 0);
+
+	return vga_diff_update(diff, out, scr->video_buf,
+			scr->cursor_x, scr->cursor_y);
+}
+
+/**
+ * vga_diff_buffers:
+ * @dialect: What the remote terminal understands
+ * @out: Where to append the update
+ * @from: What the remote terminal shows now
+ * @to: What it should show
+ * @rows: Rows in both buffers
+ * @cols: Columns in both buffers
+ *
+ * One-off diff between two buffers.  The remote cursor and attribute are
+ * taken to be unknown.
+ *
+ * Returns: The number of bytes appended
+ */
+gsize
+vga_diff_buffers(VGADiffDialect dialect, GByteArray * out,
+		const vga_charcell * from, const vga_charcell * to,
+		int rows, int cols)
+{
+	VGADiff * diff;
+	gsize len;
+	int i;
+
+	g_return_val_if_fail(from != NULL, 0);
+
+	diff = vga_diff_new(dialect, rows, cols);
+	g_return_val_if_fail(diff != NULL, 0);
+
+	for (i = 0; i < rows * cols; i++)
+		diff->sent[i] = diff_normalize(diff, from[i]);
+	diff->valid = TRUE;
+
+	len = vga_diff_update(diff, out, to, -1, -1);
+	vga_diff_destroy(diff);
+
+	return len;
+}
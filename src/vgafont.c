@@ -18,6 +18,102 @@
 
 #include "vgafont.h"
 #include "def_font.h"
+#include "def_font_tables.h"	/* Generated by tools/mkdeftables */
+
+/* A font rendered for one display */
+typedef struct
+{
+	GdkDisplay * display;
+	int scale;		/* Bitmap pixels per font pixel, each way */
+	GdkBitmap * bitmap;
+	GdkGC * gc;		/* For patching bitmap, made when needed */
+	guint32 stale[8];	/* Glyphs changed since bitmap was drawn */
+} FontBitmap;
+
+#define GLYPH_STALE(fb, c)	((fb)->stale[(c) >> 5] & (1u << ((c) & 31)))
+
+/* Main loop: let go of the bitmaps a font no longer uses */
+static gboolean font_release_bitmaps(gpointer data)
+{
+	GSList * list = data, * l;
+	FontBitmap * fb;
+
+	GDK_THREADS_ENTER();
+	for (l = list; l != NULL; l = l->next)
+	{
+		fb = l->data;
+		g_object_unref(fb->bitmap);
+		if (fb->gc)
+			g_object_unref(fb->gc);
+		g_free(fb);
+	}
+	GDK_THREADS_LEAVE();
+	g_slist_free(list);
+
+	return FALSE;
+}
+
+/* Forget the rendered bitmaps, which no longer match the font.  Fonts may
+ * be changed or freed off the main thread, so the unref waits for it. */
+static void font_drop_bitmaps(VGAFont * font)
+{
+	if (font->bitmaps == NULL)
+		return;
+
+	g_idle_add(font_release_bitmaps, font->bitmaps);
+	font->bitmaps = NULL;
+}
+
+/* Mark glyphs @first to @last for redrawing in every rendered bitmap.
+ * This only touches memory, so is fine off the main thread. */
+static void font_mark_stale(VGAFont * font, int first, int last)
+{
+	FontBitmap * fb;
+	GSList * l;
+	int c;
+
+	for (l = font->bitmaps; l != NULL; l = l->next)
+	{
+		fb = l->data;
+		for (c = first; c <= last; c++)
+			fb->stale[c >> 5] |= 1u << (c & 31);
+	}
+}
+
+/* Derive the render formats of glyphs @first to @last from data.  Only the
+ * rows of the whole font are kept, so anything a backend needs per glyph is
+ * a slice of these. */
+static void font_compile(VGAFont * font, int first, int last)
+{
+	guchar * cov;
+	int i, row, end;
+
+	if (font->xbm == NULL)
+	{
+		font->xbm = g_malloc(font->height * 256);
+		font->coverage = g_malloc(vga_font_pixels(font) * 256);
+	}
+
+	row = first * font->height;
+	end = (last + 1) * font->height;
+	cov = font->coverage + row * font->width;
+	for (i = row; i < end; i++, cov += font->width)
+	{
+		font->xbm[i] = bit_mirror[font->data[i]];
+		memcpy(cov, vga_font_row_expand[font->data[i]], font->width);
+	}
+
+	font->compiled_serial = font->serial;
+}
+
+/* Forget the render formats, which no longer fit the font's size */
+static void font_free_formats(VGAFont * font)
+{
+	g_free(font->xbm);
+	g_free(font->coverage);
+	font->xbm = NULL;
+	font->coverage = NULL;
+}
 
 /**
  * vga_font_new:
@@ -30,11 +126,81 @@ VGAFont * vga_font_new(void)
 {
 	VGAFont * font;
 	
-	font = g_new(VGAFont, 1);
+	font = g_new0(VGAFont, 1);
 	font->width = -1;
 	font->height = -1;
-	font->data = NULL;
+	font->ref_count = 1;
+
+	return font;
+}
+
+
+/**
+ * vga_font_stock:
+ * @id: Stock Font ID enum.
+ *
+ * Get a stock font object: the built-in 8x16 (FONT_DEFAULT) or 8x8
+ * (FONT_DEFAULT_8X8) font.  These objects should not be destroyed or
+ * modified; use vga_font_ref() to keep one, and vga_font_dup() to get a
+ * copy you can modify.  Unlike vga_font_load_default(), nothing is copied.
+ *
+ * Returns: A stock font object
+ */
+VGAFont * vga_font_stock(StockFont id)
+{
+	static VGAFont * stock[2] = { NULL, NULL };
+	VGAFont * font;
 
+	g_return_val_if_fail(id == FONT_DEFAULT || id == FONT_DEFAULT_8X8,
+			NULL);
+
+	font = g_atomic_pointer_get((volatile gpointer *) &stock[id]);
+	if (font != NULL)
+		return font;
+
+	/* Everything was converted at build time */
+	font = vga_font_new();
+	font->width = 8;
+	if (id == FONT_DEFAULT)
+	{
+		font->height = 16;
+		font->data = (guchar *) default_font;
+		font->xbm = (guchar *) default_font_xbm;
+		font->coverage = (guchar *) default_font_coverage;
+	}
+	else
+	{
+		font->height = 8;
+		font->data = (guchar *) default_font_8x8;
+		font->xbm = (guchar *) default_font_8x8_xbm;
+		font->coverage = (guchar *) default_font_8x8_coverage;
+	}
+	font->stock = TRUE;
+
+	/* Screens are created off the main thread too; only one font wins */
+	if (!g_atomic_pointer_compare_and_exchange(
+				(volatile gpointer *) &stock[id], NULL, font))
+	{
+		g_free(font);
+		font = g_atomic_pointer_get((volatile gpointer *) &stock[id]);
+	}
+
+	return font;
+}
+
+
+/**
+ * vga_font_ref:
+ * @font: the VGA Font object
+ *
+ * Take a reference to @font, to be released with vga_font_destroy().
+ *
+ * Returns: @font
+ */
+VGAFont * vga_font_ref(VGAFont * font)
+{
+	g_return_val_if_fail(font != NULL, NULL);
+	g_atomic_int_inc(&font->ref_count);
 	return font;
 }
 
@@ -43,17 +209,145 @@ VGAFont * vga_font_new(void)
  * vga_font_destroy:
  * @font: the VGA Font object
  *
- * Destroy a VGA Font object.
+ * Release a reference to a VGA Font object, destroying it when it was the
+ * last one.
  */
 void vga_font_destroy(VGAFont * font)
 {
 	g_return_if_fail(font != NULL);
-	if (font->data)
+	if (!g_atomic_int_dec_and_test(&font->ref_count))
+		return;
+
+	font_drop_bitmaps(font);
+	font_free_formats(font);
+	if (font->owner)
+		font->owner_release(font->owner);
+	else if (font->data && !font->stock)
 		g_free(font->data);
 	g_free(font);
 }
 
 
+/**
+ * vga_font_dup:
+ * @font: the VGA Font object to clone
+ *
+ * Duplicate/copy a font object.  This is how to get a font you can modify
+ * from a shared or stock one.
+ *
+ * Returns: A newly allocated copy of @font.
+ */
+VGAFont * vga_font_dup(VGAFont * font)
+{
+	VGAFont * tmp;
+
+	g_return_val_if_fail(font != NULL, NULL);
+
+	tmp = vga_font_new();
+	if (font->data)
+	{
+		tmp->width = font->width;
+		tmp->height = font->height;
+		tmp->data = g_memdup(font->data, vga_font_pixels(font) * 32);
+		font_compile(tmp, 0, 255);
+	}
+	return tmp;
+}
+
+
+/**
+ * vga_font_new_borrowed:
+ * @data: raw VGA font data for the entire font
+ * @width: width, in pixels, of the font
+ * @height: height, in pixels, of the font
+ * @owner: what keeps @data valid
+ * @release: called on @owner when the font is destroyed
+ *
+ * Wrap font data held elsewhere, e.g. in a memory-mapped file, without
+ * copying it.  The font can't be modified.  Its render formats are made
+ * straight away, so that it can be shared between threads.
+ *
+ * Returns: A new VGA font object
+ */
+VGAFont * vga_font_new_borrowed(const guchar * data, int width, int height,
+		gpointer owner, GDestroyNotify release)
+{
+	VGAFont * font;
+
+	g_return_val_if_fail(data != NULL, NULL);
+	g_return_val_if_fail(owner != NULL && release != NULL, NULL);
+	g_return_val_if_fail(width == 8 && height > 0, NULL);
+
+	font = vga_font_new();
+	font->width = width;
+	font->height = height;
+	font->data = (guchar *) data;
+	font->owner = owner;
+	font->owner_release = release;
+	font_compile(font, 0, 255);
+
+	return font;
+}
+
+
+/**
+ * vga_font_is_writable:
+ * @font: the VGA Font object
+ *
+ * Returns: TRUE if @font may be modified: it isn't a stock font, its data
+ * isn't borrowed and nothing else holds a reference to it.
+ */
+gboolean vga_font_is_writable(VGAFont * font)
+{
+	g_return_val_if_fail(font != NULL, FALSE);
+	return !font->stock && font->owner == NULL &&
+		g_atomic_int_get(&font->ref_count) == 1;
+}
+
+
+/**
+ * vga_font_get_xbm:
+ * @font: the VGA font object
+ *
+ * Get the font data with each row's bits mirrored, the order XBM and
+ * X bitmaps want: one byte per row, all 256 glyphs in a column.
+ *
+ * Returns: The mirrored data, owned by @font and only valid until it is
+ * next changed
+ */
+const guchar * vga_font_get_xbm(VGAFont * font)
+{
+	g_return_val_if_fail(font != NULL, NULL);
+	g_return_val_if_fail(font->data != NULL, NULL);
+
+	if (font->xbm == NULL || font->compiled_serial != font->serial)
+		font_compile(font, 0, 255);
+	return font->xbm;
+}
+
+
+/**
+ * vga_font_get_coverage:
+ * @font: the VGA font object
+ *
+ * Get the font as an 8 bit mask: a byte for every pixel, 0xFF where the
+ * glyph is drawn and 0 where it isn't, font->width bytes per row and all
+ * 256 glyphs in a column.
+ *
+ * Returns: The mask, owned by @font and only valid until it is next
+ * changed
+ */
+const guchar * vga_font_get_coverage(VGAFont * font)
+{
+	g_return_val_if_fail(font != NULL, NULL);
+	g_return_val_if_fail(font->data != NULL, NULL);
+
+	if (font->xbm == NULL || font->compiled_serial != font->serial)
+		font_compile(font, 0, 255);
+	return font->coverage;
+}
+
+
 /**
  * vga_font_set_chars:
  * @font: the VGA font object
@@ -64,21 +358,50 @@ void vga_font_destroy(VGAFont * font)
  * Load the [partial] font into the font object.  A font must already be
  * loaded before calling this function (unless you know what you are doing).
  * The @data buffer must be large enough to account the character range
- * given.
+ * given.  Only the glyphs given are rendered again.
  */
 gboolean vga_font_set_chars(VGAFont * font, guchar * data, guchar start_c,
 		       	guchar end_c)
 {
-	int bytes;
+	int bytes, char_bytes;
+	gboolean compiled;
 	g_return_val_if_fail(data != NULL, FALSE);
 	g_return_val_if_fail(font->data != NULL, FALSE);
+	g_return_val_if_fail(vga_font_is_writable(font), FALSE);
+	g_return_val_if_fail(start_c <= end_c, FALSE);
 	g_assert(font->height > 0 && font->width > 0);
-	bytes = ((font->width * font->height) / 8) * (end_c - start_c + 1);
-	memcpy(font->data + start_c, data, bytes);
+	char_bytes = (font->width * font->height) / 8;
+	bytes = char_bytes * (end_c - start_c + 1);
+	memcpy(font->data + start_c * char_bytes, data, bytes);
+
+	/* Bring the render formats up to date now, not on the render path */
+	compiled = font->xbm != NULL && font->compiled_serial == font->serial;
+	font->serial++;
+	if (compiled)
+		font_compile(font, start_c, end_c);
+	else
+		font_compile(font, 0, 255);
+	font_mark_stale(font, start_c, end_c);
 
 	return TRUE;
 }
 
+/* Make @data, which @font now owns, the whole font */
+static void font_take_data(VGAFont * font, guchar * data, int width,
+		int height)
+{
+	/* The size may change, so nothing rendered can be reused */
+	font_drop_bitmaps(font);
+	font_free_formats(font);
+	g_free(font->data);
+
+	font->width = width;
+	font->height = height;
+	font->data = data;
+	font->serial++;
+	font_compile(font, 0, 255);
+}
+
 /**
  * vga_font_load:
  * @font: the VGA font object
@@ -86,20 +409,19 @@ gboolean vga_font_set_chars(VGAFont * font, guchar * data, guchar start_c,
  * @width: width, in pixels, of the font
  * @height: height, in pixels, of the font
  *
- * Load the given font data/parameters into the font object.
+ * Load the given font data/parameters into the font object.  Only 8 pixel
+ * wide fonts are supported.
  *
  * Returns: TRUE on success.
  */
 gboolean vga_font_load(VGAFont * font, guchar * data, int width, int height)
 {
-	font->height = height;
-	font->width = width;
-	if (font->data)
-	{
-		g_free(font->data);
-	}
-	font->data = g_malloc(width * height * 32);
-	return vga_font_set_chars(font, data, 0, 255);
+	g_return_val_if_fail(vga_font_is_writable(font), FALSE);
+	g_return_val_if_fail(width == 8 && height > 0, FALSE);
+
+	font_take_data(font, g_memdup(data, width * height * 32),
+			width, height);
+	return TRUE;
 }
 
 /* Determine the dimensions of the characters given the font image length */
@@ -127,34 +449,57 @@ determine_char_size(int fontlen, int *width, int *height)
  * @font: the VGA font object
  * @fname: the filename of the VGA font file to load.
  *
- * Load a VGA font from a raw VGA font data file.
+ * Load a VGA font from a raw VGA font data file.  The file is read straight
+ * into the font.
+ *
+ * Returns: TRUE on success, FALSE if the file can't be read or isn't a
+ * font.
  */
 gboolean vga_font_load_from_file(VGAFont * font, gchar * fname)
 {
-	int filesize, height = 0, width = 0;
-	FILE * f;
-	guchar * buf;
-	gboolean result;
-
-	/* Determine font parameters and read file into memory buffer */
-	f = fopen(fname, "rb");
-	fseek(f, 0, SEEK_END);
-	filesize = ftell(f);
-	fseek(f, 0, SEEK_SET);
-	determine_char_size(filesize, &width, &height);
-	if (height == 0 || width == 0)
+	int height = 0, width = 0;
+	gchar * buf;
+	gsize filesize;
+
+	g_return_val_if_fail(vga_font_is_writable(font), FALSE);
+
+	if (!g_file_get_contents(fname, &buf, &filesize, NULL))
+		return FALSE;
+
+	/* Determine font parameters from the size; glyph rows are a byte */
+	if (filesize <= G_MAXINT)
+		determine_char_size(filesize, &width, &height);
+	if (height == 0 || width != 8)
 	{
-		fclose(f);
+		g_free(buf);
 		return FALSE;
 	}
-	buf = g_malloc(filesize);
-	fread(buf, filesize, 1, f);
-	fclose(f);
 
-	result = vga_font_load(font, buf, width, height);
-	g_free(buf);
+	font_take_data(font, (guchar *) buf, width, height);
+	return TRUE;
+}
+
+/* Copy a stock font's data and render formats into @font */
+static void font_load_stock(VGAFont * font, StockFont id)
+{
+	VGAFont * stock;
+	int size;
+
+	g_return_if_fail(vga_font_is_writable(font));
 
-	return result;
+	stock = vga_font_stock(id);
+	size = vga_font_pixels(stock) * 32;
+
+	font_drop_bitmaps(font);
+	font_free_formats(font);
+	g_free(font->data);
+
+	font->width = stock->width;
+	font->height = stock->height;
+	font->data = g_memdup(stock->data, size);
+	font->xbm = g_memdup(stock->xbm, stock->height * 256);
+	font->coverage = g_memdup(stock->coverage, size * 8);
+	font->compiled_serial = ++font->serial;
 }
 
 /**
@@ -165,7 +510,7 @@ gboolean vga_font_load_from_file(VGAFont * font, gchar * fname)
  */
 void vga_font_load_default(VGAFont * font)
 {
-	vga_font_load(font, default_font, 8, 16);
+	font_load_stock(font, FONT_DEFAULT);
 }
 
 /**
@@ -176,7 +521,7 @@ void vga_font_load_default(VGAFont * font)
  */
 void vga_font_load_default_8x8(VGAFont * font)
 {
-	vga_font_load(font, default_font_8x8, 8, 8);
+	font_load_stock(font, FONT_DEFAULT_8X8);
 }
 
 
@@ -192,51 +537,134 @@ int vga_font_pixels(VGAFont * font)
 }
 
 
-/* Bit flip/mirror a byte -- maybe there's a better way to do this */
-static guchar bitflip(guchar c)
+/* Render glyphs @first to @last of @font as a bitmap @scale times the size
+ * each way.  The scaled rows come from the coverage mask, so each glyph
+ * still takes one stipple fill however large it is drawn. */
+static GdkBitmap * font_render_glyphs(VGAFont * font, GdkWindow * win,
+		int first, int last, int scale)
 {
-	int i;
-	guchar y = 0, filter = 128;
+	GdkBitmap * bitmap;
+	const guchar * cov;
+	guchar * xbm, * out;
+	int stride, rows, i, r, x;
+
+	rows = (last - first + 1) * font->height;
+	if (scale == 1)
+		return gdk_bitmap_create_from_data(win,
+				(const gchar *) vga_font_get_xbm(font) +
+					first * font->height,
+				font->width, rows);
 
-	for (i = 7; i > 0; i -= 2)
+	stride = (font->width * scale + 7) / 8;
+	xbm = g_malloc0(stride * rows * scale);
+	cov = vga_font_get_coverage(font) + first * vga_font_pixels(font);
+	out = xbm;
+	for (i = 0; i < rows; i++, cov += font->width)
 	{
-		y = (filter & c) >> i | y;
-		filter = filter >> 1;
+		for (x = 0; x < font->width * scale; x++)
+			if (cov[x / scale])
+				out[x >> 3] |= 1 << (x & 7);
+		for (r = 1; r < scale; r++)
+			memcpy(out + r * stride, out, stride);
+		out += scale * stride;
 	}
 
-	for (i = 1; i < 8; i += 2)
+	bitmap = gdk_bitmap_create_from_data(win, (const gchar *) xbm,
+			font->width * scale, rows * scale);
+	g_free(xbm);
+
+	return bitmap;
+}
+
+/* Draw the glyphs changed since @fb was drawn over the old ones.  The GC
+ * stipple using the bitmap has to be set again afterwards, since the X
+ * server may have taken a copy. */
+static void font_patch_bitmap(VGAFont * font, FontBitmap * fb, GdkWindow * win)
+{
+	GdkBitmap * part;
+	int c, first, height;
+
+	height = font->height * fb->scale;
+	for (c = 0; c < 256; c++)
 	{
-		y = (filter & c) << i | y;
-		filter = filter >> 1;
+		if (!GLYPH_STALE(fb, c))
+			continue;
+
+		first = c;
+		while (c < 256 && GLYPH_STALE(fb, c))
+			c++;
+
+		part = font_render_glyphs(font, win, first, c - 1, fb->scale);
+		if (fb->gc == NULL)
+			fb->gc = gdk_gc_new(fb->bitmap);
+		gdk_draw_drawable(fb->bitmap, fb->gc, part, 0, 0,
+				0, first * height, font->width * fb->scale,
+				(c - first) * height);
+		g_object_unref(part);
 	}
 
-	return y;
+	memset(fb->stale, 0, sizeof(fb->stale));
 }
 
 /**
  * vga_font_get_bitmap:
  * @font: the VGA font object
+ * @win: a window on the display the bitmap is for
  *
- * Create a XBM representation of the font, with all characters in one column
+ * Get a XBM representation of the font, with all characters in one column
  * with the same width as the character width of the font (so, for a standard
- * 8x16 VGA font, the returned bitmap is 8x4096).
+ * 8x16 VGA font, the returned bitmap is 8x4096).  The bitmap is rendered
+ * once per display and shared by everything showing the font there.
  * 
- * Returns: The new GdkBitmap object representing the rendered font
+ * Returns: A reference to the GdkBitmap representing the rendered font,
+ * to be released with g_object_unref()
  */
 GdkBitmap * vga_font_get_bitmap(VGAFont * font, GdkWindow * win)
 {
-	unsigned char * xbm;
-	int i, size;
-	/* The XBM format is pretty similar to the raw VGA font, just
-	 * mirrored horizontally.  So we flip/mirror the bits */
+	return vga_font_get_scaled_bitmap(font, win, 1);
+}
+
+/**
+ * vga_font_get_scaled_bitmap:
+ * @font: the VGA font object
+ * @win: a window on the display the bitmap is for
+ * @scale: Bitmap pixels per font pixel, each way
+ *
+ * Like vga_font_get_bitmap(), but with every glyph @scale times as wide
+ * and as high (so 32x16384 for an 8x16 font at 4x).  One bitmap is kept
+ * per display and scale.
+ *
+ * Returns: A reference to the GdkBitmap, to be released with
+ * g_object_unref()
+ */
+GdkBitmap * vga_font_get_scaled_bitmap(VGAFont * font, GdkWindow * win,
+		int scale)
+{
+	GdkDisplay * display;
+	FontBitmap * fb;
+	GSList * l;
+
+	g_return_val_if_fail(scale >= 1, NULL);
+
 	/* We only really support 8-bit width fonts */
 	g_assert(font->width == 8);
 
-	size = font->height * 256;
-	xbm = g_malloc(size);
-	/* bitflip each byte */
-	for (i = 0; i < size; i++)
-		*(xbm + i) = bitflip(*(font->data + i));
-	
-	return gdk_bitmap_create_from_data(win, xbm, font->width, size);
+	display = gdk_drawable_get_display(win);
+	for (l = font->bitmaps; l != NULL; l = l->next)
+	{
+		fb = l->data;
+		if (fb->display == display && fb->scale == scale)
+		{
+			font_patch_bitmap(font, fb, win);
+			return g_object_ref(fb->bitmap);
+		}
+	}
+
+	fb = g_new0(FontBitmap, 1);
+	fb->display = display;
+	fb->scale = scale;
+	fb->bitmap = font_render_glyphs(font, win, 0, 255, scale);
+	font->bitmaps = g_slist_prepend(font->bitmaps, fb);
+
+	return g_object_ref(fb->bitmap);
 }
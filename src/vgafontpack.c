@@ -0,0 +1,521 @@
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of version 2 of the GNU General Public License as
+ *  published by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ *****************************************************************************
+ *
+ *  Font pack layout (all integers little-endian):
+ *
+ *	header:	"VGAFPACK" version:32 count:32
+ *	names:	count entries, sorted by name
+ *	hashes:	count entry numbers:32, sorted by the entries' hashes
+ *	the raw data of each font
+ *
+ *  An entry is name[32] (NUL padded) hash:32 width:8 height:8 0:16
+ *  offset:32 0:32, where offset is where the font's width * height * 32
+ *  bytes start.  Both indexes are searched in place, so opening a pack
+ *  reads nothing but the indexes, and a font's data is only paged in when
+ *  it is drawn.
+ *
+ *  The VGAFonts made from a pack hold a reference to it, so a pack that is
+ *  closed stays mapped until the last of them is destroyed.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <string.h>
+#include "vgafontpack.h"
+
+#define PACK_MAGIC		"VGAFPACK"
+#define PACK_MAGIC_LEN		8
+#define PACK_VERSION		1
+#define PACK_HEADER_LEN		16
+#define PACK_NAME_LEN		(VGA_FONT_PACK_NAME_MAX + 1)
+#define PACK_ENTRY_LEN		48
+#define PACK_MAX_HEIGHT		32
+
+struct _VGAFontPack
+{
+	gint ref_count;		/* The opener's, and one per VGAFont */
+	GMappedFile * file;
+	const guchar * data;
+	gsize size;
+
+	guint count;
+	const guchar * entries;
+	const guchar * hashes;
+	VGAFont ** fonts;	/* Made when first asked for */
+};
+
+GQuark
+vga_font_pack_error_quark(void)
+{
+	return g_quark_from_static_string("vga-font-pack-error-quark");
+}
+
+static void
+put_le(guchar * p, guint32 v, int bytes)
+{
+	int i;
+
+	for (i = 0; i < bytes; i++, v >>= 8)
+		p[i] = v & 0xFF;
+}
+
+static guint32
+get_le(const guchar * p, int bytes)
+{
+	guint32 v = 0;
+	int i;
+
+	for (i = bytes - 1; i >= 0; i--)
+		v = (v << 8) | p[i];
+	return v;
+}
+
+/* Entry fields */
+#define ENTRY(pack, i)		((pack)->entries + (i) * PACK_ENTRY_LEN)
+#define ENTRY_NAME(e)		((const gchar *) (e))
+#define ENTRY_HASH(e)		get_le((e) + 32, 4)
+#define ENTRY_WIDTH(e)		((e)[36])
+#define ENTRY_HEIGHT(e)		((e)[37])
+#define ENTRY_OFFSET(e)		get_le((e) + 40, 4)
+#define HASH_ENTRY(pack, i)	get_le((pack)->hashes + (i) * 4, 4)
+
+/**
+ * vga_font_pack_hash:
+ * @data: Font data
+ * @len: Length of @data
+ *
+ * The hash font packs index fonts by (32 bit FNV-1a), for finding the
+ * font in a pack that matches one loaded some other way.
+ *
+ * Returns: The hash of @data
+ */
+guint32
+vga_font_pack_hash(const guchar * data, gsize len)
+{
+	guint32 h = 2166136261u;
+	gsize i;
+
+	for (i = 0; i < len; i++)
+		h = (h ^ data[i]) * 16777619u;
+	return h;
+}
+
+static void
+font_pack_unref(gpointer data)
+{
+	VGAFontPack * pack = data;
+
+	if (!g_atomic_int_dec_and_test(&pack->ref_count))
+		return;
+
+	g_mapped_file_free(pack->file);
+	g_free(pack);
+}
+
+static gboolean
+font_pack_bad(GError ** error, const gchar * filename)
+{
+	g_set_error(error, VGA_FONT_PACK_ERROR, VGA_FONT_PACK_ERROR_FORMAT,
+			"%s is not a font pack, or is damaged", filename);
+	return FALSE;
+}
+
+/* Check everything the lookups rely on, so that they needn't */
+static gboolean
+font_pack_check(VGAFontPack * pack)
+{
+	const guchar * e;
+	gsize data_start, len;
+	guint i;
+
+	data_start = PACK_HEADER_LEN + (gsize) pack->count * (PACK_ENTRY_LEN + 4);
+	for (i = 0; i < pack->count; i++)
+	{
+		e = ENTRY(pack, i);
+		if (e[PACK_NAME_LEN - 1] != '\0' || ENTRY_WIDTH(e) != 8 ||
+			ENTRY_HEIGHT(e) == 0 ||
+			ENTRY_HEIGHT(e) > PACK_MAX_HEIGHT)
+			return FALSE;
+		if (i > 0 && strcmp(ENTRY_NAME(e),
+					ENTRY_NAME(e - PACK_ENTRY_LEN)) <= 0)
+			return FALSE;
+
+		len = ENTRY_WIDTH(e) * ENTRY_HEIGHT(e) * 32;
+		if (len > pack->size || ENTRY_OFFSET(e) < data_start ||
+			ENTRY_OFFSET(e) > pack->size - len)
+			return FALSE;
+
+		if (HASH_ENTRY(pack, i) >= pack->count)
+			return FALSE;
+		if (i > 0 && ENTRY_HASH(ENTRY(pack, HASH_ENTRY(pack, i))) <
+				ENTRY_HASH(ENTRY(pack, HASH_ENTRY(pack, i - 1))))
+			return FALSE;
+	}
+
+	return TRUE;
+}
+
+/**
+ * vga_font_pack_open:
+ * @filename: Font pack to open
+ * @error: Return location for errors, or NULL
+ *
+ * Returns: a new VGAFontPack, or NULL
+ */
+VGAFontPack *
+vga_font_pack_open(const gchar * filename, GError ** error)
+{
+	VGAFontPack * pack;
+	GMappedFile * file;
+
+	g_return_val_if_fail(filename != NULL, NULL);
+
+	file = g_mapped_file_new(filename, FALSE, error);
+	if (file == NULL)
+		return NULL;
+
+	pack = g_new0(VGAFontPack, 1);
+	pack->ref_count = 1;
+	pack->file = file;
+	pack->data = (const guchar *) g_mapped_file_get_contents(file);
+	pack->size = g_mapped_file_get_length(file);
+
+	if (pack->size < PACK_HEADER_LEN ||
+		memcmp(pack->data, PACK_MAGIC, PACK_MAGIC_LEN) != 0 ||
+		get_le(pack->data + 8, 4) != PACK_VERSION)
+		goto bad;
+
+	pack->count = get_le(pack->data + 12, 4);
+	if (pack->count > (pack->size - PACK_HEADER_LEN) /
+			(PACK_ENTRY_LEN + 4))
+		goto bad;
+	pack->entries = pack->data + PACK_HEADER_LEN;
+	pack->hashes = pack->entries + pack->count * PACK_ENTRY_LEN;
+	if (!font_pack_check(pack))
+		goto bad;
+
+	pack->fonts = g_new0(VGAFont *, pack->count);
+
+	return pack;
+
+bad:
+	font_pack_bad(error, filename);
+	font_pack_unref(pack);
+	return NULL;
+}
+
+/**
+ * vga_font_pack_close:
+ * @pack: VGAFontPack
+ *
+ * Let go of @pack.  Fonts from it that are still referenced elsewhere
+ * remain valid.
+ */
+void
+vga_font_pack_close(VGAFontPack * pack)
+{
+	guint i;
+
+	g_return_if_fail(pack != NULL);
+
+	for (i = 0; i < pack->count; i++)
+		if (pack->fonts[i])
+			vga_font_destroy(pack->fonts[i]);
+	g_free(pack->fonts);
+	pack->fonts = NULL;
+
+	font_pack_unref(pack);
+}
+
+guint
+vga_font_pack_count(VGAFontPack * pack)
+{
+	g_return_val_if_fail(pack != NULL, 0);
+
+	return pack->count;
+}
+
+/**
+ * vga_font_pack_name:
+ * @pack: VGAFontPack
+ * @i: Font number, from 0 to vga_font_pack_count() - 1
+ *
+ * Fonts are numbered in order of name.
+ *
+ * Returns: The name of font @i, owned by @pack
+ */
+const gchar *
+vga_font_pack_name(VGAFontPack * pack, guint i)
+{
+	g_return_val_if_fail(pack != NULL, NULL);
+	g_return_val_if_fail(i < pack->count, NULL);
+
+	return ENTRY_NAME(ENTRY(pack, i));
+}
+
+/**
+ * vga_font_pack_get:
+ * @pack: VGAFontPack
+ * @i: Font number, from 0 to vga_font_pack_count() - 1
+ *
+ * Get font @i.  The font is made the first time it is asked for, and
+ * reads its data straight from the pack.  Like stock fonts, it can't be
+ * modified; use vga_font_ref() to keep it after the pack is closed.
+ * This may be called from any thread.
+ *
+ * Returns: Font @i, owned by @pack
+ */
+VGAFont *
+vga_font_pack_get(VGAFontPack * pack, guint i)
+{
+	const guchar * e;
+	VGAFont * font;
+
+	g_return_val_if_fail(pack != NULL, NULL);
+	g_return_val_if_fail(i < pack->count, NULL);
+
+	font = g_atomic_pointer_get((volatile gpointer *) &pack->fonts[i]);
+	if (font != NULL)
+		return font;
+
+	e = ENTRY(pack, i);
+	g_atomic_int_inc(&pack->ref_count);
+	font = vga_font_new_borrowed(pack->data + ENTRY_OFFSET(e),
+			ENTRY_WIDTH(e), ENTRY_HEIGHT(e), pack, font_pack_unref);
+
+	/* Only one font wins; the other gives back its reference */
+	if (!g_atomic_pointer_compare_and_exchange(
+				(volatile gpointer *) &pack->fonts[i], NULL, font))
+	{
+		vga_font_destroy(font);
+		font = g_atomic_pointer_get(
+				(volatile gpointer *) &pack->fonts[i]);
+	}
+
+	return font;
+}
+
+/**
+ * vga_font_pack_lookup:
+ * @pack: VGAFontPack
+ * @name: Font name, e.g. the font name of a SAUCE record
+ *
+ * Returns: The font called @name, owned by @pack, or NULL if there isn't
+ * one
+ */
+VGAFont *
+vga_font_pack_lookup(VGAFontPack * pack, const gchar * name)
+{
+	guint lo, hi, mid;
+	int cmp;
+
+	g_return_val_if_fail(pack != NULL, NULL);
+	g_return_val_if_fail(name != NULL, NULL);
+
+	lo = 0;
+	hi = pack->count;
+	while (lo < hi)
+	{
+		mid = (lo + hi) / 2;
+		cmp = strcmp(name, ENTRY_NAME(ENTRY(pack, mid)));
+		if (cmp == 0)
+			return vga_font_pack_get(pack, mid);
+		if (cmp < 0)
+			hi = mid;
+		else
+			lo = mid + 1;
+	}
+
+	return NULL;
+}
+
+/**
+ * vga_font_pack_lookup_hash:
+ * @pack: VGAFontPack
+ * @hash: vga_font_pack_hash() of the font data
+ *
+ * Returns: The font whose data has @hash, owned by @pack, or NULL if
+ * there isn't one
+ */
+VGAFont *
+vga_font_pack_lookup_hash(VGAFontPack * pack, guint32 hash)
+{
+	guint lo, hi, mid;
+
+	g_return_val_if_fail(pack != NULL, NULL);
+
+	lo = 0;
+	hi = pack->count;
+	while (lo < hi)
+	{
+		mid = (lo + hi) / 2;
+		if (ENTRY_HASH(ENTRY(pack, HASH_ENTRY(pack, mid))) < hash)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	if (lo == pack->count ||
+		ENTRY_HASH(ENTRY(pack, HASH_ENTRY(pack, lo))) != hash)
+		return NULL;
+	return vga_font_pack_get(pack, HASH_ENTRY(pack, lo));
+}
+
+/*************************************
+ * Writing
+ *************************************/
+
+typedef struct
+{
+	const gchar * name;
+	VGAFont * font;
+	guint32 hash;
+	guint entry;
+} PackItem;
+
+static int
+item_name_cmp(const void * a, const void * b)
+{
+	return strcmp(((const PackItem *) a)->name,
+			((const PackItem *) b)->name);
+}
+
+static int
+item_hash_cmp(const void * a, const void * b)
+{
+	const PackItem * x = a, * y = b;
+
+	if (x->hash != y->hash)
+		return x->hash < y->hash ? -1 : 1;
+	return x->entry < y->entry ? -1 : x->entry > y->entry;
+}
+
+/**
+ * vga_font_pack_write:
+ * @filename: File to write the pack to, which is overwritten
+ * @names: Name of each font, at most %VGA_FONT_PACK_NAME_MAX bytes
+ * @fonts: The fonts, which must be 8 pixels wide
+ * @n: Number of fonts
+ * @error: Return location for errors, or NULL
+ *
+ * Returns: TRUE on success
+ */
+gboolean
+vga_font_pack_write(const gchar * filename, const gchar * const * names,
+		VGAFont ** fonts, guint n, GError ** error)
+{
+	PackItem * items, * by_hash;
+	guchar entry[PACK_ENTRY_LEN];
+	guint32 offset;
+	FILE * f;
+	guint i;
+	gboolean ok = FALSE;
+
+	g_return_val_if_fail(filename != NULL, FALSE);
+	g_return_val_if_fail(n == 0 || (names != NULL && fonts != NULL),
+			FALSE);
+
+	items = g_new(PackItem, n);
+	for (i = 0; i < n; i++)
+	{
+		if (strlen(names[i]) > VGA_FONT_PACK_NAME_MAX ||
+			fonts[i]->data == NULL || fonts[i]->width != 8 ||
+			fonts[i]->height < 1 ||
+			fonts[i]->height > PACK_MAX_HEIGHT)
+		{
+			g_set_error(error, VGA_FONT_PACK_ERROR,
+					VGA_FONT_PACK_ERROR_FONT,
+					"Font \"%s\" can't be put in a pack",
+					names[i]);
+			g_free(items);
+			return FALSE;
+		}
+		items[i].name = names[i];
+		items[i].font = fonts[i];
+		items[i].hash = vga_font_pack_hash(fonts[i]->data,
+				vga_font_pixels(fonts[i]) * 32);
+	}
+
+	qsort(items, n, sizeof(PackItem), item_name_cmp);
+	for (i = 0; i < n; i++)
+	{
+		items[i].entry = i;
+		if (i > 0 && strcmp(items[i].name, items[i - 1].name) == 0)
+		{
+			g_set_error(error, VGA_FONT_PACK_ERROR,
+					VGA_FONT_PACK_ERROR_FONT,
+					"Two fonts are called \"%s\"",
+					items[i].name);
+			g_free(items);
+			return FALSE;
+		}
+	}
+	by_hash = g_memdup(items, n * sizeof(PackItem));
+	qsort(by_hash, n, sizeof(PackItem), item_hash_cmp);
+
+	f = fopen(filename, "wb");
+	if (f == NULL)
+	{
+		g_set_error(error, G_FILE_ERROR,
+				g_file_error_from_errno(errno),
+				"Unable to create %s: %s", filename,
+				g_strerror(errno));
+		goto done;
+	}
+
+	memset(entry, 0, sizeof(entry));
+	memcpy(entry, PACK_MAGIC, PACK_MAGIC_LEN);
+	put_le(entry + 8, PACK_VERSION, 4);
+	put_le(entry + 12, n, 4);
+	fwrite(entry, PACK_HEADER_LEN, 1, f);
+
+	offset = PACK_HEADER_LEN + n * (PACK_ENTRY_LEN + 4);
+	for (i = 0; i < n; i++)
+	{
+		memset(entry, 0, sizeof(entry));
+		strncpy((gchar *) entry, items[i].name, PACK_NAME_LEN);
+		put_le(entry + 32, items[i].hash, 4);
+		entry[36] = items[i].font->width;
+		entry[37] = items[i].font->height;
+		put_le(entry + 40, offset, 4);
+		fwrite(entry, PACK_ENTRY_LEN, 1, f);
+		offset += vga_font_pixels(items[i].font) * 32;
+	}
+
+	for (i = 0; i < n; i++)
+	{
+		put_le(entry, by_hash[i].entry, 4);
+		fwrite(entry, 4, 1, f);
+	}
+
+	for (i = 0; i < n; i++)
+		fwrite(items[i].font->data,
+			vga_font_pixels(items[i].font) * 32, 1, f);
+
+	ok = !ferror(f);
+	if (fclose(f) != 0)
+		ok = FALSE;
+	if (!ok)
+		g_set_error(error, VGA_FONT_PACK_ERROR,
+				VGA_FONT_PACK_ERROR_IO, "Unable to write %s: %s",
+				filename, g_strerror(errno));
+
+done:
+	g_free(by_hash);
+	g_free(items);
+	return ok;
+}
@@ -0,0 +1,209 @@
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of version 2 of the GNU General Public License as
+ *  published by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ *****************************************************************************
+ *
+ *  Loads run on a small shared thread pool, so a slow file system holds up
+ *  other loads at worst, never the display.  Each load always ends with
+ *  exactly one idle callback on the main loop, which calls the caller's
+ *  function unless the load was cancelled, and frees the load.  Since
+ *  cancelling also happens on the main loop, it can't race with that.
+ */
+
+#include "vgaload.h"
+
+#define LOAD_THREADS	4
+
+typedef enum
+{
+	LOAD_FONT, LOAD_PALETTE
+} LoadType;
+
+struct _VGALoad
+{
+	LoadType type;
+	gchar * fname;
+	GCallback func;
+	gpointer user_data;
+	gint cancelled;
+
+	/* Set by the worker */
+	gpointer result;	/* VGAFont or VGAPalette, NULL on failure */
+};
+
+static GThreadPool * load_pool = NULL;
+
+GQuark
+vga_load_error_quark(void)
+{
+	return g_quark_from_static_string("vga-load-error-quark");
+}
+
+/* Main loop: hand over the result, or throw it away */
+static gboolean
+load_done(gpointer data)
+{
+	VGALoad * load = data;
+	GError * error = NULL;
+
+	if (!g_atomic_int_get(&load->cancelled))
+	{
+		if (load->result == NULL)
+			g_set_error(&error, VGA_LOAD_ERROR,
+					VGA_LOAD_ERROR_FAILED,
+					"Unable to load %s %s",
+					load->type == LOAD_FONT ?
+						"font" : "palette",
+					load->fname);
+
+		GDK_THREADS_ENTER();
+		if (load->type == LOAD_FONT)
+			((VGAFontLoadFunc) load->func)(load->result, error,
+					load->user_data);
+		else
+			((VGAPaletteLoadFunc) load->func)(load->result, error,
+					load->user_data);
+		GDK_THREADS_LEAVE();
+
+		if (error)
+			g_error_free(error);
+	}
+	else if (load->result)
+	{
+		if (load->type == LOAD_FONT)
+			vga_font_destroy(load->result);
+		else
+			vga_palette_destroy(load->result);
+	}
+
+	g_free(load->fname);
+	g_free(load);
+
+	return FALSE;
+}
+
+/* Worker: load the file, which also converts it, unless cancelled */
+static void
+load_run(gpointer data, gpointer pool_data)
+{
+	VGALoad * load = data;
+	VGAFont * font;
+	VGAPalette * pal;
+
+	if (g_atomic_int_get(&load->cancelled))
+		goto done;
+
+	if (load->type == LOAD_FONT)
+	{
+		font = vga_font_new();
+		if (vga_font_load_from_file(font, load->fname))
+			load->result = font;
+		else
+			vga_font_destroy(font);
+	}
+	else
+	{
+		pal = vga_palette_new();
+		if (vga_palette_load_from_file(pal, (guchar *) load->fname))
+			load->result = pal;
+		else
+			vga_palette_destroy(pal);
+	}
+
+done:
+	g_idle_add(load_done, load);
+}
+
+static VGALoad *
+load_start(LoadType type, const gchar * fname, GCallback func,
+		gpointer user_data)
+{
+	VGALoad * load;
+
+	if (load_pool == NULL)
+	{
+		if (!g_thread_supported())
+			g_thread_init(NULL);
+		load_pool = g_thread_pool_new(load_run, NULL, LOAD_THREADS,
+				FALSE, NULL);
+	}
+
+	load = g_new0(VGALoad, 1);
+	load->type = type;
+	load->fname = g_strdup(fname);
+	load->func = func;
+	load->user_data = user_data;
+
+	g_thread_pool_push(load_pool, load, NULL);
+
+	return load;
+}
+
+/**
+ * vga_font_load_async:
+ * @fname: the filename of the VGA font file to load
+ * @func: called on the main loop with the font, or an error
+ * @user_data: data for @func
+ *
+ * vga_font_load_from_file() into a new font, on a worker thread.  @func
+ * gets the font, ready to draw, and must vga_font_destroy() it when done.
+ *
+ * Returns: A handle for vga_load_cancel(), valid until @func is called
+ */
+VGALoad *
+vga_font_load_async(const gchar * fname, VGAFontLoadFunc func,
+		gpointer user_data)
+{
+	g_return_val_if_fail(fname != NULL, NULL);
+	g_return_val_if_fail(func != NULL, NULL);
+
+	return load_start(LOAD_FONT, fname, G_CALLBACK(func), user_data);
+}
+
+/**
+ * vga_palette_load_async:
+ * @fname: the filename of the VGA palette file to load
+ * @func: called on the main loop with the palette, or an error
+ * @user_data: data for @func
+ *
+ * vga_palette_load_from_file() into a new palette, on a worker thread.
+ * @func gets the palette and must vga_palette_destroy() it when done.
+ *
+ * Returns: A handle for vga_load_cancel(), valid until @func is called
+ */
+VGALoad *
+vga_palette_load_async(const gchar * fname, VGAPaletteLoadFunc func,
+		gpointer user_data)
+{
+	g_return_val_if_fail(fname != NULL, NULL);
+	g_return_val_if_fail(func != NULL, NULL);
+
+	return load_start(LOAD_PALETTE, fname, G_CALLBACK(func), user_data);
+}
+
+/**
+ * vga_load_cancel:
+ * @load: A load whose function hasn't been called yet
+ *
+ * Stop a load: its function won't be called, and whatever it loaded is
+ * freed.  A load that hasn't started yet doesn't touch the file.  The
+ * handle is invalid afterwards.
+ */
+void
+vga_load_cancel(VGALoad * load)
+{
+	g_return_if_fail(load != NULL);
+
+	g_atomic_int_set(&load->cancelled, 1);
+}
@@ -18,6 +18,34 @@
 
 #include "vgapalette.h"
 #include "def_palette.h"
+#include "def_palette_tables.h"	/* Generated by tools/mkdeftables */
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+/* These are the palette registers for the standard EGA colors */
+const guchar vga_palette_text_regs[16] =
+	{0,1,2,3,4,5,20,7,56,57,58,59,60,61,62,63};
+
+/* Bring color[] and rgb[] into line with vga[] for registers @from to @to-1 */
+static void
+palette_update(VGAPalette * pal, int from, int to)
+{
+	const guchar * v;
+	int i;
+
+	v = pal->vga + from * 3;
+	for (i = from; i < to; i++, v += 3)
+	{
+		pal->color[i].red = gdk_levels[v[0]];
+		pal->color[i].green = gdk_levels[v[1]];
+		pal->color[i].blue = gdk_levels[v[2]];
+	}
+
+	for (i = from * 3; i < to * 3; i++)
+		pal->rgb[i] = rgb_levels[pal->vga[i]];
+}
 
 /**
  * vga_palette_new:
@@ -55,8 +83,7 @@ VGAPalette * vga_palette_stock(StockPalette id)
 	static VGAPalette * white = NULL;
 	static VGAPalette * greyscale = NULL;
 	int i;
-	long avg;
-	guint16 value;
+	guchar avg;
 
 	/*
 	 * Lazy allocation: Palette objects don't really exist until they're
@@ -75,23 +102,15 @@ VGAPalette * vga_palette_stock(StockPalette id)
 		if (white == NULL)
 		{
 			white = vga_palette_new();
-			value = TO_GDK_RGB(63);
-				
-			for (i = 0; i < PAL_REGS; i++)
-			{
-				white->color[i].red =
-				white->color[i].green =
-				white->color[i].blue = value;
-			}
+			memset(white->vga, 63, sizeof(white->vga));
+			palette_update(white, 0, PAL_REGS);
 		}
 		return white;
 	case PAL_BLACK:
 		if (black == NULL)
 		{
+			/* vga_palette_new() is all zeroes already */
 			black = vga_palette_new();
-			memset(black->color,
-				0,
-				PAL_REGS * sizeof(GdkColor));
 		}
 		return black;
 	case PAL_GREYSCALE:
@@ -103,15 +122,16 @@ VGAPalette * vga_palette_stock(StockPalette id)
 			greyscale = vga_palette_new();
 			vga_palette_load_default(greyscale);
 			
-			for (i = 0; i < PAL_REGS; i++)
+			for (i = 0; i < PAL_REGS * 3; i += 3)
 			{
-				avg =	(greyscale->color[i].red +
-					greyscale->color[i].green +
-					greyscale->color[i].blue) / 3;
-				greyscale->color[i].red =
-				greyscale->color[i].green =
-				greyscale->color[i].blue = avg;
+				avg =	(greyscale->vga[i] +
+					greyscale->vga[i + 1] +
+					greyscale->vga[i + 2]) / 3;
+				greyscale->vga[i] =
+				greyscale->vga[i + 1] =
+				greyscale->vga[i + 2] = avg;
 			}
+			palette_update(greyscale, 0, PAL_REGS);
 		}
 		return greyscale;
 	default:
@@ -132,9 +152,8 @@ VGAPalette * vga_palette_stock(StockPalette id)
 VGAPalette * vga_palette_dup(VGAPalette * pal)
 {
 	VGAPalette * tmp;
-	tmp = vga_palette_new();
-	memcpy(tmp->color, pal->color,
-			PAL_REGS * sizeof(GdkColor));
+	tmp = g_new(VGAPalette, 1);
+	memcpy(tmp, pal, sizeof(VGAPalette));
 	return tmp;
 }
 
@@ -150,8 +169,7 @@ VGAPalette * vga_palette_dup(VGAPalette * pal)
  */
 VGAPalette * vga_palette_copy_from(VGAPalette * pal, VGAPalette * srcpal)
 {
-	memcpy(pal->color, srcpal->color,
-			PAL_REGS * sizeof(GdkColor));
+	memcpy(pal, srcpal, sizeof(VGAPalette));
 	return pal;
 }
 
@@ -177,16 +195,16 @@ void vga_palette_destroy(VGAPalette * pal)
  **/
 gboolean vga_palette_load(VGAPalette * pal, guchar * data, int size)
 {
-	int i, n = 0;
-	g_return_val_if_fail(size < PAL_REGS*3, FALSE);
+	int i, n;
+	g_return_val_if_fail(size <= PAL_REGS*3, FALSE);
 
-	for (i = 0; i < size; i += 3)
-	{
-		pal->color[n].pixel = -1;
-		pal->color[n].red = TO_GDK_RGB(*((guchar *) (data + i)));
-		pal->color[n].green = TO_GDK_RGB(*((guchar *) (data + i + 1)));
-		pal->color[n++].blue = TO_GDK_RGB(*((guchar *) (data + i + 2)));
-	}
+	/* Only whole registers */
+	n = size / 3;
+	for (i = 0; i < n * 3; i++)
+		pal->vga[i] = data[i] & 0x3F;
+	for (i = 0; i < n; i++)
+		pal->color[i].pixel = -1;
+	palette_update(pal, 0, n);
 
 	return TRUE;
 }
@@ -246,9 +264,10 @@ gboolean vga_palette_load_from_file(VGAPalette * pal, guchar * fname)
 void vga_palette_set_reg(VGAPalette * pal, guchar reg, guchar r, guchar g,
 		guchar b)
 {
-	pal->color[reg].red = TO_GDK_RGB(r);
-	pal->color[reg].green = TO_GDK_RGB(g);
-	pal->color[reg].blue = TO_GDK_RGB(b); 
+	pal->vga[reg * 3] = r & 0x3F;
+	pal->vga[reg * 3 + 1] = g & 0x3F;
+	pal->vga[reg * 3 + 2] = b & 0x3F;
+	palette_update(pal, reg, reg + 1);
 }
 
 
@@ -260,8 +279,11 @@ void vga_palette_set_reg(VGAPalette * pal, guchar reg, guchar r, guchar g,
  */
 void vga_palette_load_default(VGAPalette * pal)
 {
-	/* FIXME: Hardcoded default palette size */
-	vga_palette_load(pal, default_palette, 192);
+	/* Everything was converted at build time */
+	memcpy(pal->vga, default_palette, sizeof(default_palette));
+	memcpy(pal->rgb, default_palette_rgb, sizeof(default_palette_rgb));
+	memcpy(pal->color, default_palette_color,
+			sizeof(default_palette_color));
 }
 
 
@@ -277,30 +299,25 @@ void vga_palette_load_default(VGAPalette * pal)
  */
 void vga_palette_morph_to_step(VGAPalette * pal, VGAPalette * srcpal)
 {
-	int i;
-	guint16 step;
+	int i = 0;
+#ifdef __SSE2__
+	const __m128i one = _mm_set1_epi8(1);
+	__m128i a, b, up, down;
 
-	step = TO_GDK_RGB(1);
-	for (i = 0; i < PAL_REGS; i++)
+	/* Each byte moves by the saturated difference, capped at 1 */
+	for (; i + 16 <= PAL_REGS * 3; i += 16)
 	{
-		if (pal->color[i].red > srcpal->color[i].red)
-			pal->color[i].red = MAX(pal->color[i].red - step,
-						srcpal->color[i].red);
-		else
-			pal->color[i].red = MIN(pal->color[i].red + step,
-						srcpal->color[i].red);
-		if (pal->color[i].green > srcpal->color[i].green)
-			pal->color[i].green = MAX(pal->color[i].green - step,
-						srcpal->color[i].green);
-		else
-			pal->color[i].green = MIN(pal->color[i].green + step,
-						srcpal->color[i].green);
-		if (pal->color[i].blue > srcpal->color[i].blue)
-			pal->color[i].blue = MAX(pal->color[i].blue - step,
-						srcpal->color[i].blue);
-		else
-			pal->color[i].blue = MIN(pal->color[i].blue + step,
-						srcpal->color[i].blue);
-
+		a = _mm_loadu_si128((const __m128i *) (pal->vga + i));
+		b = _mm_loadu_si128((const __m128i *) (srcpal->vga + i));
+		up = _mm_min_epu8(_mm_subs_epu8(b, a), one);
+		down = _mm_min_epu8(_mm_subs_epu8(a, b), one);
+		a = _mm_subs_epu8(_mm_adds_epu8(a, up), down);
+		_mm_storeu_si128((__m128i *) (pal->vga + i), a);
 	}
+#endif
+	for (; i < PAL_REGS * 3; i++)
+		pal->vga[i] += (pal->vga[i] < srcpal->vga[i]) -
+			(pal->vga[i] > srcpal->vga[i]);
+
+	palette_update(pal, 0, PAL_REGS);
 }
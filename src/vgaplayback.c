@@ -0,0 +1,396 @@
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of version 2 of the GNU General Public License as
+ *  published by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ *****************************************************************************
+ *
+ *  Rate-controlled playback.  The position that is due is worked out from
+ *  an anchor -- the position and clock reading at the last play, seek or
+ *  rate change -- so rounding never accumulates and a late tick simply
+ *  parses more.
+ *
+ *  Seeking uses keyframes: complete copies of the screen and the parser
+ *  state, taken every so many bytes the first time playback gets there.
+ *  A seek restores the closest keyframe before the target and parses only
+ *  the rest, however far into the data the target is.
+ */
+
+#include "vgaplayback.h"
+
+#define PLAYBACK_FRAME_MS	16
+#define PLAYBACK_BUDGET		0.008	/* Seconds of parsing per frame */
+#define PLAYBACK_SLICE		4096	/* Check the clock this often */
+#define PLAYBACK_KEY_INTERVAL	(64 * 1024)
+
+typedef struct
+{
+	gsize pos;
+	VGAScreen * scr;	/* Video buffer, cursor, window, font, palette */
+	EmuData * emu;		/* Parser state */
+} Keyframe;
+
+struct _VGAPlayback
+{
+	GtkWidget * term;
+	EmuData * emu;
+	GArray * keys;		/* Keyframes by position; the first is 0 */
+	gsize key_interval;
+
+	const guchar * data;
+	gsize len;
+	gsize pos;		/* Bytes parsed */
+	GDestroyNotify free_func;
+
+	guint rate;		/* Characters per second, 0 for unlimited */
+	gboolean playing;
+	guint timeout_id;
+	GTimer * clock;
+	gsize anchor_pos;
+	GTimer * timer;
+
+	VGAPlaybackFunc done_func;
+	gpointer done_data;
+};
+
+/* Restart the clock from the current position */
+static void
+playback_anchor(VGAPlayback * pb)
+{
+	pb->anchor_pos = pb->pos;
+	g_timer_start(pb->clock);
+}
+
+/* The position playback should have reached by now */
+static gsize
+playback_due(VGAPlayback * pb)
+{
+	gdouble due;
+
+	if (!pb->playing)
+		return pb->pos;
+	if (pb->rate == VGA_PLAYBACK_UNLIMITED)
+		return pb->len;
+
+	due = pb->anchor_pos + g_timer_elapsed(pb->clock, NULL) * pb->rate;
+	return due >= pb->len ? pb->len : (gsize) due;
+}
+
+/* Save the terminal's current state as a keyframe */
+static void
+playback_add_key(VGAPlayback * pb)
+{
+	Keyframe key;
+
+	key.pos = pb->pos;
+	key.scr = vga_screen_dup(vga_get_screen(pb->term));
+	vga_screen_clear_damage(key.scr);
+	key.emu = vga_emu_new(key.scr);
+	vga_emu_copy_state(key.emu, pb->emu);
+
+	g_array_append_val(pb->keys, key);
+}
+
+/* The last keyframe at or before @pos */
+static Keyframe *
+playback_find_key(VGAPlayback * pb, gsize pos)
+{
+	Keyframe * keys = (Keyframe *) pb->keys->data;
+	guint lo = 0, hi = pb->keys->len - 1, mid;
+
+	while (lo < hi)
+	{
+		mid = (lo + hi + 1) / 2;
+		if (keys[mid].pos <= pos)
+			lo = mid;
+		else
+			hi = mid - 1;
+	}
+
+	return &keys[lo];
+}
+
+/* Where the next keyframe should be taken, if playback gets that far */
+static gsize
+playback_next_key(VGAPlayback * pb)
+{
+	return g_array_index(pb->keys, Keyframe, pb->keys->len - 1).pos +
+		pb->key_interval;
+}
+
+/* Parse up to @target, giving up after @budget seconds if it's > 0 */
+static void
+playback_feed(VGAPlayback * pb, gsize target, gdouble budget)
+{
+	gsize n, key;
+
+	key = playback_next_key(pb);
+
+	g_timer_start(pb->timer);
+	while (pb->pos < target)
+	{
+		n = MIN(target - pb->pos, PLAYBACK_SLICE);
+		if (pb->pos < key)
+			n = MIN(n, key - pb->pos);
+		vga_emu_write(pb->emu, pb->data + pb->pos, n);
+		pb->pos += n;
+
+		if (pb->pos >= key)
+		{
+			playback_add_key(pb);
+			key = playback_next_key(pb);
+		}
+
+		if (budget > 0 && g_timer_elapsed(pb->timer, NULL) >= budget)
+			break;
+	}
+}
+
+static void
+playback_stop_clock(VGAPlayback * pb)
+{
+	if (pb->timeout_id)
+	{
+		g_source_remove(pb->timeout_id);
+		pb->timeout_id = 0;
+	}
+	pb->playing = FALSE;
+}
+
+static gboolean
+playback_tick(gpointer user_data)
+{
+	VGAPlayback * pb = user_data;
+
+	playback_feed(pb, playback_due(pb), PLAYBACK_BUDGET);
+	vga_term_update(pb->term);
+
+	if (pb->pos < pb->len)
+		return TRUE;
+
+	pb->timeout_id = 0;
+	pb->playing = FALSE;
+	if (pb->done_func)
+		pb->done_func(pb, pb->done_data);
+
+	return FALSE;
+}
+
+/**
+ * vga_playback_new:
+ * @term: VGATerm widget, with vga_term_emu_init() already done
+ * @data: Data to play
+ * @len: Length of @data
+ * @free_func: Called on @data when the playback is destroyed, or NULL
+ *
+ * Create a paused playback of @data on @term, at unlimited speed.  The
+ * terminal's current contents are where playback starts from, and where
+ * seeking backwards goes back to.
+ *
+ * Returns: a new VGAPlayback
+ */
+VGAPlayback *
+vga_playback_new(GtkWidget * term, const guchar * data, gsize len,
+		GDestroyNotify free_func)
+{
+	VGAPlayback * pb;
+
+	g_return_val_if_fail(term != NULL, NULL);
+	g_return_val_if_fail(vga_term_emu_get_data(term) != NULL, NULL);
+	g_return_val_if_fail(data != NULL || len == 0, NULL);
+
+	pb = g_new0(VGAPlayback, 1);
+	pb->term = term;
+	g_object_ref(term);
+	pb->emu = vga_term_emu_get_data(term);
+	pb->keys = g_array_new(FALSE, FALSE, sizeof(Keyframe));
+	pb->key_interval = PLAYBACK_KEY_INTERVAL;
+	playback_add_key(pb);
+
+	pb->data = data;
+	pb->len = len;
+	pb->free_func = free_func;
+
+	pb->clock = g_timer_new();
+	pb->timer = g_timer_new();
+
+	return pb;
+}
+
+void
+vga_playback_destroy(VGAPlayback * pb)
+{
+	Keyframe * key;
+	guint i;
+
+	g_return_if_fail(pb != NULL);
+
+	playback_stop_clock(pb);
+
+	for (i = 0; i < pb->keys->len; i++)
+	{
+		key = &g_array_index(pb->keys, Keyframe, i);
+		vga_emu_destroy(key->emu);
+		vga_screen_destroy(key->scr);
+	}
+	g_array_free(pb->keys, TRUE);
+
+	if (pb->free_func)
+		pb->free_func((gpointer) pb->data);
+	g_timer_destroy(pb->clock);
+	g_timer_destroy(pb->timer);
+	g_object_unref(pb->term);
+	g_free(pb);
+}
+
+/**
+ * vga_playback_set_done_func:
+ * @pb: VGAPlayback
+ * @func: Function to call when playback reaches the end, or NULL
+ * @user_data: Data for @func
+ *
+ * @func may destroy the playback.
+ */
+void
+vga_playback_set_done_func(VGAPlayback * pb, VGAPlaybackFunc func,
+		gpointer user_data)
+{
+	g_return_if_fail(pb != NULL);
+
+	pb->done_func = func;
+	pb->done_data = user_data;
+}
+
+void
+vga_playback_play(VGAPlayback * pb)
+{
+	g_return_if_fail(pb != NULL);
+
+	if (pb->playing || pb->pos >= pb->len)
+		return;
+
+	pb->playing = TRUE;
+	playback_anchor(pb);
+	pb->timeout_id = g_timeout_add(PLAYBACK_FRAME_MS, playback_tick, pb);
+}
+
+void
+vga_playback_pause(VGAPlayback * pb)
+{
+	g_return_if_fail(pb != NULL);
+
+	playback_stop_clock(pb);
+}
+
+gboolean
+vga_playback_is_playing(VGAPlayback * pb)
+{
+	g_return_val_if_fail(pb != NULL, FALSE);
+
+	return pb->playing;
+}
+
+/**
+ * vga_playback_set_rate:
+ * @pb: VGAPlayback
+ * @cps: Characters per second, or %VGA_PLAYBACK_UNLIMITED
+ *
+ * Change the playback speed.  This may be done while playing.
+ */
+void
+vga_playback_set_rate(VGAPlayback * pb, guint cps)
+{
+	g_return_if_fail(pb != NULL);
+
+	/* Whatever was due at the old rate is parsed on the next tick */
+	pb->anchor_pos = playback_due(pb);
+	g_timer_start(pb->clock);
+	pb->rate = cps;
+}
+
+guint
+vga_playback_get_rate(VGAPlayback * pb)
+{
+	g_return_val_if_fail(pb != NULL, 0);
+
+	return pb->rate;
+}
+
+/**
+ * vga_playback_seek:
+ * @pb: VGAPlayback
+ * @pos: Byte offset to go to
+ *
+ * Show the terminal as it is after the first @pos bytes have been played.
+ * This starts from the closest keyframe (or the current position, if that
+ * is closer) and parses the rest at once.  Playback carries on from @pos
+ * if it was playing.
+ */
+void
+vga_playback_seek(VGAPlayback * pb, gsize pos)
+{
+	Keyframe * key;
+
+	g_return_if_fail(pb != NULL);
+
+	pos = MIN(pos, pb->len);
+
+	/* Nothing in between is drawn, palette morphs included */
+	vga_term_set_fast_forward(pb->term, TRUE);
+
+	key = playback_find_key(pb, pos);
+	if (pos < pb->pos || key->pos > pb->pos)
+	{
+		vga_screen_copy_from(vga_get_screen(pb->term), key->scr);
+		vga_emu_copy_state(pb->emu, key->emu);
+		pb->pos = key->pos;
+	}
+	playback_feed(pb, pos, 0);
+
+	vga_term_set_fast_forward(pb->term, FALSE);
+
+	playback_anchor(pb);
+}
+
+/**
+ * vga_playback_set_keyframe_interval:
+ * @pb: VGAPlayback
+ * @bytes: Bytes of data between keyframes
+ *
+ * Each keyframe costs a copy of the screen, font and palette.  Closer
+ * keyframes make seeking faster at the cost of memory.  Only affects
+ * keyframes taken from now on.
+ */
+void
+vga_playback_set_keyframe_interval(VGAPlayback * pb, gsize bytes)
+{
+	g_return_if_fail(pb != NULL);
+	g_return_if_fail(bytes > 0);
+
+	pb->key_interval = bytes;
+}
+
+gsize
+vga_playback_get_position(VGAPlayback * pb)
+{
+	g_return_val_if_fail(pb != NULL, 0);
+
+	return pb->pos;
+}
+
+gsize
+vga_playback_get_length(VGAPlayback * pb)
+{
+	g_return_val_if_fail(pb != NULL, 0);
+
+	return pb->len;
+}
@@ -0,0 +1,343 @@
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of version 2 of the GNU General Public License as
+ *  published by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ *****************************************************************************
+ *
+ *  PNGs are written with zlib directly: 8-bit RGB, no interlacing and no
+ *  row filters, which suits the flat colors of text mode.  The deflate
+ *  stream is fed one scanline at a time and cut into IDAT chunks as its
+ *  output buffer fills.
+ */
+
+#include <stdio.h>
+#include <errno.h>
+#include <string.h>
+#include <zlib.h>
+#include "vgaraster.h"
+
+#define RASTER_MAX_SCALE	8
+#define RASTER_ZBUF		(64 * 1024)
+
+struct _VGARaster
+{
+	int scale;
+	guint pal_serial;	/* Palette color was taken from, 0 if none */
+	guchar color[16][3];
+	guchar * band;		/* One text row of pixels, for saving */
+	gsize band_size;
+	guchar * zbuf;
+};
+
+typedef struct
+{
+	FILE * f;
+	z_stream z;
+	guchar * zbuf;
+} PngWriter;
+
+GQuark
+vga_raster_error_quark(void)
+{
+	return g_quark_from_static_string("vga-raster-error-quark");
+}
+
+VGARaster *
+vga_raster_new(void)
+{
+	VGARaster * raster;
+
+	raster = g_new0(VGARaster, 1);
+	raster->scale = 1;
+
+	return raster;
+}
+
+void
+vga_raster_destroy(VGARaster * raster)
+{
+	g_return_if_fail(raster != NULL);
+
+	g_free(raster->band);
+	g_free(raster->zbuf);
+	g_free(raster);
+}
+
+/* Draw every font pixel as a @scale by @scale square */
+void
+vga_raster_set_scale(VGARaster * raster, int scale)
+{
+	g_return_if_fail(raster != NULL);
+	g_return_if_fail(scale >= 1 && scale <= RASTER_MAX_SCALE);
+
+	raster->scale = scale;
+}
+
+int
+vga_raster_get_scale(VGARaster * raster)
+{
+	g_return_val_if_fail(raster != NULL, 1);
+
+	return raster->scale;
+}
+
+/* Width in pixels of @scr when rendered */
+int
+vga_raster_width(VGARaster * raster, VGAScreen * scr)
+{
+	return scr->cols * scr->font->width * raster->scale;
+}
+
+/* Height in pixels of the first @rows rows of @scr when rendered */
+int
+vga_raster_height(VGARaster * raster, VGAScreen * scr, int rows)
+{
+	return rows * scr->font->height * raster->scale;
+}
+
+static void
+raster_load_palette(VGARaster * raster, VGAScreen * scr)
+{
+	int i;
+
+	if (raster->pal_serial == scr->pal_serial)
+		return;
+
+	for (i = 0; i < 16; i++)
+	{
+		memcpy(raster->color[i],
+			&scr->pal->rgb[vga_palette_text_regs[i] * 3], 3);
+	}
+	raster->pal_serial = scr->pal_serial;
+}
+
+/**
+ * vga_raster_render:
+ * @raster: VGARaster
+ * @scr: Screen to render
+ * @row: First row to render
+ * @rows: Number of rows
+ * @pixels: Where to put the RGB pixels
+ * @rowstride: Bytes from one line of @pixels to the next
+ *
+ * Render part of a screen.  @pixels must have room for
+ * vga_raster_height(@raster, @scr, @rows) lines of
+ * vga_raster_width(@raster, @scr) pixels.
+ */
+void
+vga_raster_render(VGARaster * raster, VGAScreen * scr, int row, int rows,
+		guchar * pixels, int rowstride)
+{
+	VGAFont * font = scr->font;
+	vga_charcell * cell;
+	const guchar * fg, * bg, * glyphs, * cov;
+	guchar * line, * p, m;
+	int width, s, r, x, y, i, k;
+
+	g_return_if_fail(raster != NULL);
+	g_return_if_fail(scr != NULL);
+	g_return_if_fail(row >= 0 && rows >= 0 && row + rows <= scr->rows);
+	/* Like VGAText, only fonts up to 8 pixels wide are supported */
+	g_return_if_fail(font->width <= 8);
+
+	raster_load_palette(raster, scr);
+	glyphs = vga_font_get_coverage(font);
+	width = vga_raster_width(raster, scr);
+	s = raster->scale;
+
+	for (r = row; r < row + rows; r++)
+	{
+		for (y = 0; y < font->height; y++)
+		{
+			line = pixels + ((r - row) * font->height + y) * s *
+				rowstride;
+			p = line;
+			cell = &scr->video_buf[r * scr->cols];
+			for (x = 0; x < scr->cols; x++, cell++)
+			{
+				/* Blinking characters are drawn "on" */
+				fg = raster->color[GETFG(cell->attr)];
+				if (GETBLINK(cell->attr) && scr->icecolor)
+					bg = raster->color[BRIGHT(GETBG(cell->attr))];
+				else
+					bg = raster->color[GETBG(cell->attr)];
+
+				cov = glyphs + (cell->c * font->height + y) *
+					font->width;
+				for (i = 0; i < font->width; i++)
+				{
+					m = cov[i];
+					for (k = 0; k < s; k++)
+					{
+						*p++ = (fg[0] & m) | (bg[0] & ~m);
+						*p++ = (fg[1] & m) | (bg[1] & ~m);
+						*p++ = (fg[2] & m) | (bg[2] & ~m);
+					}
+				}
+			}
+
+			for (k = 1; k < s; k++)
+				memcpy(line + k * rowstride, line, width * 3);
+		}
+	}
+}
+
+static void
+png_put_u32(guchar * p, guint32 v)
+{
+	p[0] = v >> 24;
+	p[1] = v >> 16;
+	p[2] = v >> 8;
+	p[3] = v;
+}
+
+static void
+png_chunk(PngWriter * png, const char * type, const guchar * data,
+		guint32 len)
+{
+	guchar buf[4];
+	uLong crc;
+
+	png_put_u32(buf, len);
+	fwrite(buf, 1, 4, png->f);
+	fwrite(type, 1, 4, png->f);
+	crc = crc32(0, (const Bytef *) type, 4);
+	if (len > 0)
+	{
+		fwrite(data, 1, len, png->f);
+		crc = crc32(crc, data, len);
+	}
+	png_put_u32(buf, crc);
+	fwrite(buf, 1, 4, png->f);
+}
+
+/* Compress image data, writing an IDAT whenever the buffer fills */
+static void
+png_deflate(PngWriter * png, const guchar * data, gsize len, int flush)
+{
+	int ret;
+
+	png->z.next_in = (Bytef *) data;
+	png->z.avail_in = len;
+
+	do
+	{
+		ret = deflate(&png->z, flush);
+		if (png->z.avail_out == 0 ||
+			(flush == Z_FINISH && ret == Z_STREAM_END))
+		{
+			png_chunk(png, "IDAT", png->zbuf,
+					RASTER_ZBUF - png->z.avail_out);
+			png->z.next_out = png->zbuf;
+			png->z.avail_out = RASTER_ZBUF;
+		}
+	}
+	while (png->z.avail_in > 0 ||
+		(flush == Z_FINISH && ret != Z_STREAM_END && ret != Z_STREAM_ERROR));
+}
+
+/**
+ * vga_raster_save_png:
+ * @raster: VGARaster
+ * @scr: Screen to render
+ * @rows: Number of rows to save, from the top, or 0 for all of them
+ * @filename: File to write
+ * @error: Return location for errors, or NULL
+ *
+ * Render a screen to a PNG file.
+ *
+ * Returns: FALSE if the file couldn't be written
+ */
+gboolean
+vga_raster_save_png(VGARaster * raster, VGAScreen * scr, int rows,
+		const gchar * filename, GError ** error)
+{
+	static const guchar signature[8] =
+		{ 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+	static const guchar filter = 0;
+	PngWriter png;
+	guchar ihdr[13];
+	gsize size;
+	int width, height, lines, r, y;
+	gboolean ok;
+
+	g_return_val_if_fail(raster != NULL, FALSE);
+	g_return_val_if_fail(scr != NULL, FALSE);
+	g_return_val_if_fail(filename != NULL, FALSE);
+
+	if (rows <= 0 || rows > scr->rows)
+		rows = scr->rows;
+	width = vga_raster_width(raster, scr);
+	height = vga_raster_height(raster, scr, rows);
+	lines = vga_raster_height(raster, scr, 1);
+
+	png.f = fopen(filename, "wb");
+	if (png.f == NULL)
+	{
+		g_set_error(error, VGA_RASTER_ERROR, VGA_RASTER_ERROR_IO,
+				"Unable to create %s: %s", filename,
+				g_strerror(errno));
+		return FALSE;
+	}
+
+	size = (gsize) width * 3 * lines;
+	if (raster->band_size < size)
+	{
+		g_free(raster->band);
+		raster->band = g_malloc(size);
+		raster->band_size = size;
+	}
+	if (raster->zbuf == NULL)
+		raster->zbuf = g_malloc(RASTER_ZBUF);
+
+	memset(&png.z, 0, sizeof(png.z));
+	deflateInit(&png.z, Z_DEFAULT_COMPRESSION);
+	png.zbuf = raster->zbuf;
+	png.z.next_out = png.zbuf;
+	png.z.avail_out = RASTER_ZBUF;
+
+	fwrite(signature, 1, sizeof(signature), png.f);
+	png_put_u32(ihdr, width);
+	png_put_u32(ihdr + 4, height);
+	ihdr[8] = 8;		/* Bit depth */
+	ihdr[9] = 2;		/* RGB */
+	ihdr[10] = 0;		/* Deflate */
+	ihdr[11] = 0;		/* Filters */
+	ihdr[12] = 0;		/* Not interlaced */
+	png_chunk(&png, "IHDR", ihdr, sizeof(ihdr));
+
+	for (r = 0; r < rows; r++)
+	{
+		vga_raster_render(raster, scr, r, 1, raster->band, width * 3);
+		for (y = 0; y < lines; y++)
+		{
+			png_deflate(&png, &filter, 1, Z_NO_FLUSH);
+			png_deflate(&png, raster->band + y * width * 3,
+					width * 3, Z_NO_FLUSH);
+		}
+	}
+	png_deflate(&png, NULL, 0, Z_FINISH);
+	deflateEnd(&png.z);
+
+	png_chunk(&png, "IEND", NULL, 0);
+
+	ok = !ferror(png.f);
+	if (fclose(png.f) != 0)
+		ok = FALSE;
+	if (!ok)
+		g_set_error(error, VGA_RASTER_ERROR, VGA_RASTER_ERROR_IO,
+				"Unable to write %s: %s", filename,
+				g_strerror(errno));
+
+	return ok;
+}
@@ -0,0 +1,832 @@
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of version 2 of the GNU General Public License as
+ *  published by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ *****************************************************************************
+ *
+ *  Recording layout (all integers little-endian):
+ *
+ *	header:	"VGAREC" version:8 0:8 start_time:64 (usec since the epoch)
+ *	blocks and keyframes, in the order they were written
+ *	index:	nblocks:32 block entries nkeys:32 keyframe entries
+ *		length:64 duration:64
+ *	trailer: index_offset:64 "VGAINDEX"
+ *
+ *  An index entry is offset:64 comp_len:32 raw_len:32 usec:64 input:64,
+ *  where usec is the time into the recording and input is the number of
+ *  bytes of terminal input before it.
+ *
+ *  A block is a zlib stream of chunks, each one varint(usec since the
+ *  previous chunk, or since the block's time for the first) varint(len)
+ *  and len bytes of input.  A keyframe is a zlib-compressed snapshot, and
+ *  always falls between two blocks.
+ *
+ *  The writer deflates large writes straight from the caller's buffer;
+ *  only small writes, which would otherwise cost more in chunk headers
+ *  than in data, are copied to be merged.
+ */
+
+#include <stdio.h>
+#include <errno.h>
+#include <string.h>
+#include <zlib.h>
+#include "vgarecord.h"
+#include "vgasnapshot.h"
+
+#define RECORD_MAGIC		"VGAREC"
+#define RECORD_MAGIC_LEN	6
+#define RECORD_VERSION		1
+#define RECORD_HEADER_LEN	16
+#define RECORD_TRAILER		"VGAINDEX"
+#define RECORD_TRAILER_LEN	16
+#define RECORD_ENTRY_LEN	32
+
+#define RECORD_BLOCK_SIZE	(256 * 1024)	/* Input bytes per block */
+#define RECORD_KEY_INTERVAL	(1024 * 1024)	/* Input bytes per keyframe */
+#define RECORD_SMALL		256	/* Writes smaller than this are merged */
+#define RECORD_MERGE_USEC	1000	/* ...if they're this close together */
+#define RECORD_ZBUF		(64 * 1024)
+
+/* A block ends once it has RECORD_BLOCK_SIZE bytes, so it can't be more than
+ * twice that, less one, plus the header of its last write */
+#define RECORD_BLOCK_MAX	(2 * RECORD_BLOCK_SIZE + 20)
+/* zlib can't inflate anything to more than this many times its size */
+#define RECORD_ZLIB_RATIO	1032
+
+typedef struct
+{
+	guint64 offset;
+	guint32 comp_len;
+	guint32 raw_len;
+	guint64 usec;
+	guint64 input;
+} IndexEntry;
+
+struct _VGARecorder
+{
+	FILE * f;
+	guint64 pos;		/* Bytes written to f */
+	GError * error;		/* First write error */
+	GTimer * clock;
+
+	z_stream z;
+	guchar * zbuf;
+	gboolean in_block;
+	IndexEntry block;	/* The block being written */
+	guint64 last_usec;	/* Time of the last chunk */
+	guint64 input;		/* Input bytes written so far */
+
+	guchar small[RECORD_SMALL];
+	gsize small_len;
+	guint64 small_usec;
+
+	gsize key_interval;
+	guint64 next_key;
+
+	GArray * blocks;
+	GArray * keys;
+};
+
+struct _VGARecording
+{
+	GMappedFile * file;
+	const guchar * data;
+	gsize size;
+
+	IndexEntry * blocks;
+	guint nblocks;
+	IndexEntry * keys;
+	guint nkeys;
+	guint64 length;
+	guint64 duration;
+
+	/* The last block inflated */
+	guint cached;
+	guchar * cache;
+};
+
+GQuark
+vga_record_error_quark(void)
+{
+	return g_quark_from_static_string("vga-record-error-quark");
+}
+
+static void
+put_le(guchar * p, guint64 v, int bytes)
+{
+	int i;
+
+	for (i = 0; i < bytes; i++, v >>= 8)
+		p[i] = v & 0xFF;
+}
+
+static guint64
+get_le(const guchar * p, int bytes)
+{
+	guint64 v = 0;
+	int i;
+
+	for (i = bytes - 1; i >= 0; i--)
+		v = (v << 8) | p[i];
+	return v;
+}
+
+static int
+put_varint(guchar * p, guint64 v)
+{
+	int n = 0;
+
+	while (v >= 0x80)
+	{
+		p[n++] = (v & 0x7F) | 0x80;
+		v >>= 7;
+	}
+	p[n++] = v;
+	return n;
+}
+
+/* Decode a varint from p up to end; NULL if it runs off the end */
+static const guchar *
+get_varint(const guchar * p, const guchar * end, guint64 * v)
+{
+	int shift = 0;
+
+	*v = 0;
+	while (p < end && shift < 64)
+	{
+		*v |= (guint64) (*p & 0x7F) << shift;
+		if (!(*p++ & 0x80))
+			return p;
+		shift += 7;
+	}
+	return NULL;
+}
+
+static void
+put_entry(guchar * p, IndexEntry * e)
+{
+	put_le(p, e->offset, 8);
+	put_le(p + 8, e->comp_len, 4);
+	put_le(p + 12, e->raw_len, 4);
+	put_le(p + 16, e->usec, 8);
+	put_le(p + 24, e->input, 8);
+}
+
+static void
+get_entry(const guchar * p, IndexEntry * e)
+{
+	e->offset = get_le(p, 8);
+	e->comp_len = get_le(p + 8, 4);
+	e->raw_len = get_le(p + 12, 4);
+	e->usec = get_le(p + 16, 8);
+	e->input = get_le(p + 24, 8);
+}
+
+/*************************************
+ * Writing
+ *************************************/
+
+static guint64
+rec_now(VGARecorder * rec)
+{
+	return (guint64) (g_timer_elapsed(rec->clock, NULL) * G_USEC_PER_SEC);
+}
+
+static void
+rec_out(VGARecorder * rec, const guchar * data, gsize len)
+{
+	if (rec->error)
+		return;
+
+	if (fwrite(data, 1, len, rec->f) != len)
+	{
+		g_set_error(&rec->error, VGA_RECORD_ERROR,
+				VGA_RECORD_ERROR_IO, "%s",
+				g_strerror(errno));
+		return;
+	}
+	rec->pos += len;
+}
+
+static void
+rec_deflate(VGARecorder * rec, const guchar * data, gsize len, int flush)
+{
+	gsize n;
+	int ret;
+
+	rec->z.next_in = (Bytef *) data;
+	rec->z.avail_in = len;
+
+	do
+	{
+		rec->z.next_out = rec->zbuf;
+		rec->z.avail_out = RECORD_ZBUF;
+		ret = deflate(&rec->z, flush);
+
+		n = RECORD_ZBUF - rec->z.avail_out;
+		rec_out(rec, rec->zbuf, n);
+		rec->block.comp_len += n;
+	}
+	while (rec->z.avail_out == 0 ||
+		(flush == Z_FINISH && ret != Z_STREAM_END && ret != Z_STREAM_ERROR));
+}
+
+static void
+rec_end_block(VGARecorder * rec)
+{
+	if (!rec->in_block)
+		return;
+
+	rec_deflate(rec, NULL, 0, Z_FINISH);
+	deflateReset(&rec->z);
+
+	g_array_append_val(rec->blocks, rec->block);
+	rec->in_block = FALSE;
+}
+
+/* Add one chunk, straight from @data */
+static void
+rec_put_chunk(VGARecorder * rec, guint64 usec, const guchar * data, gsize len)
+{
+	guchar hdr[20];
+	gsize n, part;
+
+	while (len > 0)
+	{
+		if (!rec->in_block)
+		{
+			rec->block.offset = rec->pos;
+			rec->block.comp_len = 0;
+			rec->block.raw_len = 0;
+			rec->block.usec = usec;
+			rec->block.input = rec->input;
+			rec->last_usec = usec;
+			rec->in_block = TRUE;
+		}
+
+		/* Keep blocks bounded even for huge writes */
+		part = MIN(len, RECORD_BLOCK_SIZE);
+		n = put_varint(hdr, usec - rec->last_usec);
+		n += put_varint(hdr + n, part);
+		rec_deflate(rec, hdr, n, Z_NO_FLUSH);
+		rec_deflate(rec, data, part, Z_NO_FLUSH);
+
+		rec->block.raw_len += n + part;
+		rec->input += part;
+		rec->last_usec = usec;
+		data += part;
+		len -= part;
+
+		if (rec->block.raw_len >= RECORD_BLOCK_SIZE)
+			rec_end_block(rec);
+	}
+}
+
+static void
+rec_flush_small(VGARecorder * rec)
+{
+	if (rec->small_len == 0)
+		return;
+
+	rec_put_chunk(rec, rec->small_usec, rec->small, rec->small_len);
+	rec->small_len = 0;
+}
+
+/**
+ * vga_recorder_new:
+ * @filename: File to record to, which is overwritten
+ * @error: Return location for errors, or NULL
+ *
+ * Returns: a new VGARecorder, or NULL if the file couldn't be created
+ */
+VGARecorder *
+vga_recorder_new(const gchar * filename, GError ** error)
+{
+	VGARecorder * rec;
+	GTimeVal now;
+	guchar header[RECORD_HEADER_LEN];
+	FILE * f;
+
+	g_return_val_if_fail(filename != NULL, NULL);
+
+	f = fopen(filename, "wb");
+	if (f == NULL)
+	{
+		g_set_error(error, G_FILE_ERROR,
+				g_file_error_from_errno(errno),
+				"Unable to create %s: %s", filename,
+				g_strerror(errno));
+		return NULL;
+	}
+
+	rec = g_new0(VGARecorder, 1);
+	rec->f = f;
+	rec->clock = g_timer_new();
+	rec->zbuf = g_malloc(RECORD_ZBUF);
+	deflateInit(&rec->z, Z_DEFAULT_COMPRESSION);
+	rec->key_interval = RECORD_KEY_INTERVAL;
+	rec->blocks = g_array_new(FALSE, FALSE, sizeof(IndexEntry));
+	rec->keys = g_array_new(FALSE, FALSE, sizeof(IndexEntry));
+
+	g_get_current_time(&now);
+	memcpy(header, RECORD_MAGIC, RECORD_MAGIC_LEN);
+	header[6] = RECORD_VERSION;
+	header[7] = 0;
+	put_le(header + 8, (guint64) now.tv_sec * G_USEC_PER_SEC + now.tv_usec,
+			8);
+	rec_out(rec, header, RECORD_HEADER_LEN);
+
+	return rec;
+}
+
+/* Take a keyframe every @bytes of input fed with vga_recorder_feed() */
+void
+vga_recorder_set_keyframe_interval(VGARecorder * rec, gsize bytes)
+{
+	g_return_if_fail(rec != NULL);
+	g_return_if_fail(bytes > 0);
+
+	rec->key_interval = bytes;
+	rec->next_key = rec->input + rec->small_len + bytes;
+}
+
+/**
+ * vga_recorder_write:
+ * @rec: VGARecorder
+ * @data: Terminal input
+ * @len: Length of @data
+ *
+ * Record @data, timestamped with the time since the recorder was created.
+ */
+void
+vga_recorder_write(VGARecorder * rec, const guchar * data, gsize len)
+{
+	guint64 usec;
+
+	g_return_if_fail(rec != NULL);
+
+	if (len == 0)
+		return;
+
+	usec = rec_now(rec);
+	if (rec->small_len > 0 && (len >= RECORD_SMALL ||
+			rec->small_len + len > RECORD_SMALL ||
+			usec - rec->small_usec >= RECORD_MERGE_USEC))
+		rec_flush_small(rec);
+
+	if (len >= RECORD_SMALL)
+	{
+		rec_put_chunk(rec, usec, data, len);
+		return;
+	}
+
+	if (rec->small_len == 0)
+		rec->small_usec = usec;
+	memcpy(rec->small + rec->small_len, data, len);
+	rec->small_len += len;
+}
+
+/**
+ * vga_recorder_feed:
+ * @rec: VGARecorder
+ * @emu: Emulator about to parse @data
+ * @data: Terminal input
+ * @len: Length of @data
+ *
+ * Record @data, first taking a keyframe of @emu and its screen if one is
+ * due.  This is what an emulator does with vga_emu_set_recorder().
+ */
+void
+vga_recorder_feed(VGARecorder * rec, EmuData * emu, const guchar * data,
+		gsize len)
+{
+	g_return_if_fail(rec != NULL);
+	g_return_if_fail(emu != NULL);
+
+	if (rec->input + rec->small_len >= rec->next_key)
+		vga_recorder_keyframe(rec, vga_emu_get_screen(emu), emu);
+
+	vga_recorder_write(rec, data, len);
+}
+
+/**
+ * vga_recorder_keyframe:
+ * @rec: VGARecorder
+ * @scr: The screen as it is after all input recorded so far
+ * @emu: The emulator, or NULL
+ *
+ * Record a snapshot that playback can start from.
+ */
+void
+vga_recorder_keyframe(VGARecorder * rec, VGAScreen * scr, EmuData * emu)
+{
+	IndexEntry key;
+	GByteArray * snap;
+	guchar * buf;
+	uLongf len;
+
+	g_return_if_fail(rec != NULL);
+	g_return_if_fail(scr != NULL);
+
+	rec_flush_small(rec);
+	rec_end_block(rec);
+
+	snap = vga_snapshot_save(scr, emu);
+	len = compressBound(snap->len);
+	buf = g_malloc(len);
+	if (compress2(buf, &len, snap->data, snap->len,
+				Z_DEFAULT_COMPRESSION) == Z_OK)
+	{
+		key.offset = rec->pos;
+		key.comp_len = len;
+		key.raw_len = snap->len;
+		key.usec = rec_now(rec);
+		key.input = rec->input;
+		rec_out(rec, buf, len);
+		g_array_append_val(rec->keys, key);
+	}
+	g_free(buf);
+	g_byte_array_free(snap, TRUE);
+
+	rec->next_key = rec->input + rec->key_interval;
+}
+
+/**
+ * vga_recorder_close:
+ * @rec: VGARecorder
+ * @error: Return location for errors, or NULL
+ *
+ * Finish the recording, write its index and free @rec.
+ *
+ * Returns: FALSE if anything couldn't be written
+ */
+gboolean
+vga_recorder_close(VGARecorder * rec, GError ** error)
+{
+	IndexEntry * e;
+	guchar buf[RECORD_ENTRY_LEN];
+	guint64 index;
+	gboolean ok;
+	guint i;
+
+	g_return_val_if_fail(rec != NULL, FALSE);
+
+	rec_flush_small(rec);
+	rec_end_block(rec);
+
+	index = rec->pos;
+	put_le(buf, rec->blocks->len, 4);
+	rec_out(rec, buf, 4);
+	for (i = 0; i < rec->blocks->len; i++)
+	{
+		e = &g_array_index(rec->blocks, IndexEntry, i);
+		put_entry(buf, e);
+		rec_out(rec, buf, RECORD_ENTRY_LEN);
+	}
+	put_le(buf, rec->keys->len, 4);
+	rec_out(rec, buf, 4);
+	for (i = 0; i < rec->keys->len; i++)
+	{
+		e = &g_array_index(rec->keys, IndexEntry, i);
+		put_entry(buf, e);
+		rec_out(rec, buf, RECORD_ENTRY_LEN);
+	}
+	put_le(buf, rec->input, 8);
+	put_le(buf + 8, rec_now(rec), 8);
+	rec_out(rec, buf, 16);
+
+	put_le(buf, index, 8);
+	memcpy(buf + 8, RECORD_TRAILER, 8);
+	rec_out(rec, buf, RECORD_TRAILER_LEN);
+
+	if (fclose(rec->f) != 0 && rec->error == NULL)
+		g_set_error(&rec->error, VGA_RECORD_ERROR,
+				VGA_RECORD_ERROR_IO, "%s",
+				g_strerror(errno));
+
+	ok = (rec->error == NULL);
+	if (!ok)
+		g_propagate_error(error, rec->error);
+
+	deflateEnd(&rec->z);
+	g_free(rec->zbuf);
+	g_timer_destroy(rec->clock);
+	g_array_free(rec->blocks, TRUE);
+	g_array_free(rec->keys, TRUE);
+	g_free(rec);
+
+	return ok;
+}
+
+/*************************************
+ * Reading
+ *************************************/
+
+static gboolean
+rec_bad(GError ** error, const gchar * filename)
+{
+	g_set_error(error, VGA_RECORD_ERROR, VGA_RECORD_ERROR_FORMAT,
+			"%s is not a recording, or is damaged", filename);
+	return FALSE;
+}
+
+/* Read @n index entries at *p, checking that they point before @limit
+ * and inflate to no more than @max_raw bytes */
+static IndexEntry *
+rec_read_entries(const guchar ** p, const guchar * end, guint * n,
+		guint64 limit, guint32 max_raw)
+{
+	IndexEntry * entries;
+	guint i;
+
+	if (end - *p < 4)
+		return NULL;
+	*n = get_le(*p, 4);
+	*p += 4;
+	if ((guint64) (end - *p) / RECORD_ENTRY_LEN < *n)
+		return NULL;
+
+	entries = g_new(IndexEntry, MAX(*n, 1));
+	for (i = 0; i < *n; i++, *p += RECORD_ENTRY_LEN)
+	{
+		get_entry(*p, &entries[i]);
+		if (entries[i].offset < RECORD_HEADER_LEN ||
+			entries[i].offset > limit ||
+			entries[i].comp_len > limit - entries[i].offset ||
+			entries[i].raw_len > max_raw ||
+			entries[i].raw_len >
+				(guint64) entries[i].comp_len * RECORD_ZLIB_RATIO)
+		{
+			g_free(entries);
+			return NULL;
+		}
+	}
+
+	return entries;
+}
+
+/**
+ * vga_recording_open:
+ * @filename: Recording to open
+ * @error: Return location for errors, or NULL
+ *
+ * Map a recording and read its index.
+ *
+ * Returns: a new VGARecording, or NULL
+ */
+VGARecording *
+vga_recording_open(const gchar * filename, GError ** error)
+{
+	VGARecording * rec;
+	const guchar * p, * end;
+	guint64 index;
+
+	g_return_val_if_fail(filename != NULL, NULL);
+
+	rec = g_new0(VGARecording, 1);
+	rec->cached = G_MAXUINT;
+
+	rec->file = g_mapped_file_new(filename, FALSE, error);
+	if (rec->file == NULL)
+	{
+		g_free(rec);
+		return NULL;
+	}
+	rec->data = (const guchar *) g_mapped_file_get_contents(rec->file);
+	rec->size = g_mapped_file_get_length(rec->file);
+
+	if (rec->size < RECORD_HEADER_LEN + RECORD_TRAILER_LEN ||
+		memcmp(rec->data, RECORD_MAGIC, RECORD_MAGIC_LEN) != 0 ||
+		rec->data[6] != RECORD_VERSION)
+		goto bad;
+
+	end = rec->data + rec->size - RECORD_TRAILER_LEN;
+	if (memcmp(end + 8, RECORD_TRAILER, 8) != 0)
+		goto bad;
+	index = get_le(end, 8);
+	if (index < RECORD_HEADER_LEN || index > (guint64) (end - rec->data))
+		goto bad;
+
+	p = rec->data + index;
+	rec->blocks = rec_read_entries(&p, end, &rec->nblocks, index,
+			RECORD_BLOCK_MAX);
+	if (rec->blocks == NULL)
+		goto bad;
+	rec->keys = rec_read_entries(&p, end, &rec->nkeys, index,
+			G_MAXUINT32);
+	if (rec->keys == NULL || end - p < 16)
+		goto bad;
+	rec->length = get_le(p, 8);
+	rec->duration = get_le(p + 8, 8);
+
+	return rec;
+
+bad:
+	rec_bad(error, filename);
+	vga_recording_close(rec);
+	return NULL;
+}
+
+void
+vga_recording_close(VGARecording * rec)
+{
+	g_return_if_fail(rec != NULL);
+
+	g_free(rec->cache);
+	g_free(rec->blocks);
+	g_free(rec->keys);
+	if (rec->file)
+		g_mapped_file_free(rec->file);
+	g_free(rec);
+}
+
+/* Length of the recording in microseconds */
+guint64
+vga_recording_get_duration(VGARecording * rec)
+{
+	g_return_val_if_fail(rec != NULL, 0);
+
+	return rec->duration;
+}
+
+/* Bytes of terminal input in the recording */
+guint64
+vga_recording_get_length(VGARecording * rec)
+{
+	g_return_val_if_fail(rec != NULL, 0);
+
+	return rec->length;
+}
+
+/* Inflate @e from the map into a new buffer of e->raw_len bytes */
+static guchar *
+rec_inflate(VGARecording * rec, IndexEntry * e)
+{
+	guchar * buf;
+	uLongf len = e->raw_len;
+
+	buf = g_malloc(MAX(len, 1));
+	if (uncompress(buf, &len, rec->data + e->offset, e->comp_len) != Z_OK ||
+		len != e->raw_len)
+	{
+		g_free(buf);
+		return NULL;
+	}
+	return buf;
+}
+
+/* The last entry whose time is <= @usec, or -1 */
+static int
+rec_find(IndexEntry * e, guint n, guint64 usec)
+{
+	int lo = 0, hi = (int) n - 1, mid;
+
+	if (n == 0 || e[0].usec > usec)
+		return -1;
+	while (lo < hi)
+	{
+		mid = (lo + hi + 1) / 2;
+		if (e[mid].usec <= usec)
+			lo = mid;
+		else
+			hi = mid - 1;
+	}
+	return lo;
+}
+
+/*
+ * Call @func on each chunk from block @first on whose time is between
+ * @from and @to.  FALSE if the recording is damaged.
+ */
+static gboolean
+rec_walk(VGARecording * rec, guint first, guint64 from, guint64 to,
+		VGARecordFunc func, gpointer user_data)
+{
+	const guchar * p, * end;
+	guint64 usec, dt, len;
+	guint i;
+
+	for (i = first; i < rec->nblocks; i++)
+	{
+		if (rec->blocks[i].usec > to)
+			return TRUE;
+
+		if (rec->cached != i)
+		{
+			g_free(rec->cache);
+			rec->cache = rec_inflate(rec, &rec->blocks[i]);
+			rec->cached = rec->cache ? i : G_MAXUINT;
+			if (rec->cache == NULL)
+				return FALSE;
+		}
+
+		p = rec->cache;
+		end = p + rec->blocks[i].raw_len;
+		usec = rec->blocks[i].usec;
+		while (p < end)
+		{
+			if ((p = get_varint(p, end, &dt)) == NULL ||
+				(p = get_varint(p, end, &len)) == NULL ||
+				len > (guint64) (end - p))
+				return FALSE;
+
+			usec += dt;
+			if (usec > to)
+				return TRUE;
+			if (usec >= from && !func(usec, p, len, user_data))
+				return TRUE;
+			p += len;
+		}
+	}
+
+	return TRUE;
+}
+
+/**
+ * vga_recording_foreach:
+ * @rec: VGARecording
+ * @from: Time to start from, in microseconds
+ * @func: Called with each chunk of input from @from on
+ * @user_data: Data for @func
+ *
+ * Go through the input from a point in time.  @func may return FALSE to
+ * stop early.
+ *
+ * Returns: FALSE if the recording turned out to be damaged
+ */
+gboolean
+vga_recording_foreach(VGARecording * rec, guint64 from, VGARecordFunc func,
+		gpointer user_data)
+{
+	int first;
+
+	g_return_val_if_fail(rec != NULL, FALSE);
+	g_return_val_if_fail(func != NULL, FALSE);
+
+	first = rec_find(rec->blocks, rec->nblocks, from);
+	return rec_walk(rec, MAX(first, 0), from, G_MAXUINT64, func,
+			user_data);
+}
+
+static gboolean
+rec_seek_feed(guint64 usec, const guchar * data, gsize len,
+		gpointer user_data)
+{
+	vga_emu_write(user_data, data, len);
+	return TRUE;
+}
+
+/**
+ * vga_recording_seek:
+ * @rec: VGARecording
+ * @emu: Emulator to show the recording on
+ * @usec: Time to go to
+ *
+ * Put @emu and its screen in the state they were in @usec into the
+ * recording, by restoring the last keyframe before then and parsing the
+ * input from there.  For a VGATerm's emulator, follow with
+ * vga_term_update().  @emu should not be recording itself.
+ *
+ * Returns: FALSE if the recording turned out to be damaged
+ */
+gboolean
+vga_recording_seek(VGARecording * rec, EmuData * emu, guint64 usec)
+{
+	IndexEntry * key;
+	guchar * snap;
+	gboolean ok;
+	guint first = 0;
+	int k;
+
+	g_return_val_if_fail(rec != NULL, FALSE);
+	g_return_val_if_fail(emu != NULL, FALSE);
+
+	k = rec_find(rec->keys, rec->nkeys, usec);
+	if (k >= 0)
+	{
+		key = &rec->keys[k];
+		snap = rec_inflate(rec, key);
+		ok = snap && vga_snapshot_restore(vga_emu_get_screen(emu), emu,
+				snap, key->raw_len);
+		g_free(snap);
+		if (!ok)
+			return FALSE;
+
+		/* Keyframes always fall between blocks */
+		while (first < rec->nblocks &&
+			rec->blocks[first].input < key->input)
+			first++;
+	}
+
+	return rec_walk(rec, first, 0, usec, rec_seek_feed, emu);
+}
@@ -0,0 +1,239 @@
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of version 2 of the GNU General Public License as
+ *  published by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ *****************************************************************************
+ *
+ *  SPSC byte ring.  head and tail are free-running byte counts; only the
+ *  producer changes head and only the consumer changes tail, so each side
+ *  just has to publish its own index after touching the data.  The size is
+ *  a power of two so that the counts can wrap around freely.
+ */
+
+#include <string.h>
+#include "vgaring.h"
+
+#define RING_MAX_SIZE	(1 << 30)
+
+struct _VGARing
+{
+	guchar * data;
+	guint size;		/* Power of two */
+	guint mask;
+	gint head;		/* Bytes ever written */
+	gint tail;		/* Bytes ever read */
+	gint waiting;		/* Consumer is asleep, notify on write */
+	VGARingNotify notify;
+	gpointer notify_data;
+};
+
+/**
+ * vga_ring_new:
+ * @size: Capacity in bytes, rounded up to a power of two
+ *
+ * Returns: a new, empty ring
+ */
+VGARing *
+vga_ring_new(gsize size)
+{
+	VGARing * ring;
+	guint n;
+
+	g_return_val_if_fail(size > 0 && size <= RING_MAX_SIZE, NULL);
+
+	for (n = 1; n < size; n <<= 1)
+		;
+
+	ring = g_new0(VGARing, 1);
+	ring->data = g_malloc(n);
+	ring->size = n;
+	ring->mask = n - 1;
+
+	/* Nobody is reading yet, so the first write should notify */
+	ring->waiting = 1;
+
+	return ring;
+}
+
+void
+vga_ring_destroy(VGARing * ring)
+{
+	g_return_if_fail(ring != NULL);
+
+	g_free(ring->data);
+	g_free(ring);
+}
+
+/**
+ * vga_ring_set_notify:
+ * @ring: VGARing
+ * @func: Function to call when data arrives for a waiting consumer
+ * @user_data: Data for @func
+ *
+ * Set the consumer's wakeup function.  It is called from the producer's
+ * thread, so it should do little more than schedule the consumer, e.g.
+ * with g_idle_add().  Set this before the producer starts.
+ */
+void
+vga_ring_set_notify(VGARing * ring, VGARingNotify func, gpointer user_data)
+{
+	g_return_if_fail(ring != NULL);
+
+	ring->notify = func;
+	ring->notify_data = user_data;
+}
+
+gsize
+vga_ring_size(VGARing * ring)
+{
+	return ring->size;
+}
+
+/* Bytes available to read.  Exact for the consumer, a lower bound for
+ * anyone else. */
+gsize
+vga_ring_length(VGARing * ring)
+{
+	return (guint) g_atomic_int_get(&ring->head) -
+		(guint) g_atomic_int_get(&ring->tail);
+}
+
+/* Bytes that can be written.  Exact for the producer, a lower bound for
+ * anyone else. */
+gsize
+vga_ring_space(VGARing * ring)
+{
+	return ring->size - vga_ring_length(ring);
+}
+
+/**
+ * vga_ring_write:
+ * @ring: VGARing
+ * @buf: Data to write
+ * @len: Length of @buf
+ *
+ * Copy as much of @buf into the ring as fits.  Only one thread may write
+ * to a ring.
+ *
+ * Returns: The number of bytes written, which is less than @len if the
+ * ring is full.
+ */
+gsize
+vga_ring_write(VGARing * ring, const guchar * buf, gsize len)
+{
+	guint head, ofs, part;
+
+	g_return_val_if_fail(ring != NULL, 0);
+
+	len = MIN(len, vga_ring_space(ring));
+	if (len == 0)
+		return 0;
+
+	head = (guint) g_atomic_int_get(&ring->head);
+	ofs = head & ring->mask;
+	part = MIN(len, ring->size - ofs);
+	memcpy(ring->data + ofs, buf, part);
+	memcpy(ring->data, buf + part, len - part);
+
+	/* Publish the data before waking the consumer */
+	g_atomic_int_set(&ring->head, head + len);
+
+	if (g_atomic_int_get(&ring->waiting) &&
+		g_atomic_int_compare_and_exchange(&ring->waiting, 1, 0) &&
+		ring->notify)
+	{
+		ring->notify(ring, ring->notify_data);
+	}
+
+	return len;
+}
+
+/**
+ * vga_ring_peek:
+ * @ring: VGARing
+ * @buf: Set to the start of the readable data
+ *
+ * Get the readable data without copying it.  Call vga_ring_consume() when
+ * done with it.  Only one thread may read from a ring.
+ *
+ * Returns: The number of contiguous bytes at @buf, which may be less than
+ * vga_ring_length() when the data wraps around the end of the ring.
+ */
+gsize
+vga_ring_peek(VGARing * ring, const guchar ** buf)
+{
+	guint tail, ofs;
+	gsize len;
+
+	g_return_val_if_fail(ring != NULL, 0);
+
+	len = vga_ring_length(ring);
+	tail = (guint) ring->tail;
+	ofs = tail & ring->mask;
+	*buf = ring->data + ofs;
+
+	return MIN(len, ring->size - ofs);
+}
+
+/* Release @len bytes returned by vga_ring_peek() back to the producer */
+void
+vga_ring_consume(VGARing * ring, gsize len)
+{
+	g_return_if_fail(ring != NULL);
+	g_return_if_fail(len <= vga_ring_length(ring));
+
+	g_atomic_int_set(&ring->tail, (guint) ring->tail + len);
+}
+
+/* Copy out up to @len bytes.  Returns the number of bytes read. */
+gsize
+vga_ring_read(VGARing * ring, guchar * buf, gsize len)
+{
+	const guchar * p;
+	gsize n, done = 0;
+
+	while (done < len && (n = vga_ring_peek(ring, &p)) > 0)
+	{
+		n = MIN(n, len - done);
+		memcpy(buf + done, p, n);
+		vga_ring_consume(ring, n);
+		done += n;
+	}
+
+	return done;
+}
+
+/**
+ * vga_ring_wait:
+ * @ring: VGARing
+ *
+ * Called by the consumer when it has emptied the ring and is about to
+ * stop polling it.  The next write will call the notify function.
+ *
+ * Returns: TRUE if data arrived in the meantime, in which case the notify
+ * function will not be called and the consumer should carry on reading.
+ */
+gboolean
+vga_ring_wait(VGARing * ring)
+{
+	g_return_val_if_fail(ring != NULL, FALSE);
+
+	g_atomic_int_set(&ring->waiting, 1);
+
+	/* A write that raced with us may not have seen the flag */
+	if (vga_ring_length(ring) > 0 &&
+		g_atomic_int_compare_and_exchange(&ring->waiting, 1, 0))
+		return TRUE;
+
+	return FALSE;
+}
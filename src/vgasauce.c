@@ -0,0 +1,387 @@
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of version 2 of the GNU General Public License as
+ *  published by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ *****************************************************************************
+ *
+ *  Record layout, all integers little-endian:
+ *
+ *	"SAUCE" "00" title[35] author[20] group[20] date[8] filesize:32
+ *	datatype:8 filetype:8 tinfo1-4:16 comments:8 tflags:8 tinfos[22]
+ *
+ *  preceded by "COMNT" and comments lines of 64 bytes if comments > 0.
+ *  Strings are padded with spaces, or sometimes NULs.
+ */
+
+#include <string.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include "vgasauce.h"
+#include "vgatext.h"
+
+#define SAUCE_COMMENT_ID_LEN	5
+#define SAUCE_COMMENT_LEN	64
+#define SAUCE_MAX_TAIL		(VGA_SAUCE_RECORD_LEN + SAUCE_COMMENT_ID_LEN + \
+					255 * SAUCE_COMMENT_LEN)
+
+/* Sizes beyond these are taken to be garbage */
+#define SAUCE_MAX_COLS		1024
+#define SAUCE_MAX_ROWS		10000
+
+/* Copy a padded field, dropping the padding */
+static void
+sauce_string(gchar * dest, const guchar * src, int len)
+{
+	memcpy(dest, src, len);
+	dest[len] = '\0';
+	while (len > 0 && (dest[len - 1] == ' ' || dest[len - 1] == '\0'))
+		dest[--len] = '\0';
+}
+
+static guint
+sauce_le(const guchar * p, int bytes)
+{
+	guint v = 0;
+
+	while (bytes-- > 0)
+		v = (v << 8) | p[bytes];
+	return v;
+}
+
+/* Fill in the fields that are worked out from the raw record */
+static void
+sauce_interpret(VGASauce * sauce)
+{
+	sauce->cols = sauce->rows = 0;
+	sauce->has_icecolor = FALSE;
+
+	switch (sauce->data_type)
+	{
+	case VGA_SAUCE_CHARACTER:
+		/* ASCII, ANSi, ANSiMation, PCBoard, Avatar and TundraDraw
+		 * give the size in characters */
+		switch (sauce->file_type)
+		{
+		case 0: case 1: case 2:
+			sauce->has_icecolor = TRUE;
+			/* Fall through */
+		case 4: case 5: case 8:
+			sauce->cols = sauce->tinfo[0];
+			sauce->rows = sauce->tinfo[1];
+			break;
+		}
+		break;
+	case VGA_SAUCE_BINARYTEXT:
+		sauce->has_icecolor = TRUE;
+		sauce->cols = sauce->file_type * 2;
+		if (sauce->cols > 0)
+			sauce->rows = sauce->data_len / 2 / sauce->cols;
+		break;
+	case VGA_SAUCE_XBIN:
+		sauce->cols = sauce->tinfo[0];
+		sauce->rows = sauce->tinfo[1];
+		break;
+	}
+
+	if (sauce->cols > SAUCE_MAX_COLS)
+		sauce->cols = 0;
+	if (sauce->rows > SAUCE_MAX_ROWS)
+		sauce->rows = 0;
+
+	sauce->icecolor = sauce->has_icecolor && (sauce->flags & 0x01);
+	switch ((sauce->flags >> 1) & 0x03)
+	{
+	case 1:
+		sauce->letter_spacing = 8;
+		break;
+	case 2:
+		sauce->letter_spacing = 9;
+		break;
+	default:
+		sauce->letter_spacing = 0;
+		break;
+	}
+}
+
+/**
+ * vga_sauce_parse:
+ * @data: A whole file, or the end of one
+ * @len: Length of @data
+ * @sauce: Where to put the record
+ *
+ * Look for a SAUCE record at the end of @data.  sauce->data_len is
+ * relative to the start of @data.
+ *
+ * Returns: TRUE if there is one
+ */
+gboolean
+vga_sauce_parse(const guchar * data, gsize len, VGASauce * sauce)
+{
+	const guchar * p;
+	gsize comment_len;
+	int i;
+
+	g_return_val_if_fail(data != NULL || len == 0, FALSE);
+	g_return_val_if_fail(sauce != NULL, FALSE);
+
+	if (len < VGA_SAUCE_RECORD_LEN)
+		return FALSE;
+	p = data + len - VGA_SAUCE_RECORD_LEN;
+	if (memcmp(p, "SAUCE00", 7) != 0)
+		return FALSE;
+
+	sauce_string(sauce->title, p + 7, 35);
+	sauce_string(sauce->author, p + 42, 20);
+	sauce_string(sauce->group, p + 62, 20);
+	sauce_string(sauce->date, p + 82, 8);
+	sauce->file_size = sauce_le(p + 90, 4);
+	sauce->data_type = p[94];
+	sauce->file_type = p[95];
+	for (i = 0; i < 4; i++)
+		sauce->tinfo[i] = sauce_le(p + 96 + i * 2, 2);
+	sauce->comments = p[104];
+	sauce->flags = p[105];
+	sauce_string(sauce->font, p + 106, 22);
+
+	/* The comment count is often wrong, so only trust it if the block
+	 * is really there */
+	sauce->data_len = len - VGA_SAUCE_RECORD_LEN;
+	comment_len = SAUCE_COMMENT_ID_LEN +
+		sauce->comments * SAUCE_COMMENT_LEN;
+	if (sauce->comments > 0 && sauce->data_len >= comment_len &&
+		memcmp(data + sauce->data_len - comment_len, "COMNT",
+			SAUCE_COMMENT_ID_LEN) == 0)
+		sauce->data_len -= comment_len;
+
+	sauce_interpret(sauce);
+
+	return TRUE;
+}
+
+/**
+ * vga_sauce_read_fd:
+ * @fd: A regular file
+ * @sauce: Where to put the record
+ *
+ * Look for a SAUCE record at the end of a file without moving its offset.
+ * sauce->data_len is relative to the start of the file.
+ *
+ * Returns: TRUE if there is one
+ */
+gboolean
+vga_sauce_read_fd(int fd, VGASauce * sauce)
+{
+	struct stat st;
+	guchar * buf;
+	gsize len;
+	gboolean found = FALSE;
+
+	g_return_val_if_fail(sauce != NULL, FALSE);
+
+	if (fstat(fd, &st) < 0 || !S_ISREG(st.st_mode) ||
+		st.st_size < VGA_SAUCE_RECORD_LEN)
+		return FALSE;
+
+	len = MIN(st.st_size, SAUCE_MAX_TAIL);
+	buf = g_malloc(len);
+	if (pread(fd, buf, len, st.st_size - len) == (ssize_t) len &&
+		vga_sauce_parse(buf, len, sauce))
+	{
+		sauce->data_len += st.st_size - len;
+		sauce_interpret(sauce);
+		found = TRUE;
+	}
+	g_free(buf);
+
+	return found;
+}
+
+/**
+ * vga_sauce_content_length:
+ * @data: A whole file
+ * @len: Length of @data
+ *
+ * Returns: The number of bytes of @data that are art.  With a SAUCE
+ * record that's everything before it, less the EOF character that comes
+ * just before the record.  Without one it's all of @data, since an EOF
+ * character on its own proves nothing: binary art can be full of them.
+ */
+gsize
+vga_sauce_content_length(const guchar * data, gsize len)
+{
+	VGASauce sauce;
+
+	if (!vga_sauce_parse(data, len, &sauce))
+		return len;
+
+	len = sauce.data_len;
+	if (len > 0 && data[len - 1] == VGA_SAUCE_EOF)
+		len--;
+	return len;
+}
+
+/**
+ * vga_sauce_font_height:
+ * @sauce: VGASauce
+ *
+ * Returns: The height of the IBM font named in the record, or 0 if it
+ * doesn't name one
+ */
+int
+vga_sauce_font_height(const VGASauce * sauce)
+{
+	static const struct
+	{
+		const gchar * name;
+		int height;
+	} fonts[] =
+	{
+		/* Longest names first, since they're matched by prefix */
+		{ "IBM VGA50", 8 },
+		{ "IBM VGA25G", 19 },
+		{ "IBM VGA", 16 },
+		{ "IBM EGA43", 8 },
+		{ "IBM EGA", 14 }
+	};
+	int i;
+
+	for (i = 0; i < G_N_ELEMENTS(fonts); i++)
+		if (g_str_has_prefix(sauce->font, fonts[i].name))
+			return fonts[i].height;
+
+	return 0;
+}
+
+/* The size a screen should have to show the art */
+static void
+sauce_size(const VGASauce * sauce, VGAScreen * scr, int * cols, int * rows)
+{
+	*cols = sauce->cols > 0 ? sauce->cols : scr->cols;
+	/* Only ever grow, so a terminal keeps its scrollback */
+	*rows = MAX(scr->rows, sauce->rows);
+}
+
+/**
+ * vga_sauce_find_font:
+ * @sauce: VGASauce
+ * @fonts: Font pack to look in, or NULL
+ *
+ * Find the font the record names: the font in @fonts with exactly that
+ * name, or else the built-in 8x8 or 8x16 font if it names an IBM font of
+ * one of those sizes.
+ *
+ * Returns: The font, not referenced, or NULL if there's none to hand
+ */
+VGAFont *
+vga_sauce_find_font(const VGASauce * sauce, VGAFontPack * fonts)
+{
+	VGAFont * font;
+	int height;
+
+	g_return_val_if_fail(sauce != NULL, NULL);
+
+	if (fonts != NULL && sauce->font[0] != '\0')
+	{
+		font = vga_font_pack_lookup(fonts, sauce->font);
+		if (font != NULL)
+			return font;
+	}
+
+	height = vga_sauce_font_height(sauce);
+	if (height == 8 || height == 16)
+		return vga_font_stock(height == 8 ?
+				FONT_DEFAULT_8X8 : FONT_DEFAULT);
+	return NULL;
+}
+
+/* Whether @scr should switch to @font */
+static gboolean
+sauce_font_differs(VGAScreen * scr, VGAFont * font)
+{
+	if (font == NULL || font == scr->font)
+		return FALSE;
+	/* Don't swap a font the user loaded for a built-in one its size */
+	return font->owner != NULL || font->height != scr->font->height;
+}
+
+/**
+ * vga_sauce_apply_screen:
+ * @sauce: VGASauce
+ * @scr: VGAScreen about to show the art
+ * @fonts: Font pack to find the art's font in, or NULL
+ *
+ * Set up a screen for the art: size it, set iCE colors, and switch to
+ * the font vga_sauce_find_font() gives.  The screen is cleared if its
+ * size changes.  The letter spacing is ignored, since only 8 pixel wide
+ * fonts are supported.
+ */
+void
+vga_sauce_apply_screen(const VGASauce * sauce, VGAScreen * scr,
+		VGAFontPack * fonts)
+{
+	VGAFont * font;
+	int cols, rows;
+
+	g_return_if_fail(sauce != NULL);
+	g_return_if_fail(scr != NULL);
+
+	font = vga_sauce_find_font(sauce, fonts);
+	if (sauce_font_differs(scr, font))
+		vga_screen_set_font(scr, font);
+
+	sauce_size(sauce, scr, &cols, &rows);
+	vga_screen_resize(scr, rows, cols);
+	vga_screen_window(scr, 1, 1, cols, rows);
+
+	if (sauce->has_icecolor)
+		vga_screen_set_icecolor(scr, sauce->icecolor);
+}
+
+/**
+ * vga_sauce_apply:
+ * @sauce: VGASauce
+ * @widget: VGAText or VGATerm widget about to show the art
+ * @fonts: Font pack to find the art's font in, or NULL
+ *
+ * Like vga_sauce_apply_screen(), but through the widget, so that it
+ * resizes and redraws with the new font.
+ */
+void
+vga_sauce_apply(const VGASauce * sauce, GtkWidget * widget,
+		VGAFontPack * fonts)
+{
+	VGAScreen * scr;
+	VGAFont * font;
+	int cols, rows;
+
+	g_return_if_fail(sauce != NULL);
+	g_return_if_fail(widget != NULL);
+	g_return_if_fail(VGA_IS_TEXT(widget));
+
+	scr = vga_get_screen(widget);
+
+	font = vga_sauce_find_font(sauce, fonts);
+	if (sauce_font_differs(scr, font))
+		vga_set_font(widget, font);
+
+	sauce_size(sauce, scr, &cols, &rows);
+	if (cols != scr->cols)
+		vga_set_cols(widget, cols);
+	if (rows != scr->rows)
+		vga_set_rows(widget, rows);
+	vga_screen_window(scr, 1, 1, cols, rows);
+
+	if (sauce->has_icecolor)
+		vga_set_icecolor(widget, sauce->icecolor);
+}
@@ -0,0 +1,937 @@
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of version 2 of the GNU General Public License as
+ *  published by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ *****************************************************************************
+ *
+ *  The VGA screen model.  The cell methods here used to live in vgatext.c
+ *  and the terminal methods in vgaterm.c; those widgets are now thin
+ *  wrappers that forward to these and then call vga_update().
+ *
+ *  Nothing in this file may touch Gtk+/Gdk, since it is also used off the
+ *  main thread.
+ */
+
+#include "vgascreen.h"
+
+/* Serial numbers are shared between all screens so that a copied font or
+ * palette can be recognized by serial alone (see vga_screen_copy_from) */
+static gint screen_serial = 0;
+
+static guint
+vga_screen_next_serial(void)
+{
+	return g_atomic_int_exchange_and_add(&screen_serial, 1) + 1;
+}
+
+static void
+vga_screen_alloc_videobuf(VGAScreen * scr)
+{
+	int y;
+
+	g_free(scr->video_buf);
+	g_free(scr->dirty_start);
+	g_free(scr->dirty_end);
+
+	scr->video_buf = g_malloc0(sizeof(vga_charcell) * scr->rows * scr->cols);
+	scr->dirty_start = g_new(int, scr->rows);
+	scr->dirty_end = g_new(int, scr->rows);
+	for (y = 0; y < scr->rows; y++)
+	{
+		scr->dirty_start[y] = -1;
+		scr->dirty_end[y] = 0;
+	}
+	scr->dirty_top = scr->rows;
+	scr->dirty_bottom = 0;
+}
+
+/**
+ * vga_screen_new:
+ * @rows: Number of character rows
+ * @cols: Number of character columns
+ *
+ * Create a new screen with the default font and palette, and a terminal
+ * window covering the whole screen.
+ *
+ * Returns: a new VGAScreen
+ */
+VGAScreen *
+vga_screen_new(int rows, int cols)
+{
+	VGAScreen * scr;
+
+	g_return_val_if_fail(rows > 0 && cols > 0, NULL);
+
+	scr = g_new0(VGAScreen, 1);
+	scr->rows = rows;
+	scr->cols = cols;
+	vga_screen_alloc_videobuf(scr);
+
+	scr->font = vga_font_ref(vga_font_stock(FONT_DEFAULT));
+	scr->font_serial = vga_screen_next_serial();
+	scr->pal = vga_palette_dup(vga_palette_stock(PAL_DEFAULT));
+	scr->pal_serial = vga_screen_next_serial();
+
+	scr->icecolor = TRUE;
+	scr->cursor_visible = TRUE;
+
+	scr->textattr = 0x07;
+	scr->win_top_left_x = 1;
+	scr->win_top_left_y = 1;
+	scr->win_bot_right_x = cols;
+	scr->win_bot_right_y = rows;
+
+	return scr;
+}
+
+/**
+ * vga_screen_dup:
+ * @src: Screen to copy
+ *
+ * Returns: A new screen with the same contents and state as @src.
+ */
+VGAScreen *
+vga_screen_dup(VGAScreen * src)
+{
+	VGAScreen * scr;
+
+	g_return_val_if_fail(src != NULL, NULL);
+
+	scr = vga_screen_new(src->rows, src->cols);
+	vga_screen_copy_from(scr, src);
+	vga_screen_clear_damage(scr);
+
+	return scr;
+}
+
+void
+vga_screen_destroy(VGAScreen * scr)
+{
+	g_return_if_fail(scr != NULL);
+
+	vga_font_destroy(scr->font);
+	vga_palette_destroy(scr->pal);
+	g_free(scr->video_buf);
+	g_free(scr->dirty_start);
+	g_free(scr->dirty_end);
+	g_free(scr);
+}
+
+/**
+ * vga_screen_copy_from:
+ * @scr: Screen to update
+ * @src: Screen to copy from
+ *
+ * Make @scr look like @src.  Only the cells that actually differ are
+ * copied and damaged, and the font and palette are only copied when their
+ * serial numbers differ, so this is cheap when little has changed.
+ */
+void
+vga_screen_copy_from(VGAScreen * scr, VGAScreen * src)
+{
+	vga_charcell * a, * b;
+	int y, first, last;
+
+	g_return_if_fail(scr != NULL);
+	g_return_if_fail(src != NULL);
+
+	vga_screen_resize(scr, src->rows, src->cols);
+
+	for (y = 0; y < src->rows; y++)
+	{
+		a = scr->video_buf + y * src->cols;
+		b = src->video_buf + y * src->cols;
+		if (memcmp(a, b, src->cols * sizeof(vga_charcell)) == 0)
+			continue;
+
+		first = 0;
+		while (a[first].c == b[first].c && a[first].attr == b[first].attr)
+			first++;
+		last = src->cols - 1;
+		while (a[last].c == b[last].c && a[last].attr == b[last].attr)
+			last--;
+
+		memcpy(a + first, b + first,
+			(last - first + 1) * sizeof(vga_charcell));
+		vga_screen_damage(scr, first, y, last - first + 1, 1);
+	}
+
+	if (scr->font_serial != src->font_serial)
+	{
+		/* Shared, not copied; whichever screen changes it next gets
+		 * its own copy then */
+		vga_font_ref(src->font);
+		vga_font_destroy(scr->font);
+		scr->font = src->font;
+		scr->font_serial = src->font_serial;
+		scr->changes |= VGA_SCREEN_FONT | VGA_SCREEN_DIRTY;
+	}
+	if (scr->pal_serial != src->pal_serial)
+	{
+		vga_palette_copy_from(scr->pal, src->pal);
+		scr->pal_serial = src->pal_serial;
+		scr->changes |= VGA_SCREEN_PALETTE | VGA_SCREEN_DIRTY;
+	}
+
+	vga_screen_set_icecolor(scr, src->icecolor);
+	vga_screen_cursor_set_visible(scr, src->cursor_visible);
+	vga_screen_cursor_move(scr, src->cursor_x, src->cursor_y);
+
+	scr->textattr = src->textattr;
+	scr->win_top_left_x = src->win_top_left_x;
+	scr->win_top_left_y = src->win_top_left_y;
+	scr->win_bot_right_x = src->win_bot_right_x;
+	scr->win_bot_right_y = src->win_bot_right_y;
+	scr->last_char = src->last_char;
+}
+
+/**
+ * vga_screen_resize:
+ * @scr: VGAScreen
+ * @rows: New number of rows
+ * @cols: New number of columns
+ *
+ * Change the size of the screen.  Like the VGAText methods this is based
+ * on, the contents are cleared.
+ */
+void
+vga_screen_resize(VGAScreen * scr, int rows, int cols)
+{
+	g_return_if_fail(scr != NULL);
+	g_return_if_fail(rows > 0 && cols > 0);
+
+	if (rows == scr->rows && cols == scr->cols)
+		return;
+
+	scr->rows = rows;
+	scr->cols = cols;
+	vga_screen_alloc_videobuf(scr);
+
+	scr->cursor_x = MIN(scr->cursor_x, cols - 1);
+	scr->cursor_y = MIN(scr->cursor_y, rows - 1);
+	scr->changes |= VGA_SCREEN_RESIZE | VGA_SCREEN_DIRTY;
+}
+
+
+/*************************************
+ * Damage tracking
+ *************************************/
+
+/**
+ * vga_screen_damage:
+ * @scr: VGAScreen
+ * @col: First column
+ * @row: First row
+ * @cols: Number of columns
+ * @rows: Number of rows
+ *
+ * Mark a rectangle of cells as needing to be redrawn.  Damage is kept as
+ * one span of columns per row.
+ */
+void
+vga_screen_damage(VGAScreen * scr, int col, int row, int cols, int rows)
+{
+	int y, end_col, end_row;
+
+	/* Everything gets redrawn anyway */
+	if (scr->changes & VGA_SCREEN_DIRTY)
+		return;
+
+	end_col = MIN(col + cols, scr->cols);
+	end_row = MIN(row + rows, scr->rows);
+	col = MAX(col, 0);
+	row = MAX(row, 0);
+	if (col >= end_col || row >= end_row)
+		return;
+
+	for (y = row; y < end_row; y++)
+	{
+		if (scr->dirty_start[y] < 0 || col < scr->dirty_start[y])
+			scr->dirty_start[y] = col;
+		if (end_col > scr->dirty_end[y])
+			scr->dirty_end[y] = end_col;
+	}
+	scr->dirty_top = MIN(scr->dirty_top, row);
+	scr->dirty_bottom = MAX(scr->dirty_bottom, end_row);
+}
+
+void
+vga_screen_damage_all(VGAScreen * scr)
+{
+	scr->changes |= VGA_SCREEN_DIRTY;
+}
+
+/**
+ * vga_screen_clear_damage:
+ * @scr: VGAScreen
+ *
+ * Forget all recorded damage, including pending bells and view scrolling.
+ * Called by whoever consumes the damage once it has been acted on.
+ */
+void
+vga_screen_clear_damage(VGAScreen * scr)
+{
+	int y;
+
+	for (y = scr->dirty_top; y < scr->dirty_bottom; y++)
+	{
+		scr->dirty_start[y] = -1;
+		scr->dirty_end[y] = 0;
+	}
+	scr->dirty_top = scr->rows;
+	scr->dirty_bottom = 0;
+	scr->changes = 0;
+	scr->scroll_lines = 0;
+	scr->bells = 0;
+}
+
+/* Call after modifying scr->font in place */
+void
+vga_screen_font_changed(VGAScreen * scr)
+{
+	scr->font_serial = vga_screen_next_serial();
+	scr->changes |= VGA_SCREEN_FONT | VGA_SCREEN_DIRTY;
+}
+
+/**
+ * vga_screen_glyphs_changed:
+ * @scr: VGAScreen
+ * @first: First character whose glyph changed
+ * @last: Last character whose glyph changed
+ *
+ * Like vga_screen_font_changed(), but only the cells that show one of the
+ * characters are damaged.  Use this after vga_font_set_chars().
+ */
+void
+vga_screen_glyphs_changed(VGAScreen * scr, guchar first, guchar last)
+{
+	vga_charcell * cell;
+	int x, y, start, end;
+
+	scr->font_serial = vga_screen_next_serial();
+	scr->changes |= VGA_SCREEN_FONT;
+	if (scr->changes & VGA_SCREEN_DIRTY)
+		return;
+
+	for (y = 0; y < scr->rows; y++)
+	{
+		start = -1;
+		end = -1;
+		cell = &scr->video_buf[y * scr->cols];
+		for (x = 0; x < scr->cols; x++, cell++)
+		{
+			/* One unsigned compare for first <= c <= last */
+			if ((guchar) (cell->c - first) <= (guchar) (last - first))
+			{
+				if (start < 0)
+					start = x;
+				end = x;
+			}
+		}
+		if (start >= 0)
+			vga_screen_damage(scr, start, y, end - start + 1, 1);
+	}
+}
+
+/**
+ * vga_screen_set_font:
+ * @scr: VGAScreen
+ * @font: Font to show the screen in
+ *
+ * The screen keeps its own reference to @font.
+ */
+void
+vga_screen_set_font(VGAScreen * scr, VGAFont * font)
+{
+	g_return_if_fail(scr != NULL);
+	g_return_if_fail(font != NULL);
+
+	vga_font_ref(font);
+	vga_font_destroy(scr->font);
+	scr->font = font;
+	vga_screen_font_changed(scr);
+}
+
+/**
+ * vga_screen_get_writable_font:
+ * @scr: VGAScreen
+ *
+ * Get the screen's font for modifying in place, first giving the screen a
+ * copy of its own if the font is shared.  Call vga_screen_font_changed()
+ * afterwards.
+ *
+ * Returns: The screen's font
+ */
+VGAFont *
+vga_screen_get_writable_font(VGAScreen * scr)
+{
+	VGAFont * font;
+
+	g_return_val_if_fail(scr != NULL, NULL);
+
+	if (!vga_font_is_writable(scr->font))
+	{
+		font = vga_font_dup(scr->font);
+		vga_font_destroy(scr->font);
+		scr->font = font;
+	}
+
+	return scr->font;
+}
+
+/* Call after modifying scr->pal in place */
+void
+vga_screen_palette_changed(VGAScreen * scr)
+{
+	scr->pal_serial = vga_screen_next_serial();
+	scr->changes |= VGA_SCREEN_PALETTE | VGA_SCREEN_DIRTY;
+}
+
+/**
+ * vga_screen_palette_colors_changed:
+ * @scr: VGAScreen
+ * @colors: Text colors whose registers changed, bit n for color n
+ *
+ * Like vga_screen_palette_changed(), but only the cells that show one of
+ * @colors are damaged.  Use this when only some registers changed, such
+ * as during a palette morph.
+ */
+void
+vga_screen_palette_colors_changed(VGAScreen * scr, guint colors)
+{
+	vga_charcell * cell;
+	guchar bg;
+	int x, y, first, last;
+
+	scr->pal_serial = vga_screen_next_serial();
+	scr->changes |= VGA_SCREEN_PALETTE;
+	if (colors == 0 || (scr->changes & VGA_SCREEN_DIRTY))
+		return;
+
+	for (y = 0; y < scr->rows; y++)
+	{
+		first = -1;
+		last = -1;
+		cell = &scr->video_buf[y * scr->cols];
+		for (x = 0; x < scr->cols; x++, cell++)
+		{
+			bg = GETBG(cell->attr);
+			if (GETBLINK(cell->attr) && scr->icecolor)
+				bg = BRIGHT(bg);
+			if (((1 << GETFG(cell->attr)) | (1 << bg)) & colors)
+			{
+				if (first < 0)
+					first = x;
+				last = x;
+			}
+		}
+		if (first >= 0)
+			vga_screen_damage(scr, first, y, last - first + 1, 1);
+	}
+}
+
+
+/*************************************
+ * Character cell methods
+ *************************************/
+
+static void
+vga_screen_fill(vga_charcell * cell, guchar attr, int count)
+{
+	while (count--)
+	{
+		cell->c = 0x00;
+		cell->attr = attr;
+		cell++;
+	}
+}
+
+void
+vga_screen_put_char(VGAScreen * scr, guchar c, guchar attr, int col, int row)
+{
+	int ofs;
+
+	if (col < 0 || col >= scr->cols || row < 0 || row >= scr->rows)
+		return;
+
+	ofs = scr->cols * row + col;
+	scr->video_buf[ofs].c = c;
+	scr->video_buf[ofs].attr = attr;
+
+	vga_screen_damage(scr, col, row, 1, 1);
+}
+
+/* String will be truncated if it exceeds the screen width */
+void
+vga_screen_put_string(VGAScreen * scr, const guchar * s, guchar attr,
+		int col, int row)
+{
+	int ofs, i, len;
+
+	g_return_if_fail(s != NULL);
+	if (col < 0 || col >= scr->cols || row < 0 || row >= scr->rows)
+		return;
+
+	len = strlen((const char *) s);
+	if (len > (scr->cols - col))
+		len = scr->cols - col;
+
+	ofs = scr->cols * row + col;
+	for (i = 0; i < len; i++)
+	{
+		scr->video_buf[ofs].c = s[i];
+		scr->video_buf[ofs++].attr = attr;
+	}
+
+	vga_screen_damage(scr, col, row, len, 1);
+}
+
+void
+vga_screen_clear_area(VGAScreen * scr, guchar attr, int top_left_x,
+		int top_left_y, int cols, int rows)
+{
+	int y, endrow;
+
+	top_left_x = MAX(top_left_x, 0);
+	top_left_y = MAX(top_left_y, 0);
+	cols = MIN(cols, scr->cols - top_left_x);
+	endrow = MIN(top_left_y + rows, scr->rows);
+	if (cols <= 0 || endrow <= top_left_y)
+		return;
+
+	/* Special case optimization */
+	if (cols == scr->cols)
+		vga_screen_fill(scr->video_buf + top_left_y * cols, attr,
+				cols * (endrow - top_left_y));
+	else
+		for (y = top_left_y; y < endrow; y++)
+			vga_screen_fill(scr->video_buf + y * scr->cols +
+					top_left_x, attr, cols);
+
+	vga_screen_damage(scr, top_left_x, top_left_y, cols,
+			endrow - top_left_y);
+}
+
+void
+vga_screen_cursor_move(VGAScreen * scr, int x, int y)
+{
+	if (x == scr->cursor_x && y == scr->cursor_y)
+		return;
+
+	/* The cursor is drawn over its cell, so both cells need a repaint */
+	if (scr->cursor_visible)
+		vga_screen_damage(scr, scr->cursor_x, scr->cursor_y, 1, 1);
+
+	scr->cursor_x = x;
+	scr->cursor_y = y;
+
+	if (scr->cursor_visible)
+		vga_screen_damage(scr, x, y, 1, 1);
+}
+
+void
+vga_screen_cursor_set_visible(VGAScreen * scr, gboolean visible)
+{
+	visible = visible ? TRUE : FALSE;
+	if (visible == scr->cursor_visible)
+		return;
+
+	scr->cursor_visible = visible;
+	scr->changes |= VGA_SCREEN_CURSOR;
+	vga_screen_damage(scr, scr->cursor_x, scr->cursor_y, 1, 1);
+}
+
+/*
+ * Enable or disable iCECOLOR (use 'high intensity backgrounds' rather than
+ * 'blink' for the blink bit of the text attribute.
+ */
+void
+vga_screen_set_icecolor(VGAScreen * scr, gboolean status)
+{
+	status = status ? TRUE : FALSE;
+	if (status == scr->icecolor)
+		return;
+
+	scr->icecolor = status;
+	vga_screen_damage_all(scr);
+}
+
+
+/*************************************
+ * Terminal methods
+ *************************************/
+
+void
+vga_screen_writec(VGAScreen * scr, guchar c)
+{
+	int x = -1, y = -1, cx, cy;
+
+	switch (c)
+	{
+		case 10:
+			x = vga_screen_wherex(scr);
+			y = vga_screen_wherey(scr) + 1;
+			/* I Don't know about this.
+			 * Can't some ansi files and boards depend on this
+			 * behavior?  what if they send JUST a newline
+			 * because that's what they really want?
+			 *
+			 * I had this problem with some .tfx files
+			 * that depended on this behavior
+			 *
+			 * Decision: make this an option.
+			 * Translate LF->CR+LF.  Off by default..
+			 *
+			 * Should be settable for directory entries
+			 */
+			if (scr->last_char != 13)
+				x = 1;
+			break;
+		case 13:
+			x = 1;
+			y = vga_screen_wherey(scr);
+			break;
+		case 7:
+			scr->bells++;
+			break;
+		case 8:
+			x = MAX(vga_screen_wherex(scr) - 1, 1);
+			y = vga_screen_wherey(scr);
+			break;
+		default:
+			x = vga_screen_wherex(scr);
+			y = vga_screen_wherey(scr);
+			cx = scr->cursor_x;
+			cy = scr->cursor_y;
+			vga_screen_put_char(scr, c, scr->textattr, cx, cy);
+
+			/* Go to next line? */
+			if (cx+1 == scr->win_bot_right_x)
+			{
+				x = 1;
+				y++;
+			}
+			else
+				x++;
+	}
+	scr->last_char = c;
+	/* Check if we need to scroll down */
+	if (y > (scr->win_bot_right_y - scr->win_top_left_y + 1))
+	{
+		vga_screen_scroll_down(scr, 1);
+#ifdef VGA_DEBUG
+		fprintf(stderr, "win_top_left_y = %d, win_bot_right_y = %d\n",
+				scr->win_top_left_y, scr->win_bot_right_y);
+#endif
+		vga_screen_cursor_move(scr, scr->win_top_left_x - 1,
+					scr->win_bot_right_y - 1);
+	}
+	else
+	if (x != -1 && y != -1)
+	{
+		vga_screen_gotoxy(scr, x, y);
+	}
+}
+
+void
+vga_screen_write(VGAScreen * scr, const guchar * s, gsize len)
+{
+	gsize i;
+
+	for (i = 0; i < len; i++)
+		vga_screen_writec(scr, s[i]);
+}
+
+void
+vga_screen_window(VGAScreen * scr, int x1, int y1, int x2, int y2)
+{
+	g_assert(x1 > 0 && x1 <= x2);
+	g_assert(y1 > 0 && y1 <= y2);
+	g_assert(x2 <= scr->cols);
+	g_assert(y2 <= scr->rows);
+
+	scr->win_top_left_x = x1;
+	scr->win_top_left_y = y1;
+	scr->win_bot_right_x = x2;
+	scr->win_bot_right_y = y2;
+
+	vga_screen_gotoxy(scr, 1, 1);
+}
+
+void
+vga_screen_gotoxy(VGAScreen * scr, int x, int y)
+{
+	/* Boundary coercions */
+	x = MAX(1, x);
+	y = MAX(1, y);
+	x = MIN(scr->win_bot_right_x - scr->win_top_left_x + 1, x);
+	y = MIN(scr->win_bot_right_y - scr->win_top_left_y + 1, y);
+
+	/* Adjust for window offsets */
+	x += scr->win_top_left_x - 1;
+	y += scr->win_top_left_y - 1;
+
+	vga_screen_cursor_move(scr, x - 1, y - 1);
+}
+
+int
+vga_screen_wherex(VGAScreen * scr)
+{
+	return scr->cursor_x - scr->win_top_left_x + 2;
+}
+
+int
+vga_screen_wherey(VGAScreen * scr)
+{
+	return scr->cursor_y - scr->win_top_left_y + 2;
+}
+
+int
+vga_screen_term_cols(VGAScreen * scr)
+{
+	return scr->win_bot_right_x - scr->win_top_left_x + 1;
+}
+
+int
+vga_screen_term_rows(VGAScreen * scr)
+{
+	return scr->win_bot_right_y - scr->win_top_left_y + 1;
+}
+
+void
+vga_screen_clrscr(VGAScreen * scr)
+{
+	vga_screen_clear_area(scr, SETBG(0x00, GETBG(scr->textattr)),
+			scr->win_top_left_x - 1,
+			scr->win_top_left_y - 1,
+			vga_screen_term_cols(scr),
+			vga_screen_term_rows(scr));
+
+	vga_screen_cursor_move(scr, scr->win_top_left_x - 1,
+				scr->win_top_left_y - 1);
+}
+
+/* clears down using 0x00 attr, NOT current textattr */
+void
+vga_screen_clrdown(VGAScreen * scr)
+{
+	vga_screen_clear_area(scr, 0x00,
+			scr->win_top_left_x - 1,
+			scr->cursor_y,
+			vga_screen_term_cols(scr),
+			scr->win_bot_right_y - scr->cursor_y);
+}
+
+/* clears up using 0x00 attr, NOT current textattr */
+void
+vga_screen_clrup(VGAScreen * scr)
+{
+	vga_screen_clear_area(scr, 0x00,
+			scr->win_top_left_x - 1,
+			scr->win_top_left_y - 1,
+			vga_screen_term_cols(scr),
+			scr->cursor_y - scr->win_top_left_y + 2);
+}
+
+void
+vga_screen_clreol(VGAScreen * scr)
+{
+	vga_screen_clear_area(scr, SETBG(0x00, GETBG(scr->textattr)),
+			scr->cursor_x, scr->cursor_y,
+			vga_screen_term_cols(scr) - vga_screen_wherex(scr) + 1,
+			1);
+}
+
+void
+vga_screen_scroll_up(VGAScreen * scr, int lines)
+{
+	scr->win_top_left_y -= lines;
+	scr->win_bot_right_y -= lines;
+	scr->scroll_lines -= lines;
+}
+
+/*
+ * Move the window down the buffer, and have the view follow it.  Once the
+ * window reaches the bottom of the buffer, the buffer contents are shifted
+ * up instead.
+ */
+void
+vga_screen_scroll_down(VGAScreen * scr, int lines)
+{
+	int diff;
+
+	scr->win_top_left_y += lines;
+	scr->win_bot_right_y += lines;
+
+	if (scr->win_bot_right_y > scr->rows)
+	{
+		diff = scr->win_bot_right_y - scr->rows;
+
+#ifdef VGA_DEBUG
+		fprintf(stderr, "exceeded buffer, diff = %d\n", diff);
+#endif
+
+		scr->win_top_left_y -= diff;
+		scr->win_bot_right_y -= diff;
+
+		vga_screen_dellines_absolute(scr, 1, diff);
+	}
+	else
+		scr->scroll_lines += lines;
+}
+
+/*
+ * Shift the rows from @from (0-based) down to the window bottom up by
+ * @lines, within the window's columns.
+ */
+static void
+vga_screen_shift_up(VGAScreen * scr, int from, int to, int lines)
+{
+	int y, cols, win_cols;
+	vga_charcell * buf;
+
+	cols = scr->cols;
+	win_cols = vga_screen_term_cols(scr);
+	buf = scr->video_buf + scr->win_top_left_x - 1;
+
+	/*
+	 * In the case where the window is as wide as the display, we
+	 * can optimize the shifting by using a single memmove() call
+	 */
+	if (win_cols == cols)
+		memmove(buf + from * cols, buf + (from + lines) * cols,
+				(to - from - lines) * cols * sizeof(vga_charcell));
+	else
+		for (y = from; y < to - lines; y++)
+			memmove(buf + y * cols, buf + (y + lines) * cols,
+					win_cols * sizeof(vga_charcell));
+
+	/* Now clear the free'd up lines at the bottom */
+	vga_screen_clear_area(scr, SETBG(0x00, GETBG(scr->textattr)),
+			scr->win_top_left_x - 1, to - lines, win_cols, lines);
+	vga_screen_damage(scr, scr->win_top_left_x - 1, from, win_cols,
+			to - from);
+}
+
+/**
+ * vga_screen_dellines_absolute:
+ * @scr: VGAScreen to operate on
+ * @top_row: Top row (1-based, absolute) of the scroll region
+ * @lines: Number of lines to scroll up
+ *
+ * Like vga_screen_dellines(), but the region extends to the bottom of the
+ * buffer rather than the window.
+ */
+void
+vga_screen_dellines_absolute(VGAScreen * scr, int top_row, int lines)
+{
+	int start_y;
+
+	start_y = MAX(top_row - 1, 0);
+	lines = MIN(lines, scr->rows - start_y);
+	if (lines <= 0)
+		return;
+
+	vga_screen_shift_up(scr, start_y, scr->rows, lines);
+}
+
+/**
+ * vga_screen_dellines:
+ * @scr: VGAScreen to operate on
+ * @top_row: Top row (relative to current window) of scroll region
+ * @lines: Number of lines to scroll up
+ *
+ * From the top row, shift all lines from it and below up
+ * one row.  The current cursor's line becomes overwritten with the contents
+ * of the row under it.  The last row in the display becomes a blank line.
+ */
+void
+vga_screen_dellines(VGAScreen * scr, int top_row, int lines)
+{
+	int start_y, end_y;
+
+	start_y = scr->win_top_left_y + top_row - 2;
+	end_y = scr->win_bot_right_y;
+	lines = MIN(lines, end_y - start_y);
+	if (start_y < 0 || lines <= 0)
+		return;
+
+	vga_screen_shift_up(scr, start_y, end_y, lines);
+}
+
+/**
+ * vga_screen_inslines:
+ * @scr: VGAScreen to operate on
+ * @top_row: Top row (relative to current window) of scroll region
+ * @lines: Number of lines to insert
+ *
+ * From the top row, shift all lines from it and below down
+ * one row.  The last row in the display is truncated, and the current
+ * line becomes a blank line.
+ **/
+void
+vga_screen_inslines(VGAScreen * scr, int top_row, int lines)
+{
+	int y, start_y, end_y, cols, win_cols;
+	vga_charcell * buf;
+
+	cols = scr->cols;
+	win_cols = vga_screen_term_cols(scr);
+	buf = scr->video_buf + scr->win_top_left_x - 1;
+	start_y = scr->win_top_left_y + top_row - 2;
+	end_y = scr->win_bot_right_y;
+	lines = MIN(lines, end_y - start_y);
+	if (start_y < 0 || lines <= 0)
+		return;
+
+	if (win_cols == cols)
+		memmove(buf + (start_y + lines) * cols, buf + start_y * cols,
+			(end_y - start_y - lines) * cols * sizeof(vga_charcell));
+	else
+		/* Start from the bottom */
+		for (y = end_y - 1; y >= start_y + lines; y--)
+			memmove(buf + y * cols, buf + (y - lines) * cols,
+					win_cols * sizeof(vga_charcell));
+
+	/* Now clear the gap lines */
+	vga_screen_clear_area(scr, SETBG(0x00, GETBG(scr->textattr)),
+		scr->win_top_left_x - 1, start_y, win_cols, lines);
+	vga_screen_damage(scr, scr->win_top_left_x - 1, start_y, win_cols,
+			end_y - start_y);
+}
+
+void
+vga_screen_set_attr(VGAScreen * scr, guchar textattr)
+{
+	scr->textattr = textattr;
+}
+
+guchar
+vga_screen_get_attr(VGAScreen * scr)
+{
+	return scr->textattr;
+}
+
+void
+vga_screen_set_fg(VGAScreen * scr, guchar fg)
+{
+	if (fg > 15)
+		fg = (fg & 0x0F) | 0x80;
+	scr->textattr = (scr->textattr & 0x70) | fg;
+}
+
+void
+vga_screen_set_bg(VGAScreen * scr, guchar bg)
+{
+	scr->textattr = (scr->textattr & 0x8F) | ((bg & 0x07) << 4);
+}
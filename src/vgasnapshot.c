@@ -0,0 +1,577 @@
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of version 2 of the GNU General Public License as
+ *  published by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ *****************************************************************************
+ *
+ *  Snapshot layout (all integers little-endian):
+ *
+ *	"VGASNAP" version:8 flags:32
+ *	screen:	rows:16 cols:16 cursor_x:16 cursor_y:16
+ *		icecolor:8 cursor_visible:8 textattr:8 last_char:8
+ *		win_top_left_x:16 win_top_left_y:16
+ *		win_bot_right_x:16 win_bot_right_y:16
+ *		font_width:16 font_height:16 font_data
+ *		palette (256 x r:16 g:16 b:16)
+ *		video_buf (rows x cols x c:8 attr:8)
+ *	emulator, if SNAP_EMU is set:
+ *		ansi:8 vt100:8 avatar:8 textfx:8
+ *		tfx_stage:16 tfx_cmd:8 tfx_num:16 tfx_def_attr:8
+ *		tfx_save_x:8 tfx_save_y:8 tfx_save_attr:8
+ *		tfx_param (tfx_stage - 1 bytes, if any)
+ *		3 x (present:8 [palette])
+ *		morph present:8 [morph_to (palette) morph_left:8
+ *			morph_stride:8]	(version 2 on)
+ *		ansi_code_len:16 ansi_code ansi_save_x:8 ansi_save_y:8
+ *		ansi_esc:8 avt_cmd:8 avt_stage:8 avt_par1:8 avt_par2:8
+ *		vt_code_len:16 vt_code vt_stage:8 vt_cmd:8 vt_save_x:8
+ *		vt_save_y:8 vt_save_attr:8 vt_attr:8 vt_buf (3 bytes)
+ *
+ *  Restoring builds a scratch screen from the snapshot first, so a bad
+ *  snapshot leaves the target untouched, and then copies it over with
+ *  vga_screen_copy_from() so only the cells that differ are redrawn.
+ */
+
+#include "vgasnapshot.h"
+#include "vgatext.h"
+#include "emuprivate.h"
+
+#define SNAP_MAGIC	"VGASNAP"
+#define SNAP_MAGIC_LEN	7
+
+/* Flags */
+#define SNAP_EMU	(1 << 0)
+
+/* Largest screen and font we'll believe a snapshot about */
+#define SNAP_MAX_DIM		4096
+#define SNAP_MAX_FONT_HEIGHT	32
+
+typedef struct
+{
+	const guchar * p;
+	const guchar * end;
+	gboolean ok;
+} SnapReader;
+
+/*************************************
+ * Writing
+ *************************************/
+
+static void
+put_u8(GByteArray * out, guint v)
+{
+	guchar b = v;
+
+	g_byte_array_append(out, &b, 1);
+}
+
+static void
+put_u16(GByteArray * out, guint v)
+{
+	guchar b[2];
+
+	b[0] = v & 0xFF;
+	b[1] = (v >> 8) & 0xFF;
+	g_byte_array_append(out, b, 2);
+}
+
+static void
+put_u32(GByteArray * out, guint32 v)
+{
+	put_u16(out, v & 0xFFFF);
+	put_u16(out, v >> 16);
+}
+
+static void
+put_palette(GByteArray * out, VGAPalette * pal)
+{
+	int i;
+
+	for (i = 0; i < PAL_REGS; i++)
+	{
+		put_u16(out, pal->color[i].red);
+		put_u16(out, pal->color[i].green);
+		put_u16(out, pal->color[i].blue);
+	}
+}
+
+static void
+put_screen(GByteArray * out, VGAScreen * scr)
+{
+	put_u16(out, scr->rows);
+	put_u16(out, scr->cols);
+	put_u16(out, scr->cursor_x);
+	put_u16(out, scr->cursor_y);
+	put_u8(out, scr->icecolor);
+	put_u8(out, scr->cursor_visible);
+	put_u8(out, scr->textattr);
+	put_u8(out, scr->last_char);
+	put_u16(out, scr->win_top_left_x);
+	put_u16(out, scr->win_top_left_y);
+	put_u16(out, scr->win_bot_right_x);
+	put_u16(out, scr->win_bot_right_y);
+
+	put_u16(out, scr->font->width);
+	put_u16(out, scr->font->height);
+	g_byte_array_append(out, scr->font->data,
+			vga_font_pixels(scr->font) * 32);
+
+	put_palette(out, scr->pal);
+
+	/* vga_charcell is just the two bytes */
+	g_byte_array_append(out, (guchar *) scr->video_buf,
+			scr->rows * scr->cols * sizeof(vga_charcell));
+}
+
+static gboolean
+palette_is_black(VGAPalette * pal)
+{
+	int i;
+
+	for (i = 0; i < PAL_REGS * 3; i++)
+		if (pal->vga[i])
+			return FALSE;
+
+	return TRUE;
+}
+
+static void
+put_emu(GByteArray * out, EmuData * emu)
+{
+	int i;
+
+	put_u8(out, emu->ansi);
+	put_u8(out, emu->vt100);
+	put_u8(out, emu->avatar);
+	put_u8(out, emu->textfx);
+
+	put_u16(out, emu->tfx_stage);
+	put_u8(out, emu->tfx_cmd);
+	put_u16(out, emu->tfx_num);
+	put_u8(out, emu->tfx_def_attr);
+	put_u8(out, emu->tfx_save_x);
+	put_u8(out, emu->tfx_save_y);
+	put_u8(out, emu->tfx_save_attr);
+	if (emu->tfx_stage > 1)
+		g_byte_array_append(out, emu->tfx_param, emu->tfx_stage - 1);
+
+	/* Unused user palettes are all black; don't bother saving those */
+	for (i = 0; i < TFX_NUM_UPALS; i++)
+	{
+		if (palette_is_black(emu->tfx_user_pal[i]))
+			put_u8(out, 0);
+		else
+		{
+			put_u8(out, 1);
+			put_palette(out, emu->tfx_user_pal[i]);
+		}
+	}
+
+	if (emu->morph_to)
+	{
+		put_u8(out, 1);
+		put_palette(out, emu->morph_to);
+		put_u8(out, emu->morph_left);
+		put_u8(out, emu->morph_stride);
+	}
+	else
+		put_u8(out, 0);
+
+	put_u16(out, emu->ansi_code->len);
+	g_byte_array_append(out, (guchar *) emu->ansi_code->str,
+			emu->ansi_code->len);
+	put_u8(out, emu->ansi_save_x);
+	put_u8(out, emu->ansi_save_y);
+	put_u8(out, emu->ansi_esc);
+	put_u8(out, emu->avt_cmd);
+	put_u8(out, emu->avt_stage);
+	put_u8(out, emu->avt_par1);
+	put_u8(out, emu->avt_par2);
+
+	put_u16(out, emu->vt_code->len);
+	g_byte_array_append(out, (guchar *) emu->vt_code->str,
+			emu->vt_code->len);
+	put_u8(out, emu->vt_stage);
+	put_u8(out, emu->vt_cmd);
+	put_u8(out, emu->vt_save_x);
+	put_u8(out, emu->vt_save_y);
+	put_u8(out, emu->vt_save_attr);
+	put_u8(out, emu->vt_attr);
+	g_byte_array_append(out, emu->vt_buf, 3);
+}
+
+/*************************************
+ * Reading
+ *************************************/
+
+/* Take @len bytes, or NULL if there aren't that many left */
+static const guchar *
+get_bytes(SnapReader * r, gsize len)
+{
+	const guchar * p = r->p;
+
+	if (!r->ok || (gsize) (r->end - r->p) < len)
+	{
+		r->ok = FALSE;
+		return NULL;
+	}
+
+	r->p += len;
+	return p;
+}
+
+static guint
+get_u8(SnapReader * r)
+{
+	const guchar * p = get_bytes(r, 1);
+
+	return p ? p[0] : 0;
+}
+
+static guint
+get_u16(SnapReader * r)
+{
+	const guchar * p = get_bytes(r, 2);
+
+	return p ? p[0] | (p[1] << 8) : 0;
+}
+
+static guint32
+get_u32(SnapReader * r)
+{
+	guint32 lo = get_u16(r);
+
+	return lo | ((guint32) get_u16(r) << 16);
+}
+
+static void
+get_palette(SnapReader * r, VGAPalette * pal)
+{
+	guchar rgb[3];
+	int i, j;
+
+	/* Stored as GdkColor values, which all come from 6-bit ones */
+	for (i = 0; i < PAL_REGS; i++)
+	{
+		for (j = 0; j < 3; j++)
+			rgb[j] = FROM_GDK_RGB(get_u16(r));
+		vga_palette_set_reg(pal, i, rgb[0], rgb[1], rgb[2]);
+	}
+}
+
+/* Read the screen section into a new screen, or NULL if it's bad */
+static VGAScreen *
+get_screen(SnapReader * r, VGAScreen * like)
+{
+	VGAScreen * scr;
+	VGAFont * f;
+	const guchar * font, * buf;
+	int rows, cols, width, height;
+
+	rows = get_u16(r);
+	cols = get_u16(r);
+	if (!r->ok || rows < 1 || cols < 1 ||
+		rows > SNAP_MAX_DIM || cols > SNAP_MAX_DIM)
+		return NULL;
+
+	scr = vga_screen_new(rows, cols);
+	scr->cursor_x = get_u16(r);
+	scr->cursor_y = get_u16(r);
+	scr->icecolor = get_u8(r);
+	scr->cursor_visible = get_u8(r);
+	scr->textattr = get_u8(r);
+	scr->last_char = get_u8(r);
+	scr->win_top_left_x = get_u16(r);
+	scr->win_top_left_y = get_u16(r);
+	scr->win_bot_right_x = get_u16(r);
+	scr->win_bot_right_y = get_u16(r);
+
+	/* Check the font's size before trusting it for the data's length */
+	width = get_u16(r);
+	height = get_u16(r);
+	font = NULL;
+	if (width == 8 && height >= 1 && height <= SNAP_MAX_FONT_HEIGHT)
+		font = get_bytes(r, width * height * 32);
+	if (font == NULL ||
+		scr->cursor_x >= cols || scr->cursor_y >= rows ||
+		scr->win_top_left_x < 1 || scr->win_top_left_y < 1 ||
+		scr->win_bot_right_x > cols || scr->win_bot_right_y > rows ||
+		scr->win_top_left_x > scr->win_bot_right_x ||
+		scr->win_top_left_y > scr->win_bot_right_y)
+	{
+		vga_screen_destroy(scr);
+		return NULL;
+	}
+
+	/* Share the target's font and serial if nothing changed, to save
+	 * reloading */
+	if (like->font->width == width && like->font->height == height &&
+		memcmp(like->font->data, font, width * height * 32) == 0)
+	{
+		vga_screen_set_font(scr, like->font);
+		scr->font_serial = like->font_serial;
+	}
+	else
+	{
+		f = vga_font_new();
+		if (!vga_font_load(f, (guchar *) font, width, height))
+		{
+			vga_font_destroy(f);
+			vga_screen_destroy(scr);
+			return NULL;
+		}
+		vga_screen_set_font(scr, f);
+		vga_font_destroy(f);
+	}
+
+	get_palette(r, scr->pal);
+	if (memcmp(like->pal->vga, scr->pal->vga,
+				sizeof(scr->pal->vga)) == 0)
+		scr->pal_serial = like->pal_serial;
+
+	buf = get_bytes(r, rows * cols * sizeof(vga_charcell));
+	if (buf == NULL)
+	{
+		vga_screen_destroy(scr);
+		return NULL;
+	}
+	memcpy(scr->video_buf, buf, rows * cols * sizeof(vga_charcell));
+
+	return scr;
+}
+
+static gboolean
+get_emu(SnapReader * r, EmuData * emu, int version)
+{
+	const guchar * p;
+	guint len;
+	int i;
+
+	emu->ansi = get_u8(r);
+	emu->vt100 = get_u8(r);
+	emu->avatar = get_u8(r);
+	emu->textfx = get_u8(r);
+
+	emu->tfx_stage = (gint16) get_u16(r);
+	emu->tfx_cmd = get_u8(r);
+	emu->tfx_num = get_u16(r);
+	emu->tfx_def_attr = get_u8(r);
+	emu->tfx_save_x = get_u8(r);
+	emu->tfx_save_y = get_u8(r);
+	emu->tfx_save_attr = get_u8(r);
+	/* Mid-command, the next parameter must be one the command takes */
+	if (emu->tfx_stage < -1 ||
+		emu->tfx_num > sizeof(emu->tfx_param) ||
+		(emu->tfx_stage > 0 && emu->tfx_stage > emu->tfx_num))
+		return FALSE;
+	if (emu->tfx_stage > 1)
+	{
+		if ((p = get_bytes(r, emu->tfx_stage - 1)) == NULL)
+			return FALSE;
+		memcpy(emu->tfx_param, p, emu->tfx_stage - 1);
+	}
+	if (emu->tfx_stage > 0 && emu->tfx_num != emu_tfx_param_len(
+				emu->tfx_cmd, emu->tfx_param,
+				emu->tfx_stage - 1))
+		return FALSE;
+
+	for (i = 0; i < TFX_NUM_UPALS; i++)
+	{
+		if (get_u8(r))
+			get_palette(r, emu->tfx_user_pal[i]);
+		else
+			memset(emu->tfx_user_pal[i], 0, sizeof(VGAPalette));
+	}
+
+	/* A morph carries on from where it was */
+	if (version >= 2 && get_u8(r))
+	{
+		emu->morph_to = vga_palette_new();
+		get_palette(r, emu->morph_to);
+		emu->morph_left = get_u8(r);
+		emu->morph_stride = get_u8(r);
+		if (emu->morph_left < 1 || emu->morph_left > 63 ||
+			emu->morph_stride < 1)
+			return FALSE;
+	}
+
+	len = get_u16(r);
+	if ((p = get_bytes(r, len)) == NULL)
+		return FALSE;
+	g_string_truncate(emu->ansi_code, 0);
+	g_string_append_len(emu->ansi_code, (const gchar *) p, len);
+	emu->ansi_save_x = get_u8(r);
+	emu->ansi_save_y = get_u8(r);
+	emu->ansi_esc = get_u8(r);
+	emu->avt_cmd = get_u8(r);
+	emu->avt_stage = get_u8(r);
+	emu->avt_par1 = get_u8(r);
+	emu->avt_par2 = get_u8(r);
+
+	len = get_u16(r);
+	if ((p = get_bytes(r, len)) == NULL)
+		return FALSE;
+	g_string_truncate(emu->vt_code, 0);
+	g_string_append_len(emu->vt_code, (const gchar *) p, len);
+	emu->vt_stage = get_u8(r);
+	emu->vt_cmd = get_u8(r);
+	emu->vt_save_x = get_u8(r);
+	emu->vt_save_y = get_u8(r);
+	emu->vt_save_attr = get_u8(r);
+	emu->vt_attr = get_u8(r);
+	if ((p = get_bytes(r, 3)) == NULL)
+		return FALSE;
+	memcpy(emu->vt_buf, p, 3);
+
+	return r->ok;
+}
+
+/*************************************
+ * Public methods
+ *************************************/
+
+/**
+ * vga_snapshot_append:
+ * @out: Where to put the snapshot
+ * @scr: Screen to save
+ * @emu: Emulator to save, or NULL
+ *
+ * Append a snapshot of @scr and @emu to @out.  Neither is changed; a
+ * palette morph in progress on @emu is saved as it is.
+ */
+void
+vga_snapshot_append(GByteArray * out, VGAScreen * scr, EmuData * emu)
+{
+	g_return_if_fail(out != NULL);
+	g_return_if_fail(scr != NULL);
+
+	g_byte_array_append(out, (const guchar *) SNAP_MAGIC, SNAP_MAGIC_LEN);
+	put_u8(out, VGA_SNAPSHOT_VERSION);
+	put_u32(out, emu ? SNAP_EMU : 0);
+
+	put_screen(out, scr);
+	if (emu)
+		put_emu(out, emu);
+}
+
+/**
+ * vga_snapshot_save:
+ * @scr: Screen to save
+ * @emu: Emulator to save, or NULL
+ *
+ * Returns: a new GByteArray holding the snapshot
+ */
+GByteArray *
+vga_snapshot_save(VGAScreen * scr, EmuData * emu)
+{
+	GByteArray * out;
+
+	g_return_val_if_fail(scr != NULL, NULL);
+
+	/* The font, palette and video buffer are nearly all of it */
+	out = g_byte_array_sized_new(64 + vga_font_pixels(scr->font) * 32 +
+			PAL_REGS * 6 +
+			scr->rows * scr->cols * sizeof(vga_charcell) +
+			(emu ? 8192 : 0));
+	vga_snapshot_append(out, scr, emu);
+
+	return out;
+}
+
+/**
+ * vga_snapshot_restore:
+ * @scr: Screen to restore into
+ * @emu: Emulator to restore into, or NULL
+ * @data: The snapshot
+ * @len: Length of @data
+ *
+ * Make @scr (and @emu, if both it and the snapshot have emulator state)
+ * the same as when the snapshot was taken.  Only what actually differs is
+ * damaged.  If the snapshot is bad, nothing is changed.
+ *
+ * Returns: TRUE on success
+ */
+gboolean
+vga_snapshot_restore(VGAScreen * scr, EmuData * emu, const guchar * data,
+		gsize len)
+{
+	SnapReader r;
+	VGAScreen * tmp;
+	EmuData * tmp_emu = NULL;
+	const guchar * magic;
+	guint32 flags;
+	int version;
+
+	g_return_val_if_fail(scr != NULL, FALSE);
+	g_return_val_if_fail(data != NULL, FALSE);
+
+	r.p = data;
+	r.end = data + len;
+	r.ok = TRUE;
+
+	magic = get_bytes(&r, SNAP_MAGIC_LEN);
+	if (magic == NULL || memcmp(magic, SNAP_MAGIC, SNAP_MAGIC_LEN) != 0)
+		return FALSE;
+	version = get_u8(&r);
+	if (version < 1 || version > VGA_SNAPSHOT_VERSION)
+		return FALSE;
+	flags = get_u32(&r);
+
+	if ((tmp = get_screen(&r, scr)) == NULL)
+		return FALSE;
+
+	if ((flags & SNAP_EMU) && emu)
+	{
+		tmp_emu = vga_emu_new(tmp);
+		if (!get_emu(&r, tmp_emu, version))
+		{
+			vga_emu_destroy(tmp_emu);
+			vga_screen_destroy(tmp);
+			return FALSE;
+		}
+	}
+
+	vga_screen_copy_from(scr, tmp);
+	if (tmp_emu)
+	{
+		vga_emu_copy_state(emu, tmp_emu);
+		vga_emu_destroy(tmp_emu);
+	}
+	vga_screen_destroy(tmp);
+
+	return TRUE;
+}
+
+/* Snapshot a VGATerm along with its emulator */
+GByteArray *
+vga_term_snapshot_save(GtkWidget * term)
+{
+	g_return_val_if_fail(term != NULL, NULL);
+
+	return vga_snapshot_save(vga_get_screen(term),
+			vga_term_emu_get_data(term));
+}
+
+/* Restore a VGATerm and its emulator, and redraw what changed */
+gboolean
+vga_term_snapshot_restore(GtkWidget * term, const guchar * data, gsize len)
+{
+	g_return_val_if_fail(term != NULL, FALSE);
+
+	if (!vga_snapshot_restore(vga_get_screen(term),
+				vga_term_emu_get_data(term), data, len))
+		return FALSE;
+
+	vga_term_update(term);
+	return TRUE;
+}
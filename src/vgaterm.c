@@ -25,6 +25,9 @@
  *  Cursor positions in this widget are both 1-based and relative to the
  *  current window area (default entire area).  This differs from the VGAText
  *  widget, where they are 0-based and absolute.
+ *
+ *  The terminal logic itself is in the VGAScreen terminal methods; these
+ *  just apply them to the widget's screen and draw the result.
  */
 
 #include <gdk/gdk.h>
@@ -88,14 +91,8 @@ static void vga_term_init(VGATerm * term)
 	fprintf(stderr, "vga_term_init()\n");
 #endif
 
-	/* Initialize public fields */
-	term->textattr = 0x07;
-	term->win_top_left_x = 1;
-	term->win_top_left_y = 1;
-	term->win_bot_right_x = 80;
-	term->win_bot_right_y = 25;
+	/* The text attribute and window live in the VGAText's screen */
 
-	
 	/* Initialize private data */
 	pvt = term->pvt = g_malloc0(sizeof(*term->pvt));
 }
@@ -160,207 +157,89 @@ void vga_term_set_adjustment(GtkWidget *widget, GtkAdjustment *adjustment)
 }
 
 /**
- * vga_term_process_char:
+ * vga_term_update:
  * @widget: VGA Terminal widget
- * @c: Character to process
  *
- * Update display in memory for printing a character but don't actually
- * refresh the physical display.
+ * Draw whatever changed in the terminal's screen since the last update,
+ * and have the scrolling adjustment follow the terminal window.  The
+ * terminal methods below call this themselves; it is only needed after
+ * modifying the screen from vga_get_screen() directly.
  */
-static
-void __deprecated_vga_term_process_char(GtkWidget * widget, guchar c)
+void vga_term_update(GtkWidget * widget)
 {
-	static guchar lc = '\0';		/* Last character */
-	gboolean cursor_vis;
 	VGATerm * term;
-	int x = -1, y = -1;
-	
+	VGAScreen * scr;
+
 	g_return_if_fail(widget != NULL);
 	g_return_if_fail(VGA_IS_TERM(widget));
 	term = VGA_TERM(widget);
+	scr = vga_get_screen(widget);
 
-	switch (c)
-	{
-		case 10:
-			x = vga_term_wherex(widget);
-			y = vga_term_wherey(widget) + 1;
-			if (lc != 13)
-				x = 1;
-			break;
-		case 13:
-			x = 1;
-			y = vga_term_wherey(widget);
-			break;
-		case 8:
-			x = vga_term_wherex(widget) - 1;
-			y = vga_term_wherey(widget);
-			break;
-		default:
-			//buf = vga_get_video_buf(widget);
-			/*
-			ofs = buf + (vga_cursor_y(widget) *
-					vga_get_cols(widget) +
-					vga_cursor_x(widget)) * 2;
-			*(ofs) = c;
-			*(ofs + 1) = term->textattr;
-			*/
-			x = vga_cursor_x(widget);
-			y = vga_cursor_y(widget);
-			vga_put_char(widget, c, term->textattr, x, y);
-
-			/* Go to next line? */
-			if ((x+1) == term->win_bot_right_x)
-			{
-				x = 1;
-				/* Need to scroll? */
-				if ((y+1) == term->win_bot_right_y)
-				{
-					cursor_vis =
-						vga_cursor_is_visible(widget);
-					if (cursor_vis)
-						vga_cursor_set_visible(widget,
-								FALSE);
-					vga_cursor_move(widget,
-						term->win_top_left_x - 1,
-						term->win_top_left_y - 1);
-					vga_term_dellines(widget, vga_term_wherey(widget), 1);
-					x = term->win_top_left_x;
-					y = term->win_bot_right_y;
-					vga_cursor_move(widget, x-1, y-1);
-					if (cursor_vis)
-						vga_cursor_set_visible(widget,
-								TRUE);
-					/* Don't need to update cursor */
-					x = -1;
-					y = -1;
-				}
-				else
-					y++;
-			}
-			else
-			{
-				x++;
-				y = vga_term_wherey(widget);
-			}
-	}
-	lc = c;
-	if (x != -1 && y != -1)
-	{
-		vga_cursor_move(widget, x - 1, y - 1);
-		g_print("[x->%d, y->%d]", x-1, y-1);
-	}
+	/* Scrolling waits for the end of fast-forwarding, like drawing */
+	if (vga_get_fast_forward(widget))
+		return;
+
+	if (scr->scroll_lines != 0)
+		gtk_adjustment_set_value(term->adjustment,
+				term->adjustment->value +
+				scr->scroll_lines * scr->font->height *
+					vga_get_zoom(widget));
+
+	vga_update(widget);
 }
 
-void vga_term_writec(GtkWidget * widget, guchar c)
+/**
+ * vga_term_set_fast_forward:
+ * @widget: VGA Terminal widget
+ * @status: Whether to fast-forward
+ *
+ * vga_set_fast_forward() for terminals.  Turning it off also scrolls the
+ * view to follow the terminal window, before the one repaint.
+ */
+void vga_term_set_fast_forward(GtkWidget * widget, gboolean status)
 {
-	static guchar lc = '\0';		/* Last character */
-	gboolean cursor_vis;
 	VGATerm * term;
-	int x = -1, y = -1, cx, cy;
-	
+	VGAScreen * scr;
+
 	g_return_if_fail(widget != NULL);
 	g_return_if_fail(VGA_IS_TERM(widget));
 	term = VGA_TERM(widget);
+	scr = vga_get_screen(widget);
 
-	//g_print("%c", c);
-	switch (c)
-	{
-		case 10:
-			x = vga_term_wherex(widget);
-			y = vga_term_wherey(widget) + 1;
-			/* I Don't know about this.
-			 * Can't some ansi files and boards depend on this
-			 * behavior?  what if they send JUST a newline
-			 * because that's what they really want?
-			 *
-			 * I had this problem with some .tfx files
-			 * that depended on this behavior
-			 *
-			 * Decision: make this an option.
-			 * Translate LF->CR+LF.  Off by default..
-			 *
-			 * Should be settable for directory entries
-			 */
-			if (lc != 13)
-				x = 1;
-			break;
-		case 13:
-			x = 1;
-			y = vga_term_wherey(widget);
-			break;
-		case 7:
-			gdk_beep();
-			break;
-		case 8:
-			x = MAX(vga_term_wherex(widget) - 1, 1);
-			y = vga_term_wherey(widget);
-			break;
-		default:
-			/*buf = vga_get_video_buf(widget);
-			
-			ofs = buf + (vga_cursor_y(widget) *
-					vga_get_cols(widget) +
-					vga_cursor_x(widget)) * 2;
-			*(ofs) = c;
-			*(ofs + 1) = term->textattr;
-			*/
-			x = vga_term_wherex(widget);
-			y = vga_term_wherey(widget);
-			cx = vga_cursor_x(widget);
-			cy = vga_cursor_y(widget);
-			/*
-			if (c == '[')
-				g_print("@<%d,%d>", cx, cy);
-			*/
-			vga_put_char(widget, c, term->textattr, cx, cy);
-
-			/* Go to next line? */
-			if (cx+1 == term->win_bot_right_x)
-			{
-				x = 1;
-				y++;
-			}
-			else
-				x++;
-	}
-	lc = c;
-	/* Check if we need to scroll down */
-	if (y > (term->win_bot_right_y - term->win_top_left_y + 1))
-	{
-		cursor_vis = vga_cursor_is_visible(widget);
-		if (cursor_vis)
-			vga_cursor_set_visible(widget, FALSE);
-		vga_cursor_move(widget,	term->win_top_left_x - 1,
-					term->win_top_left_y - 1);
-		// JJS Start
-		vga_term_scroll_down(GTK_WIDGET(term), 1);
-		printf("win_top_left_y = %d, win_bot_right_y = %d\n", term->win_top_left_y, term->win_bot_right_y);
-		// JJS End
-
-		// ORIG: vga_term_dellines(widget, vga_term_wherey(widget), 1);
-
-		x = term->win_top_left_x;
-		y = term->win_bot_right_y;
-		vga_cursor_move(widget, x-1, y-1);
-		if (cursor_vis)
-			vga_cursor_set_visible(widget, TRUE);
-		/* Don't need to update cursor */
-		x = -1;
-		y = -1;
-	}
-	else
-	if (x != -1 && y != -1)
+	if (!status && vga_get_fast_forward(widget) && scr->scroll_lines != 0)
 	{
-		vga_term_gotoxy(widget, x, y);
+		gtk_adjustment_set_value(term->adjustment,
+				term->adjustment->value +
+				scr->scroll_lines * scr->font->height *
+					vga_get_zoom(widget));
+		scr->scroll_lines = 0;
 	}
+
+	vga_set_fast_forward(widget, status);
+}
+
+void vga_term_writec(GtkWidget * widget, guchar c)
+{
+	g_return_if_fail(widget != NULL);
+	g_return_if_fail(VGA_IS_TERM(widget));
+
+	vga_screen_writec(vga_get_screen(widget), c);
+	vga_term_update(widget);
 }
 
 gint vga_term_write(GtkWidget * widget, guchar * s)
 {
-	int i = 0;
-	while (s[i] != '\0')
-		vga_term_writec(widget, s[i++]);
-	return i;
+	int len;
+
+	g_return_val_if_fail(widget != NULL, 0);
+	g_return_val_if_fail(VGA_IS_TERM(widget), 0);
+	g_return_val_if_fail(s != NULL, 0);
+
+	/* Draw once for the whole string rather than once per character */
+	len = strlen((char *) s);
+	vga_screen_write(vga_get_screen(widget), s, len);
+	vga_term_update(widget);
+	return len;
 }
 
 gint vga_term_writeln(GtkWidget * widget, guchar * s)
@@ -373,6 +252,7 @@ int vga_term_print(GtkWidget * widget, const gchar * format, ...)
 {
 	va_list args;
 	gchar * string;
+	int len;
 
 	g_return_val_if_fail(format != NULL, 0);
 
@@ -380,10 +260,10 @@ int vga_term_print(GtkWidget * widget, const gchar * format, ...)
 	string = g_strdup_vprintf(format, args);
 	va_end(args);
 
-	vga_term_write(widget, string);
+	len = vga_term_write(widget, string);
 
 	g_free(string);
-	return strlen(string);
+	return len;
 }
 
 
@@ -403,281 +283,114 @@ guchar vga_term_readkey(GtkWidget * widget)
 
 void vga_term_window(GtkWidget * widget, int x1, int y1, int x2, int y2)
 {
-	VGATerm * term;
-
 	g_return_if_fail(widget != NULL);
 	g_return_if_fail(VGA_IS_TERM(widget));
-	term = VGA_TERM(widget);
 
-	g_assert(x1 > 0 && x1 <= x2);
-	g_assert(y1 > 0 && y1 <= y2);
-	g_assert(x2 <= vga_get_cols(widget));
-	g_assert(y2 <= vga_get_rows(widget));
-			
-	term->win_top_left_x = x1;
-	term->win_top_left_y = y1;
-	term->win_bot_right_x = x2;
-	term->win_bot_right_y = y2;
-
-	vga_term_gotoxy(widget, 1, 1);
+	vga_screen_window(vga_get_screen(widget), x1, y1, x2, y2);
+	vga_term_update(widget);
 }
 
 void vga_term_gotoxy(GtkWidget * widget, int x, int y)
 {
-	VGATerm * term;
-
 	g_return_if_fail(widget != NULL);
 	g_return_if_fail(VGA_IS_TERM(widget));
-	term = VGA_TERM(widget);
 
-	/* Boundary coercions */
-	x = MAX(1, x);
-	y = MAX(1, y);
-	x = MIN(term->win_bot_right_x - term->win_top_left_x + 1, x);
-	y = MIN(term->win_bot_right_y - term->win_top_left_y + 1, y);
-
-	/* Adjust for window offsets */	
-	x += term->win_top_left_x - 1;
-	y += term->win_top_left_y - 1;
-
-	vga_cursor_move(widget, x - 1, y - 1);
+	vga_screen_gotoxy(vga_get_screen(widget), x, y);
+	vga_term_update(widget);
 }
 
 int vga_term_wherex(GtkWidget * widget)
 {
-	VGATerm * term;
-	
 	g_return_val_if_fail(widget != NULL, -1);
 	g_return_val_if_fail(VGA_IS_TERM(widget), -1);
-	term = VGA_TERM(widget);
 
-	return vga_cursor_x(widget) - term->win_top_left_x + 2;
+	return vga_screen_wherex(vga_get_screen(widget));
 }
 
 
 int vga_term_wherey(GtkWidget * widget)
 {
-	VGATerm * term;
-	
 	g_return_val_if_fail(widget != NULL, -1);
 	g_return_val_if_fail(VGA_IS_TERM(widget), -1);
-	term = VGA_TERM(widget);
 
-	return vga_cursor_y(widget) - term->win_top_left_y + 2;
+	return vga_screen_wherey(vga_get_screen(widget));
 }
 
 int vga_term_cols(GtkWidget * widget)
 {
-	VGATerm * term;
-	
 	g_return_val_if_fail(widget != NULL, -1);
 	g_return_val_if_fail(VGA_IS_TERM(widget), -1);
-	term = VGA_TERM(widget);
 
-	return term->win_bot_right_x - term->win_top_left_x + 1;
+	return vga_screen_term_cols(vga_get_screen(widget));
 }
 
 int vga_term_rows(GtkWidget * widget)
 {
-	VGATerm * term;
-	
 	g_return_val_if_fail(widget != NULL, -1);
 	g_return_val_if_fail(VGA_IS_TERM(widget), -1);
-	term = VGA_TERM(widget);
 
-	return term->win_bot_right_y - term->win_top_left_y + 1;
+	return vga_screen_term_rows(vga_get_screen(widget));
 }
 
 void vga_term_clrscr(GtkWidget * widget)
 {
-	VGATerm * term;
-
-	g_return_if_fail(widget != NULL);
-	g_return_if_fail(VGA_IS_TERM(widget));
-	term = VGA_TERM(widget);
-
-	vga_clear_area(widget, SETBG(0x00, GETBG(term->textattr)),
-			term->win_top_left_x - 1,
-			term->win_top_left_y - 1,
-			term->win_bot_right_x - term->win_top_left_x + 1,
-			term->win_bot_right_y - term->win_top_left_y + 1);
-
-	vga_cursor_move(widget, term->win_top_left_x - 1,
-				term->win_top_left_y - 1);
-
-#if 0
-	VGATerm * term;
-	guchar * video_buf;
-	struct { guchar c; guchar attr; } cell;
-	gint16 * cellword;
-	int ofs, rows, cols, win_rows, win_cols, y;
-
 	g_return_if_fail(widget != NULL);
 	g_return_if_fail(VGA_IS_TERM(widget));
-	term = VGA_TERM(widget);
 
-	rows = vga_get_rows(widget);
-	cols = vga_get_cols(widget);
-	
-	vga_cursor_move(widget, 0, 0);  // wrong??
-	
-	video_buf = vga_get_video_buf(widget);
-	cell.c = 0x00;
-	cell.attr = SETBG(0x00, GETBG(term->textattr));
-	cellword = (gint16 *) &cell;
-	win_rows = term->win_bot_right_y - term->win_top_left_y + 1;
-	win_cols = term->win_bot_right_x - term->win_top_left_x + 1;
-	/* Special case optimization */
-	if (win_cols == cols)
-	{
-		ofs = (term->win_top_left_y - 1) * cols * 2;
-		memsetword(video_buf + ofs, *cellword, cols * rows); 
-	}
-	else
-	{
-		for (y = term->win_top_left_y - 1; y < win_rows; y++)
-		{
-			ofs = (y * cols + term->win_top_left_x - 1) * 2;
-			memsetword(video_buf + ofs, *cellword, win_cols);
-		}
-	}
-	vga_refresh_region(widget, term->win_top_left_x, term->win_top_left_y,
-					win_cols, win_rows);
-#endif
+	vga_screen_clrscr(vga_get_screen(widget));
+	vga_term_update(widget);
 }
 
 /* clears down using 0x00 attr, NOT current textattr */
-/* untested */
 void vga_term_clrdown(GtkWidget * widget)
 {
-	VGATerm * term;
-	int y;
-
 	g_return_if_fail(widget != NULL);
 	g_return_if_fail(VGA_IS_TERM(widget));
-	term = VGA_TERM(widget);
 
-	y = vga_cursor_y(widget);
-	vga_clear_area(widget, 0x00,
-			term->win_top_left_x - 1,
-			y,
-			term->win_bot_right_x - term->win_top_left_x + 1,
-			term->win_bot_right_y - y);
+	vga_screen_clrdown(vga_get_screen(widget));
+	vga_term_update(widget);
 }
 
 /* clears up using 0x00 attr, NOT current textattr */
-/* untested */
 void vga_term_clrup(GtkWidget * widget)
 {
-	VGATerm * term;
-	int y;
-
 	g_return_if_fail(widget != NULL);
 	g_return_if_fail(VGA_IS_TERM(widget));
-	term = VGA_TERM(widget);
 
-	y = vga_cursor_y(widget);
-	vga_clear_area(widget, 0x00,
-			term->win_top_left_x - 1,
-			term->win_top_left_y - 1,
-			term->win_bot_right_x - term->win_top_left_x + 1,
-			y + 1);
+	vga_screen_clrup(vga_get_screen(widget));
+	vga_term_update(widget);
 }
 
 void vga_term_clreol(GtkWidget * widget)
 {
-	VGATerm * term;
-
 	g_return_if_fail(widget != NULL);
 	g_return_if_fail(VGA_IS_TERM(widget));
-	term = VGA_TERM(widget);
 
-	vga_clear_area(widget, SETBG(0x00, GETBG(term->textattr)),
-			vga_cursor_x(widget), vga_cursor_y(widget),
-			(term->win_bot_right_x - term->win_top_left_x + 1) -
-				vga_term_wherex(widget) + 1, 1);
-			
-#if 0
-	VGATerm * term;
-	guchar * video_buf;
-	struct { guchar c; guchar attr; } cell;
-	gint16 * cellword;
-	int ofs, cols, win_cols, x, y, clrcols;
-
-	g_return_if_fail(widget != NULL);
-	g_return_if_fail(VGA_IS_TERM(widget));
-	term = VGA_TERM(widget);
-
-	cols = vga_get_cols(widget);  // wrong!?
-	
-	vga_cursor_move(widget, 0, 0);
-	
-	video_buf = vga_get_video_buf(widget);
-	cell.c = 0x00;
-	cell.attr = SETBG(0x00, GETBG(term->textattr));
-	cellword = (gint16 *) &cell;
-	win_cols = term->win_bot_right_x - term->win_top_left_x + 1;
-	x = vga_cursor_x(widget);
-	y = vga_cursor_y(widget);
-	ofs = (y * cols + x) * 2;
-	clrcols = win_cols - vga_term_wherex(widget) + 1;
-	memsetword(video_buf + ofs, *cellword, clrcols);
-	vga_refresh_region(widget, x, vga_cursor_y(widget), clrcols, 1);
-#endif
+	vga_screen_clreol(vga_get_screen(widget));
+	vga_term_update(widget);
 }
 
 void vga_term_scroll_up(GtkWidget * widget, int lines)
 {
-  VGATerm * term;
-  VGAFont *termfont;
-  
-  g_return_if_fail(widget != NULL);
-  g_return_if_fail(VGA_IS_TERM(widget));
-  term = VGA_TERM(widget);
-  
-  term->win_top_left_y  -= lines;
-  term->win_bot_right_y -= lines;
+	g_return_if_fail(widget != NULL);
+	g_return_if_fail(VGA_IS_TERM(widget));
 
-  termfont = vga_get_font(&term->vga);
-  gtk_adjustment_set_value(term->adjustment, term->adjustment->value - termfont->height);
+	vga_screen_scroll_up(vga_get_screen(widget), lines);
+	vga_term_update(widget);
 }
 
 void vga_term_scroll_down(GtkWidget * widget, int lines)
 {
-  VGATerm * term;
-  VGAFont *termfont;
-  int buf_rows;
-
-  g_return_if_fail(widget != NULL);
-  g_return_if_fail(VGA_IS_TERM(widget));
-  term = VGA_TERM(widget);
-  
-  term->win_top_left_y  += lines;
-  term->win_bot_right_y += lines;
-
-  buf_rows = vga_get_rows(widget);
-  if(term->win_bot_right_y > buf_rows)
-  {
-    int diff = term->win_bot_right_y - buf_rows;
-
-    printf("exceeded buffer, diff = %d\n", diff);
-
-    term->win_top_left_y  -= diff;
-    term->win_bot_right_y -= diff;
+	g_return_if_fail(widget != NULL);
+	g_return_if_fail(VGA_IS_TERM(widget));
 
-    vga_term_dellines_absolute(widget, 1, diff);
-  }
-  else
-  {
-    termfont = vga_get_font(&term->vga);
-    gtk_adjustment_set_value(term->adjustment, term->adjustment->value + termfont->height);
-  }
+	vga_screen_scroll_down(vga_get_screen(widget), lines);
+	vga_term_update(widget);
 }
 
 void vga_term_handle_scroll(GtkWidget * widget)
 {
   VGATerm * term;
-  VGAFont *termfont;
   
   g_return_if_fail(widget != NULL);
   g_return_if_fail(VGA_IS_TERM(widget));
@@ -688,43 +401,11 @@ void vga_term_handle_scroll(GtkWidget * widget)
 
 void vga_term_dellines_absolute(GtkWidget * widget, int top_row, int lines)
 {
-	VGATerm * term;
-	guchar * video_buf;
-	int ofs, len, cols, win_cols, rows, y, start_y, end_y;
-	
 	g_return_if_fail(widget != NULL);
 	g_return_if_fail(VGA_IS_TERM(widget));
-	term = VGA_TERM(widget);
 
-	cols = vga_get_cols(widget);
-	rows = vga_get_rows(widget);
-
-	video_buf = vga_get_video_buf(widget);
-	win_cols = term->win_bot_right_x - term->win_top_left_x + 1;
-	start_y = top_row - 1;
-	end_y = rows - lines;
-	
-	/* 
-	 * In the case where the window is as wide as the display, we
-	 * can optimize the shifting by using a single memmove() call
-	 */
-	if (win_cols == cols)
-	{
-	  ofs = start_y * cols * 2;
-	  len = (rows * cols * 2) - ofs;
-	  memmove(video_buf + ofs, video_buf + ofs + cols*2*lines, len);
-	}
-	else
-	{
-
-	}
-	
-	/* Now clear the free'd up lines at the bottom */
-	vga_clear_area(widget, SETBG(0x00, GETBG(term->textattr)),
-			term->win_top_left_x - 1, end_y, win_cols, lines);
-		
-	/* FIXME: Refresh region only */
-	vga_refresh(widget);
+	vga_screen_dellines_absolute(vga_get_screen(widget), top_row, lines);
+	vga_term_update(widget);
 }
 
 /**
@@ -739,64 +420,11 @@ void vga_term_dellines_absolute(GtkWidget * widget, int top_row, int lines)
  */
 void vga_term_dellines(GtkWidget * widget, int top_row, int lines)
 {
-	VGATerm * term;
-	guchar * video_buf;
-	//struct { guchar c; guchar attr; } cell;
-	//gint16 * cellword;
-	int ofs, cols, win_cols, y, start_y, end_y;
-	
 	g_return_if_fail(widget != NULL);
 	g_return_if_fail(VGA_IS_TERM(widget));
-	term = VGA_TERM(widget);
 
-	cols = vga_get_cols(widget);
-	
-	video_buf = vga_get_video_buf(widget);
-	win_cols = term->win_bot_right_x - term->win_top_left_x + 1;
-	// start_y = relative_to_absolute(top_row)
-	start_y = term->win_top_left_y + top_row - 2;
-	end_y = term->win_bot_right_y - lines;
-	
-	/* 
-	 * In the case where the window is as wide as the display, we
-	 * can optimize the shifting by using a single memmove() call
-	 */
-	if (win_cols == cols)
-	{
-		ofs = start_y * cols * 2;
-		memmove(video_buf + ofs, video_buf + ofs + cols*2*lines,
-				cols*2*(term->win_bot_right_y - lines));
-	}
-	else
-	{
-		for (y = start_y; y < end_y; y++)
-		{
-			/* Source is line below y at column of window start */
-			ofs = (y*cols + term->win_top_left_x - 1) * 2;
-			/* Shift line up */
-			memmove(video_buf + ofs, video_buf + ofs + cols*2,
-					win_cols*2);
-		}
-	}
-	
-	/* Now clear the free'd up lines at the bottom */
-	vga_clear_area(widget, SETBG(0x00, GETBG(term->textattr)),
-			term->win_top_left_x - 1, end_y, win_cols, lines);
-		
-/*	
-	cell.c = 0x00;
-	cell.attr = SETBG(0x00, GETBG(term->textattr));
-	cellword = (gint16 *) &cell;
-	ofs = (end_y*cols + term->win_top_left_x-1) * 2;
-	for (y = 0; y < lines; y++)
-	{
-		memsetword(video_buf + ofs, *cellword, win_cols);
-		ofs += (2*cols);
-	}
-	*/
-
-	/* FIXME: Refresh region only */
-	vga_refresh(widget);
+	vga_screen_dellines(vga_get_screen(widget), top_row, lines);
+	vga_term_update(widget);
 }
 
 /**
@@ -809,108 +437,41 @@ void vga_term_dellines(GtkWidget * widget, int top_row, int lines)
  **/
 void vga_term_inslines(GtkWidget * widget, int top_row, int lines)
 {
-	VGATerm * term;
-	guchar * video_buf;
-	//struct { guchar c; guchar attr; } cell;
-	//gint16 * cellword;
-	int ofs, cols, win_cols, y, start_y;
-	
 	g_return_if_fail(widget != NULL);
 	g_return_if_fail(VGA_IS_TERM(widget));
-	term = VGA_TERM(widget);
 
-	cols = vga_get_cols(widget);
-	
-	video_buf = vga_get_video_buf(widget);
-	win_cols = term->win_bot_right_x - term->win_top_left_x + 1;
-	// start_y = relative_to_absolute(top_row)
-	start_y = term->win_top_left_y + top_row - 2;
-
-	/* 
-	 * In the case where the window is as wide as the display, we
-	 * can optimize the shifting by using a single memmove() call
-	 */
-	if (win_cols == cols)
-	{
-		ofs = start_y * cols * 2;
-		memmove(video_buf + ofs + cols*2*lines, video_buf + ofs,
-				cols*2*(term->win_bot_right_y - start_y - 1));
-	}
-	else
-	{
-		/* Start from the bottom */
-		for (y = term->win_bot_right_y - 1; y > start_y; y--)
-		{
-			/* Source is line above y at column of window start */
-			ofs = ((y-1)*cols + term->win_top_left_x - 1) * 2;
-			/* Shift line down */
-			memmove(video_buf + ofs + win_cols*2, video_buf + ofs,
-					win_cols*2);
-		}
-	}
-	
-	/* Now clear the gap lines */
-	vga_clear_area(widget, SETBG(0x00, GETBG(term->textattr)),
-		term->win_top_left_x - 1, start_y, win_cols, lines);
-			
-#if 0	
-	cell.c = 0x00;
-	cell.attr = SETBG(0x00, GETBG(term->textattr));
-	cellword = (gint16 *) &cell;
-	ofs = (start_y * cols + term->win_top_left_x - 1) * 2;
-	for (y = 0; y < lines; y++)
-	{
-		memsetword(video_buf + ofs, *cellword, win_cols);
-		ofs += (2*cols);
-	}
-#endif
-
-	/* FIXME: Refresh region only */
-	vga_refresh(widget);
+	vga_screen_inslines(vga_get_screen(widget), top_row, lines);
+	vga_term_update(widget);
 }
 
 void vga_term_set_attr(GtkWidget * widget, guchar textattr)
 {
-	VGATerm * term;
-	
 	g_return_if_fail(widget != NULL);
 	g_return_if_fail(VGA_IS_TERM(widget));
-	term = VGA_TERM(widget);
 
-	term->textattr = textattr;
+	vga_screen_set_attr(vga_get_screen(widget), textattr);
 }
 
 guchar vga_term_get_attr(GtkWidget * widget)
 {
-	VGATerm * term;
-	
 	g_assert(widget != NULL);
 	g_assert(VGA_IS_TERM(widget));
-	term = VGA_TERM(widget);
 
-	return term->textattr;
+	return vga_screen_get_attr(vga_get_screen(widget));
 }
 
 void vga_term_set_fg(GtkWidget * widget, guchar fg)
 {
-	VGATerm * term;
-	
 	g_return_if_fail(widget != NULL);
 	g_return_if_fail(VGA_IS_TERM(widget));
-	term = VGA_TERM(widget);
 
-	if (fg > 15)
-		fg = (fg & 0x0F) | 0x80;
-	term->textattr = (term->textattr & 0x70) | fg;
+	vga_screen_set_fg(vga_get_screen(widget), fg);
 }
 
 void vga_term_set_bg(GtkWidget * widget, guchar bg)
 {
-	VGATerm * term;
-	
 	g_return_if_fail(widget != NULL);
 	g_return_if_fail(VGA_IS_TERM(widget));
-	term = VGA_TERM(widget);
 
-	term->textattr = (term->textattr & 0x8F) | ((bg & 0x07) << 4);
+	vga_screen_set_bg(vga_get_screen(widget), bg);
 }
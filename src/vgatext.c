@@ -44,33 +44,28 @@
  */
 
 #include "vgatext.h"
+#include "vgabackend.h"
 
 /* FIXME: temp before release */
 #ifdef ENABLE_DEBUG
 #define VGA_DEBUG
 #endif
 
-#define PIXEL_TO_COL(x, vgafont)	(x / vgafont->width)
-#define PIXEL_TO_ROW(y, vgafont)	(y / vgafont->height)
+/* Character cell size on screen, in pixels */
+#define CELL_WIDTH(vga)		((vga)->pvt->screen->font->width * (vga)->pvt->zoom)
+#define CELL_HEIGHT(vga)	((vga)->pvt->screen->font->height * (vga)->pvt->zoom)
+
+#define PIXEL_TO_COL(x, vga)	((x) / CELL_WIDTH(vga))
+#define PIXEL_TO_ROW(y, vga)	((y) / CELL_HEIGHT(vga))
 
 #define CURSOR_BLINK_PERIOD_MS	229
 #define BLINK_PERIOD_MS		498
-
-
-typedef struct _VGAScreen VGAScreen;
+#define MAX_BITMAP_SIZE		32767	/* Largest X drawable, each way */
 
 /* Widget private data */
 struct _VGATextPrivate {
 	/* int keypad? */
-	int rows;
-	int cols;
-	vga_charcell * video_buf;
-	VGAFont * font;
-	VGAPalette * pal;
-	gboolean icecolor;
-	gboolean cursor_visible;
-	int cursor_x;		/* 0-based */
-	int cursor_y;
+	VGAScreen * screen;	/* What we display */
 
 	GdkBitmap * glyphs;
 	GdkGC * gc;
@@ -81,16 +76,16 @@ struct _VGATextPrivate {
 
 	gboolean blink_state;
 	guint blink_timeout_id;	/* -1 when no blinking chars on screen */
-};
-
-/* These are the palette registers for the standard EGA colors */
-/* FIXME: Should this detail go in the palette class? */
-static int pal_map[16] = {0,1,2,3,4,5,20,7,56,57,58,59,60,61,62,63};
 
+	gboolean fast_forward;	/* Draw nothing, keep the damage */
+	int zoom;		/* Pixels per font pixel, each way */
+	int zoom_wanted;	/* What was asked for; zoom may be less */
+	gboolean deferred;	/* Invalidate damage rather than draw it */
 
-/* Local Prototypes */
-static void vga_alloc_videobuf(VGAText *vga);
-
+	VGARenderer renderer;		/* What was asked for */
+	const VGABackend * backend;	/* NULL for the GC fills */
+	gpointer backend_data;
+};
 
 
 
@@ -104,26 +99,12 @@ GtkWidget * vga_text_new(gint rows, gint cols)
 
 	vga = g_object_new(vga_get_type(), NULL);
 
-	vga->pvt->rows = rows;
-	vga->pvt->cols = cols;
-	
-	vga_alloc_videobuf(vga);
+	vga_screen_resize(vga->pvt->screen, rows, cols);
+	vga_screen_clear_damage(vga->pvt->screen);
 
 	return GTK_WIDGET(vga);
 }
 
-static void
-vga_alloc_videobuf(VGAText *vga)
-{
-  if(vga->pvt->video_buf != NULL)
-  {
-    g_free(vga->pvt->video_buf);
-  }
-  
-  vga->pvt->video_buf = g_malloc0(sizeof(vga_charcell) * vga->pvt->rows * vga->pvt->cols);
-
-}
-
 static void
 vga_invalidate_cells(VGAText * vga, glong col_start, gint col_count,
 			glong row_start, gint row_count)
@@ -133,15 +114,15 @@ vga_invalidate_cells(VGAText * vga, glong col_start, gint col_count,
 	
 	g_return_if_fail(VGA_IS_VGATEXT(vga));
 	widget = GTK_WIDGET(vga);
-	if (!GTK_WIDGET_REALIZED(widget))
+	if (!GTK_WIDGET_REALIZED(widget) || vga->pvt->fast_forward)
 		return;
 
 	/* Convert the col/row start and end to pixel values by multiplying
 	 * by the size of a character cell. */
-	rect.x = col_start * vga->pvt->font->width;
-	rect.width = col_count * vga->pvt->font->width;
-	rect.y = row_start * vga->pvt->font->height;
-	rect.height = row_count * vga->pvt->font->height;
+	rect.x = col_start * CELL_WIDTH(vga);
+	rect.width = col_count * CELL_WIDTH(vga);
+	rect.y = row_start * CELL_HEIGHT(vga);
+	rect.height = row_count * CELL_HEIGHT(vga);
 
 	gdk_window_invalidate_rect(widget->window, &rect, TRUE);
 }
@@ -149,7 +130,7 @@ vga_invalidate_cells(VGAText * vga, glong col_start, gint col_count,
 static void
 vga_invalidate_all(VGAText * vga)
 {
-	vga_invalidate_cells(vga, 0, vga->pvt->cols, 0, vga->pvt->rows);
+	vga_invalidate_cells(vga, 0, vga->pvt->screen->cols, 0, vga->pvt->screen->rows);
 }
 
 /* Scroll a rectangular region up or down by a fixed number of lines. */
@@ -164,17 +145,17 @@ vga_scroll_region(VGAText *vga,
 		return;
 
 	/* We only do this if we're scrolling the entire window. */
-	if (row == 0 && count == vga->pvt->rows)
+	if (row == 0 && count == vga->pvt->screen->rows)
 	{
 		widget = GTK_WIDGET(vga);
-		gdk_window_scroll(widget->window, 0, delta * vga->pvt->font->height);
+		gdk_window_scroll(widget->window, 0, delta * CELL_HEIGHT(vga));
 		repaint = FALSE;
 	}
 
 	if (repaint)
 	{
 		/* We have to repaint the entire area. */
-		vga_invalidate_cells(vga, 0, vga->pvt->cols, row, count);
+		vga_invalidate_cells(vga, 0, vga->pvt->screen->cols, row, count);
 	}
 }
 
@@ -219,6 +200,75 @@ vga_emit_move_window(VGAText * vga)
 	g_signal_emit_by_name(vga, "move-window");
 }
 
+/* The backend for a renderer, or NULL for the GC fills */
+static const VGABackend *
+vga_renderer_backend(VGARenderer renderer)
+{
+	switch (renderer)
+	{
+		case VGA_RENDERER_XRENDER:
+			return &vga_xrender_backend;
+		case VGA_RENDERER_XSHM:
+			return &vga_xshm_backend;
+		default:
+			return NULL;
+	}
+}
+
+/* Set up the renderer asked for, falling back to the GC fills */
+static void
+vga_backend_start(VGAText * vga)
+{
+	const VGABackend * backend;
+
+	backend = vga_renderer_backend(vga->pvt->renderer);
+	if (backend == NULL)
+		return;
+
+	vga->pvt->backend_data = backend->new(GTK_WIDGET(vga));
+	if (vga->pvt->backend_data != NULL)
+		vga->pvt->backend = backend;
+}
+
+static void
+vga_backend_stop(VGAText * vga)
+{
+	if (vga->pvt->backend == NULL)
+		return;
+
+	vga->pvt->backend->destroy(vga->pvt->backend_data);
+	vga->pvt->backend = NULL;
+	vga->pvt->backend_data = NULL;
+}
+
+/*
+ * vga_fit_zoom:
+ * @vga: VGAText structure pointer
+ *
+ * Zoom as far toward the zoom asked for as the font allows: the glyph
+ * bitmap is 256 glyphs high and X drawables can't be more than 32767
+ * pixels high.  The widget is resized and redrawn if the zoom changes.
+ *
+ * Returns: TRUE if the zoom changed
+ */
+static gboolean
+vga_fit_zoom(VGAText * vga)
+{
+	int zoom;
+
+	zoom = vga->pvt->zoom_wanted;
+	while (zoom > 1 &&
+		vga->pvt->screen->font->height * zoom * 256 > MAX_BITMAP_SIZE)
+		zoom--;
+	if (zoom == vga->pvt->zoom)
+		return FALSE;
+
+	vga->pvt->zoom = zoom;
+	gtk_widget_queue_resize(GTK_WIDGET(vga));
+	vga_invalidate_all(vga);
+	return TRUE;
+}
+
 static void
 vga_realize(GtkWidget * widget)
 {
@@ -277,18 +327,21 @@ vga_realize(GtkWidget * widget)
 	/* Initialize private data that depends on the window */
 	if (vga->pvt->gc == NULL)
 	{
-		vga->pvt->glyphs = vga_font_get_bitmap(vga->pvt->font,
-				widget->window);
+		vga_fit_zoom(vga);
+		vga->pvt->glyphs = vga_font_get_scaled_bitmap(
+				vga->pvt->screen->font, widget->window,
+				vga->pvt->zoom);
 		vga->pvt->gc = gdk_gc_new(widget->window);
 		// not needed i guess?
 		//gdk_gc_set_colormap(vga->pvt->gc, attributes.colormap);
 		gdk_gc_set_rgb_fg_color(vga->pvt->gc,
-			&vga->pvt->pal->color[pal_map[vga->pvt->fg]]);
+			&vga->pvt->screen->pal->color[vga_palette_text_regs[vga->pvt->fg]]);
 		gdk_gc_set_rgb_bg_color(vga->pvt->gc,
-			&vga->pvt->pal->color[pal_map[vga->pvt->bg]]);
+			&vga->pvt->screen->pal->color[vga_palette_text_regs[vga->pvt->bg]]);
 		gdk_gc_set_stipple(vga->pvt->gc, vga->pvt->glyphs);
 		gdk_gc_set_fill(vga->pvt->gc, GDK_OPAQUE_STIPPLED);
 	}
+	vga_backend_start(vga);
 
 	/* create a gdk window?  is that what we really want? */
 	gtk_widget_grab_focus(widget);
@@ -309,15 +362,17 @@ vga_unrealize(GtkWidget * widget)
 	vga = VGA_TEXT(widget);
 
 	/* this is now in finalize() */
-	//vga_font_destroy(vga->pvt->font);
-	//vga_palette_destroy(vga->pvt->pal);
-	//g_free(vga->pvt->video_buf);
+	//vga_font_destroy(vga->pvt->screen->font);
+	//vga_palette_destroy(vga->pvt->screen->pal);
+	//g_free(vga->pvt->screen->video_buf);
 
 	if (GTK_WIDGET_MAPPED(widget))
 	{
 		gtk_widget_unmap(widget);
 	}
 
+	vga_backend_stop(vga);
+
 	/* Remove the GDK Window */
 	if (widget->window != NULL)
 	{
@@ -331,14 +386,18 @@ vga_unrealize(GtkWidget * widget)
 
 
 static void
-vga_paint_cursor(GtkWidget * widget, VGAFont * font, gboolean state,
-			int x, int y)
+vga_paint_cursor(GtkWidget * widget, gboolean state, int x, int y)
 {
+	VGAText * vga = VGA_TEXT(widget);
+
+	if (vga->pvt->fast_forward)
+		return;
+
 	gdk_draw_rectangle(widget->window,
 		state ? widget->style->white_gc : widget->style->black_gc,
 		TRUE,	/* filled */
 		x, y,
-		font->width, font->height / 8);
+		CELL_WIDTH(vga), CELL_HEIGHT(vga) / 8);
 }
 
 
@@ -351,18 +410,19 @@ vga_blink_cursor(gpointer data)
 		return TRUE;
 	
 	vga = VGA_TEXT(data);
+	if (vga->pvt->fast_forward)
+		return TRUE;
 
 	/* Don't do anything if we're already how we want it */
-	if (!vga->pvt->cursor_visible && !vga->pvt->cursor_blink_state)
+	if (!vga->pvt->screen->cursor_visible && !vga->pvt->cursor_blink_state)
 		return TRUE;
 	
 	vga->pvt->cursor_blink_state = !vga->pvt->cursor_blink_state;
-	vga_paint_cursor(GTK_WIDGET(data), vga->pvt->font,
-				vga->pvt->cursor_blink_state,
-				vga->pvt->cursor_x * vga->pvt->font->width,
-				(vga->pvt->cursor_y + 1) *
-					vga->pvt->font->height -
-					(vga->pvt->font->height / 8) );
+	vga_paint_cursor(GTK_WIDGET(data), vga->pvt->cursor_blink_state,
+				vga->pvt->screen->cursor_x * CELL_WIDTH(vga),
+				(vga->pvt->screen->cursor_y + 1) *
+					CELL_HEIGHT(vga) -
+					(CELL_HEIGHT(vga) / 8) );
 
 	return TRUE;
 
@@ -389,25 +449,25 @@ vga_blink_char(gpointer data)
 
 	vga = VGA_TEXT(data);
 	
-	if (vga->pvt->icecolor)
+	if (vga->pvt->screen->icecolor || vga->pvt->fast_forward)
 		return TRUE;
 	
 	vga->pvt->blink_state = !vga->pvt->blink_state;
 
-	for (y = 0; y < vga->pvt->rows; y++)
+	for (y = 0; y < vga->pvt->screen->rows; y++)
 	{
-		for (x = 0; x < vga->pvt->cols; x++)
+		for (x = 0; x < vga->pvt->screen->cols; x++)
 		{
 			/* 
 			 * If you encounter a blink bit, refresh it
 			 * and the rest of the line, then move on to the
 			 * next line
 			 */
-			if (GETBLINK(vga->pvt->video_buf[y*vga->pvt->cols + x].attr))
+			if (GETBLINK(vga->pvt->screen->video_buf[y*vga->pvt->screen->cols + x].attr))
 			{
 				g_print("blink bit encountered on line %d\n", y);
 				vga_refresh_region(widget, x, y,
-							vga->pvt->cols - x,
+							vga->pvt->screen->cols - x,
 							1);
 				break;
 			}
@@ -426,19 +486,20 @@ void vga_start_blink_timer(VGAText * vga)
 }
 
 /*
- * vga_set_textattr:
- * @vga: VGAtext object
+ * vga_text_attr_colors:
+ * @widget: VGAText widget
  * @textattr: VGA text attribute byte
+ * @fg: Returns the foreground color, 0-15
+ * @bg: Returns the background color, 0-15
  *
- * Set the VGAText's graphics context to use the text attribute given using
- * the current VGA palette.  May not actually result in a call to the
- * graphics server, since redundant calls may be optimized out.
+ * Work out the colors a cell is drawn in at the moment.
  */
-static void
-vga_set_textattr(VGAText * vga, guchar textattr)
+void
+vga_text_attr_colors(GtkWidget * widget, guchar textattr, guchar * fg,
+		guchar * bg)
 {
-	guchar fg, bg;
-	
+	VGAText * vga = VGA_TEXT(widget);
+
 	/* 
 	 * Blink logic for text attributes
 	 * -----------------------------------
@@ -450,41 +511,58 @@ vga_set_textattr(VGAText * vga, guchar textattr)
 	 */ 
 	if (!GETBLINK(textattr))
 	{
-		fg = GETFG(textattr);
-		bg = GETBG(textattr);
+		*fg = GETFG(textattr);
+		*bg = GETBG(textattr);
 	}
-	else if (vga->pvt->icecolor)
+	else if (vga->pvt->screen->icecolor)
 	{	/* High intensity background / iCEColor */
-		fg = GETFG(textattr);
-		bg = BRIGHT(GETBG(textattr));
+		*fg = GETFG(textattr);
+		*bg = BRIGHT(GETBG(textattr));
 	}
 	else if (vga->pvt->blink_state)
 	{	/* Blinking, but in on state so it appears normal */
-		fg = GETFG(textattr);
-		bg = GETBG(textattr);
+		*fg = GETFG(textattr);
+		*bg = GETBG(textattr);
 
 		if (vga->pvt->blink_timeout_id == -1)
 			vga_start_blink_timer(vga);
 	}
 	else
 	{	/* Hide, blink off state */
-		fg = GETBG(textattr);
-		bg = GETBG(textattr);
+		*fg = GETBG(textattr);
+		*bg = GETBG(textattr);
 
 		if (vga->pvt->blink_timeout_id == -1)
 			vga_start_blink_timer(vga);
 	}
+}
+
+/*
+ * vga_set_textattr:
+ * @vga: VGAtext object
+ * @textattr: VGA text attribute byte
+ *
+ * Set the VGAText's graphics context to use the text attribute given using
+ * the current VGA palette.  May not actually result in a call to the
+ * graphics server, since redundant calls may be optimized out.
+ */
+static void
+vga_set_textattr(VGAText * vga, guchar textattr)
+{
+	guchar fg, bg;
+
+	vga_text_attr_colors(GTK_WIDGET(vga), textattr, &fg, &bg);
 
 	if (vga->pvt->fg != fg)
 	{
 		gdk_gc_set_rgb_fg_color(vga->pvt->gc,
-			&vga->pvt->pal->color[pal_map[fg]]);
+			&vga->pvt->screen->pal->color[vga_palette_text_regs[fg]]);
 		vga->pvt->fg = fg;
 	}
 	if (vga->pvt->bg != bg)
 	{
 		gdk_gc_set_rgb_bg_color(vga->pvt->gc,
-			&vga->pvt->pal->color[pal_map[bg]]);
+			&vga->pvt->screen->pal->color[vga_palette_text_regs[bg]]);
 		vga->pvt->bg = bg;
 	}
 }
@@ -496,9 +574,9 @@ vga_paint_charcell(GtkWidget * da, VGAText * vga,
 				vga_charcell cell, int x, int y)
 {
 	vga_set_textattr(vga, cell.attr);
-	gdk_gc_set_ts_origin(vga->pvt->gc, x, y-(16 * cell.c));
+	gdk_gc_set_ts_origin(vga->pvt->gc, x, y-(CELL_HEIGHT(vga) * cell.c));
 	gdk_draw_rectangle(da->window, vga->pvt->gc, TRUE, x, y,
-				vga->pvt->font->width, vga->pvt->font->height);
+				CELL_WIDTH(vga), CELL_HEIGHT(vga));
 }
 
 
@@ -515,18 +593,28 @@ vga_refresh_area(GtkWidget * da, VGAText * vga, GdkRectangle * area)
 	int char_x, char_y, x_drawn, y_drawn, row, col, columns;
 	x2 = area->x + area->width;	/* Last column in area + 1 */
 	y2 = area->y + area->height;	/* Last row in area + 1 */
-	x2 = MIN(x2, vga->pvt->font->width * vga->pvt->cols);
-	y2 = MIN(y2, vga->pvt->font->height * vga->pvt->rows);
+	x2 = MIN(x2, CELL_WIDTH(vga) * vga->pvt->screen->cols);
+	y2 = MIN(y2, CELL_HEIGHT(vga) * vga->pvt->screen->rows);
 	y = area->y;
 	vga_charcell * cell;
 
-	columns = vga->pvt->cols;
+	/* Everything is repainted when fast-forwarding stops */
+	if (vga->pvt->fast_forward)
+		return;
+
+	if (vga->pvt->backend)
+	{
+		vga->pvt->backend->draw(vga->pvt->backend_data, da, area);
+		return;
+	}
+
+	columns = vga->pvt->screen->cols;
 
 	while (y < y2)
 	{
-		row = PIXEL_TO_ROW(y, vga->pvt->font);
-		char_y = row * vga->pvt->font->height;
-		y_drawn = (char_y + vga->pvt->font->height) - y;
+		row = PIXEL_TO_ROW(y, vga);
+		char_y = row * CELL_HEIGHT(vga);
+		y_drawn = (char_y + CELL_HEIGHT(vga)) - y;
 
 		x = area->x;
 		while (x < x2)
@@ -541,15 +629,15 @@ vga_refresh_area(GtkWidget * da, VGAText * vga, GdkRectangle * area)
 		 * x_drawn : number of columns to draw of character
 		 * y_drawn : number of rows to draw of character
 		 */
-			col = PIXEL_TO_COL(x, vga->pvt->font);
-			char_x = col * vga->pvt->font->width;
-			x_drawn = (char_x + vga->pvt->font->width) - x;
+			col = PIXEL_TO_COL(x, vga);
+			char_x = col * CELL_WIDTH(vga);
+			x_drawn = (char_x + CELL_WIDTH(vga)) - x;
 		
-			cell = &(vga->pvt->video_buf[row * columns + col]);
+			cell = &(vga->pvt->screen->video_buf[row * columns + col]);
 		
 			vga_set_textattr(vga, cell->attr);
 			gdk_gc_set_ts_origin(vga->pvt->gc, char_x,
-					char_y-(vga->pvt->font->height * cell->c));
+					char_y-(CELL_HEIGHT(vga) * cell->c));
 			gdk_draw_rectangle(da->window, vga->pvt->gc, TRUE, x, y,
 					x_drawn, y_drawn);
 
@@ -590,14 +678,14 @@ vga_paint(GtkWidget * widget, GdkRectangle * area)
 	 *
 	 */
 #if 0
-	row_start = area->y / vga->pvt->font->height; /* verified */
+	row_start = area->y / CELL_HEIGHT(vga); /* verified */
 	
-	num_rows = area->height / vga->pvt->font->height + 1;
-	row_stop = MIN(row_start + num_rows, vga->pvt->rows);
+	num_rows = area->height / CELL_HEIGHT(vga) + 1;
+	row_stop = MIN(row_start + num_rows, vga->pvt->screen->rows);
 	
-	num_cols = area->width / vga->pvt->font->width + 1;
-	col_start = area->x / vga->pvt->font->width;
-	col_stop = MIN(col_start + num_cols, vga->pvt->cols);
+	num_cols = area->width / CELL_WIDTH(vga) + 1;
+	col_start = area->x / CELL_WIDTH(vga);
+	col_stop = MIN(col_start + num_cols, vga->pvt->screen->cols);
 #ifdef VGA_DEBUG
 	fprintf(stderr, "area->y = %d, area->height = %d\n", area->y, area->height);
 	fprintf(stderr, "area->x = %d, area->width = %d\n", area->x, area->width);
@@ -611,14 +699,82 @@ vga_paint(GtkWidget * widget, GdkRectangle * area)
 		for (x = col_start; x < col_stop; x++)
 		{
 			vga_paint_charcell(widget, vga,
-					vga->pvt->video_buf[y*80+x],
-					x*vga->pvt->font->width,
-					y*vga->pvt->font->height);
+					vga->pvt->screen->video_buf[y*80+x],
+					x*CELL_WIDTH(vga),
+					y*CELL_HEIGHT(vga));
 		}
 #endif
 	
 }
 
+/*
+ * vga_paint_region:
+ * @widget: VGAText widget
+ * @region: Exposed part of the window
+ *
+ * Paint the cells @region touches and no others.  Its rectangles are
+ * snapped to whole cells, and the cells of each row painted as spans, so
+ * two small exposes at opposite corners don't repaint everything between
+ * them the way their bounding box would.
+ */
+static void
+vga_paint_region(GtkWidget * widget, GdkRegion * region)
+{
+	VGAText * vga = VGA_TEXT(widget);
+	GdkRectangle * rects, box, span;
+	guchar * cells, * p;
+	int n, i, row0, row1, col0, col1, cols, row, col, c0, c1, end;
+
+	gdk_region_get_clipbox(region, &box);
+	col0 = PIXEL_TO_COL(box.x, vga);
+	row0 = PIXEL_TO_ROW(box.y, vga);
+	col1 = MIN(PIXEL_TO_COL(box.x + box.width - 1, vga) + 1,
+			vga->pvt->screen->cols);
+	row1 = MIN(PIXEL_TO_ROW(box.y + box.height - 1, vga) + 1,
+			vga->pvt->screen->rows);
+	if (box.width <= 0 || box.height <= 0 || col0 >= col1 || row0 >= row1)
+		return;
+
+	/* Mark the cells each rectangle touches */
+	cols = col1 - col0;
+	cells = g_malloc0(cols * (row1 - row0));
+	gdk_region_get_rectangles(region, &rects, &n);
+	for (i = 0; i < n; i++)
+	{
+		c0 = PIXEL_TO_COL(rects[i].x, vga) - col0;
+		c1 = MIN(PIXEL_TO_COL(rects[i].x + rects[i].width - 1, vga) + 1,
+				col1) - col0;
+		if (c0 >= c1)
+			continue;	/* Right of the text */
+		end = MIN(PIXEL_TO_ROW(rects[i].y + rects[i].height - 1, vga)
+				+ 1, row1);
+		for (row = PIXEL_TO_ROW(rects[i].y, vga); row < end; row++)
+			memset(cells + (row - row0) * cols + c0, 1, c1 - c0);
+	}
+	g_free(rects);
+
+	/* Paint each row's runs of marked cells */
+	span.y = row0 * CELL_HEIGHT(vga);
+	span.height = CELL_HEIGHT(vga);
+	for (row = row0; row < row1; row++, span.y += span.height)
+	{
+		p = cells + (row - row0) * cols;
+		for (col = 0; col < cols; col++)
+		{
+			if (!p[col])
+				continue;
+			for (end = col; end < cols && p[end]; end++)
+				;
+			span.x = (col0 + col) * CELL_WIDTH(vga);
+			span.width = (end - col) * CELL_WIDTH(vga);
+			vga_paint(widget, &span);
+			col = end;
+		}
+	}
+
+	g_free(cells);
+}
+
 static gint
 vga_expose(GtkWidget * widget, GdkEventExpose * event)
 {
@@ -628,7 +784,7 @@ vga_expose(GtkWidget * widget, GdkEventExpose * event)
 	g_return_val_if_fail(VGA_IS_TEXT(widget), 0);
 	if (event->window == widget->window)
 	{
-		vga_paint(widget, &event->area);
+		vga_paint_region(widget, event->region);
 	}
 	else
 		g_assert_not_reached();
@@ -652,13 +808,8 @@ vga_finalize(GObject * object)
 	widget_class = g_type_class_peek(GTK_TYPE_WIDGET);
 
 
-	/* Destroy its font object */
-	vga_font_destroy(vga->pvt->font);
-
-	/* Destroy palette */
-	vga_palette_destroy(vga->pvt->pal);
-
-	g_free(vga->pvt->video_buf);
+	/* Destroy the screen, along with its font and palette */
+	vga_screen_destroy(vga->pvt->screen);
 
 	/* Remove the blink timeout functions */
 	if (vga->pvt->cursor_timeout_id != -1)
@@ -712,8 +863,8 @@ vga_size_request(GtkWidget * widget, GtkRequisition *req)
 	g_return_if_fail(VGA_IS_TEXT(widget));
 	vga = VGA_TEXT(widget);
 
-	req->width = vga->pvt->font->width * vga->pvt->cols;
-	req->height = vga->pvt->font->height * vga->pvt->rows;
+	req->width = CELL_WIDTH(vga) * vga->pvt->screen->cols;
+	req->height = CELL_HEIGHT(vga) * vga->pvt->screen->rows;
 
 #ifdef VGA_DEBUG
 	fprintf(stderr, "Size request is %dx%d.\n",
@@ -732,8 +883,8 @@ vga_size_allocate(GtkWidget *widget, GtkAllocation *allocation)
 	g_return_if_fail(VGA_IS_TEXT(widget));
 	vga = VGA_TEXT(widget);
 
-	width = allocation->width / vga->pvt->font->width;
-	height = allocation->height / vga->pvt->font->height;
+	width = allocation->width / CELL_WIDTH(vga);
+	height = allocation->height / CELL_HEIGHT(vga);
 
 #ifdef VGA_DEBUG
 	fprintf(stderr, "Sizing window to %dx%d (%ldx%ld).\n",
@@ -826,39 +977,33 @@ vga_init(VGAText * vga, gpointer *klass)
 
 	/* Initialize private data */
 	pvt = vga->pvt = g_malloc0(sizeof(*vga->pvt));
-	pvt->font = vga_font_new();
-	vga_font_load_default(pvt->font);
-	//vga_font_load_from_file(pvt->font, "dump.fnt");
 
-	pvt->pal = vga_palette_dup(vga_palette_stock(PAL_DEFAULT));
+	/* The screen starts with the default font and palette */
+	pvt->screen = vga_screen_new(25, 80);
+	//vga_font_load_from_file(pvt->screen->font, "dump.fnt");
 
-	//vga_palette_load_default(pvt->pal);
-	/*if (vga_palette_load_from_file(pvt->pal, "dos.pal"))
+	//vga_palette_load_default(pvt->screen->pal);
+	/*if (vga_palette_load_from_file(pvt->screen->pal, "dos.pal"))
 		g_message("Loaded palette file successfully");
 	else
 	{
 		g_message("Failed to load palette file, falling back to default"); */
 	/*}*/
 			
-	pvt->rows = 25;
-	pvt->cols = 80;
-
 	pvt->fg = 0x07;
 	pvt->bg = 0x00;
-
-	pvt->cursor_visible = TRUE;
+	pvt->zoom = 1;
+	pvt->zoom_wanted = 1;
 
 	/* These are initialized if needed in vga_realize() for now */
 	pvt->glyphs = NULL;
 	pvt->gc = NULL;
 
-	vga_alloc_videobuf(vga);
-
 	/*
-	pvt->video_buf[0].c = '!';
-	pvt->video_buf[0].attr = 0x09;
-	pvt->video_buf[100].c = '@';
-	pvt->video_buf[100].attr = 0x2A; */
+	pvt->screen->video_buf[0].c = '!';
+	pvt->screen->video_buf[0].attr = 0x09;
+	pvt->screen->video_buf[100].c = '@';
+	pvt->screen->video_buf[100].attr = 0x2A; */
 
 	/* Add our cursor timeout event to make it blink */
 	/* 229 ms is about how often the cursor blink is toggled in DOS */
@@ -870,8 +1015,6 @@ vga_init(VGAText * vga, gpointer *klass)
 
 	pvt->blink_state = TRUE;
 	pvt->cursor_blink_state = TRUE;
-	pvt->icecolor = TRUE;
-
 }
 
 GtkType
@@ -921,7 +1064,7 @@ vga_get_palette(GtkWidget * widget)
 	g_return_val_if_fail(VGA_IS_TEXT(widget), NULL);
 	vga = VGA_TEXT(widget);
 
-	return vga->pvt->pal;
+	return vga->pvt->screen->pal;
 }
 
 
@@ -934,7 +1077,7 @@ vga_get_font(GtkWidget * widget)
 	g_return_val_if_fail(VGA_IS_TEXT(widget), NULL);
 	vga = VGA_TEXT(widget);
 
-	return vga->pvt->font;
+	return vga->pvt->screen->font;
 }
 
 /* Override the default VGA palette */
@@ -945,18 +1088,24 @@ vga_set_palette(GtkWidget * widget, VGAPalette * palette)
 
 	g_return_if_fail(widget != NULL);
 	g_return_if_fail(VGA_IS_TEXT(widget));
+	g_return_if_fail(palette != NULL);
 	vga = VGA_TEXT(widget);
 
-	/* FIXME: Poor error checking */
-	vga_palette_destroy(vga->pvt->pal);
-	vga->pvt->pal = palette;
+	if (vga->pvt->screen->pal != palette)
+	{
+		vga_palette_destroy(vga->pvt->screen->pal);
+		vga->pvt->screen->pal = palette;
+	}
 
-	vga_refresh(widget);
+	vga_screen_palette_changed(vga->pvt->screen);
+	vga_update(widget);
 }
 
 
 /* Re-render the internal font data so that changes will be reflected on
- * the next display refresh. */
+ * the next display refresh.  Only glyphs changed with vga_font_set_chars()
+ * are drawn again; the stipple is set again either way, since the X server
+ * may have copied the old bitmap. */
 void
 vga_refresh_font(GtkWidget * widget)
 {
@@ -966,13 +1115,18 @@ vga_refresh_font(GtkWidget * widget)
 	g_return_if_fail(VGA_IS_TEXT(widget));
 	vga = VGA_TEXT(widget);
 
+	/* vga_realize() renders the glyphs when the time comes */
+	if (vga->pvt->gc == NULL)
+		return;
+
 	g_object_unref(vga->pvt->glyphs);
-	vga->pvt->glyphs = vga_font_get_bitmap(vga->pvt->font,
-			widget->window);
+	vga->pvt->glyphs = vga_font_get_scaled_bitmap(vga->pvt->screen->font,
+			widget->window, vga->pvt->zoom);
 	gdk_gc_set_stipple(vga->pvt->gc, vga->pvt->glyphs);
 }
 
-/* Override the default VGA font.  Refreshes the display. */
+/* Override the default VGA font.  Refreshes the display.  The widget keeps
+ * its own reference to @font, which may be shared with other widgets. */
 void
 vga_set_font(GtkWidget * widget, VGAFont * font)
 {
@@ -980,16 +1134,11 @@ vga_set_font(GtkWidget * widget, VGAFont * font)
 
 	g_return_if_fail(widget != NULL);
 	g_return_if_fail(VGA_IS_TEXT(widget));
+	g_return_if_fail(font != NULL);
 	vga = VGA_TEXT(widget);
 
-	if (vga->pvt->font != font)
-	{
-		vga_font_destroy(vga->pvt->font);
-		vga->pvt->font = font;
-	}
-
-	vga_refresh_font(widget);
-	vga_refresh(widget);
+	vga_screen_set_font(vga->pvt->screen, font);
+	vga_update(widget);
 }
 
 /*
@@ -1005,7 +1154,8 @@ vga_set_icecolor(GtkWidget * widget, gboolean status)
 	g_return_if_fail(VGA_IS_TEXT(widget));
 	vga = VGA_TEXT(widget);
 
-	vga->pvt->icecolor = status;
+	vga_screen_set_icecolor(vga->pvt->screen, status);
+	vga_update(widget);
 }
 
 gboolean vga_get_icecolor(GtkWidget * widget)
@@ -1016,7 +1166,7 @@ gboolean vga_get_icecolor(GtkWidget * widget)
 	g_assert(VGA_IS_TEXT(widget));
 	vga = VGA_TEXT(widget);
 
-	return vga->pvt->icecolor;
+	return vga->pvt->screen->icecolor;
 }
 
 vga_charcell *
@@ -1025,13 +1175,13 @@ vga_get_char(GtkWidget * widget, int col, int row)
 	VGAText * vga;
 	int ofs;
 
-	g_return_if_fail(widget != NULL);
-	g_return_if_fail(VGA_IS_TEXT(widget));
+	g_return_val_if_fail(widget != NULL, NULL);
+	g_return_val_if_fail(VGA_IS_TEXT(widget), NULL);
 	vga = VGA_TEXT(widget);
 	
-	ofs = vga->pvt->cols * row + col;
+	ofs = vga->pvt->screen->cols * row + col;
 	
-	return &vga->pvt->video_buf[ofs];
+	return &vga->pvt->screen->video_buf[ofs];
 }
 
 /* Put a character on the screen */
@@ -1039,24 +1189,13 @@ void
 vga_put_char(GtkWidget * widget, guchar c, guchar attr, int col, int row)
 {
 	VGAText * vga;
-	int ofs;
-	GdkRectangle area;
 
 	g_return_if_fail(widget != NULL);
 	g_return_if_fail(VGA_IS_TEXT(widget));
 	vga = VGA_TEXT(widget);
 
-	/* Update video buffer */
-	ofs = vga->pvt->cols * row + col;
-	vga->pvt->video_buf[ofs].c = c;
-	vga->pvt->video_buf[ofs].attr = attr;
-
-	/* Refresh charcell */
-	area.x = col * vga->pvt->font->width;
-	area.y = row * vga->pvt->font->height;
-	area.width = vga->pvt->font->width;
-	area.height = vga->pvt->font->height;
-	vga_refresh_area(widget, vga, &area);
+	vga_screen_put_char(vga->pvt->screen, c, attr, col, row);
+	vga_update(widget);
 }
 
 /* Put a string on the screen.  String will be truncated if exceeds screen
@@ -1066,33 +1205,14 @@ void
 vga_put_string(GtkWidget * widget, guchar * s, guchar attr, int col, int row)
 {
 	VGAText * vga;
-	int ofs, i, len;
-	GdkRectangle area;
 
 	g_return_if_fail(widget != NULL);
 	g_return_if_fail(VGA_IS_TEXT(widget));
 	g_return_if_fail(s != NULL);
 	vga = VGA_TEXT(widget);
 
-	len = strlen(s);
-	if (len > (vga->pvt->cols - col))
-		/* Truncate string */
-		len = vga->pvt->cols - col;
-
-	/* Update video buffer */
-	ofs = vga->pvt->cols * row + col;
-	for (i = 0; i < len; i++)
-	{
-		vga->pvt->video_buf[ofs].c = s[i];
-		vga->pvt->video_buf[ofs++].attr = attr;
-	}
-
-	/* Refresh charcells */
-	area.x = col * vga->pvt->font->width;
-	area.y = row * vga->pvt->font->height;
-	area.width = vga->pvt->font->width * len;
-	area.height = vga->pvt->font->height;
-	vga_refresh_area(widget, vga, &area);
+	vga_screen_put_string(vga->pvt->screen, s, attr, col, row);
+	vga_update(widget);
 }
 
 
@@ -1107,7 +1227,7 @@ vga_get_video_buf(GtkWidget * widget)
 	g_return_val_if_fail(VGA_IS_TEXT(widget), NULL);
 	vga = VGA_TEXT(widget);
 
-	return (guchar *) vga->pvt->video_buf;
+	return (guchar *) vga->pvt->screen->video_buf;
 }
 
 
@@ -1120,7 +1240,7 @@ vga_video_buf_size(GtkWidget * widget)
 	g_return_val_if_fail(VGA_IS_TEXT(widget), -1);
 	vga = VGA_TEXT(widget);
 
-	return vga->pvt->rows * vga->pvt->cols * sizeof(vga_charcell);
+	return vga->pvt->screen->rows * vga->pvt->screen->cols * sizeof(vga_charcell);
 }
 
 void
@@ -1140,25 +1260,8 @@ vga_cursor_set_visible(GtkWidget * widget, gboolean visible)
 	g_return_if_fail(VGA_IS_TEXT(widget));
 	vga = VGA_TEXT(widget);
 
-	if(visible && !vga->pvt->cursor_visible){
-	  // Restart the cursor blink timer
-	  
-	  /* Add our cursor timeout event to make it blink */
-	  /* 229 ms is about how often the cursor blink is toggled in DOS */
-	  vga->pvt->cursor_timeout_id = g_timeout_add(CURSOR_BLINK_PERIOD_MS,
-						 vga_blink_cursor, vga);
-	  
-	}
-	else if(!visible && vga->pvt->cursor_visible){
-	  // Remove the cursor blink timer
-	  if (vga->pvt->cursor_timeout_id != -1)
-	    g_source_remove(vga->pvt->cursor_timeout_id);
-
-	  // Refresh cell to remove the cursor
-	  vga_refresh_region(widget, vga->pvt->cursor_x, vga->pvt->cursor_y, 1, 1);
-	}
-
-	vga->pvt->cursor_visible = visible;
+	vga_screen_cursor_set_visible(vga->pvt->screen, visible);
+	vga_update(widget);
 }
 
 gboolean
@@ -1170,7 +1273,7 @@ vga_cursor_is_visible(GtkWidget * widget)
 	g_assert(VGA_IS_TEXT(widget));
 	vga = VGA_TEXT(widget);
 
-	return vga->pvt->cursor_visible;
+	return vga->pvt->screen->cursor_visible;
 }
 
 
@@ -1184,16 +1287,8 @@ vga_cursor_move(GtkWidget * widget, int x, int y)
 	g_return_if_fail(VGA_IS_TEXT(widget));
 	vga = VGA_TEXT(widget);
 
-	if (vga->pvt->cursor_visible)
-		vga_refresh_region(widget, vga->pvt->cursor_x,
-				vga->pvt->cursor_y, 1, 1);
-
-	vga->pvt->cursor_x = x;
-	vga->pvt->cursor_y = y;
-
-	if (vga->pvt->cursor_visible)
-		vga_refresh_region(widget, x, y, 1, 1);
-		
+	vga_screen_cursor_move(vga->pvt->screen, x, y);
+	vga_update(widget);
 }
 
 int
@@ -1205,7 +1300,7 @@ vga_cursor_x(GtkWidget * widget)
 	g_return_val_if_fail(VGA_IS_TEXT(widget), -1);
 	vga = VGA_TEXT(widget);
 
-	return vga->pvt->cursor_x;
+	return vga->pvt->screen->cursor_x;
 }
 
 int
@@ -1217,7 +1312,7 @@ vga_cursor_y(GtkWidget * widget)
 	g_return_val_if_fail(VGA_IS_TEXT(widget), -1);
 	vga = VGA_TEXT(widget);
 
-	return vga->pvt->cursor_y;
+	return vga->pvt->screen->cursor_y;
 }
 
 
@@ -1242,10 +1337,10 @@ vga_refresh_region(GtkWidget * widget,
 	g_return_if_fail(VGA_IS_TEXT(widget));
 	vga = VGA_TEXT(widget);
 
-	area.x = top_left_x * vga->pvt->font->width;
-	area.y = top_left_y * vga->pvt->font->height;
-	area.width = cols * vga->pvt->font->width;
-	area.height = rows * vga->pvt->font->height;
+	area.x = top_left_x * CELL_WIDTH(vga);
+	area.y = top_left_y * CELL_HEIGHT(vga);
+	area.width = cols * CELL_WIDTH(vga);
+	area.height = rows * CELL_HEIGHT(vga);
 	vga_refresh_area(widget, vga, &area);
 }
 		
@@ -1259,7 +1354,7 @@ vga_refresh(GtkWidget * widget)
 	g_return_if_fail(VGA_IS_TEXT(widget));
 	vga = VGA_TEXT(widget);
 
-	vga_refresh_region(widget, 0, 0, vga->pvt->cols, vga->pvt->rows);
+	vga_refresh_region(widget, 0, 0, vga->pvt->screen->cols, vga->pvt->screen->rows);
 }
 
 void vga_set_rows(GtkWidget * widget, int rows)
@@ -1270,12 +1365,8 @@ void vga_set_rows(GtkWidget * widget, int rows)
 	g_return_if_fail(VGA_IS_TEXT(widget));
 	vga = VGA_TEXT(widget);
 
-	if(rows == vga->pvt->rows){
-	  return;
-	}
-
-	vga->pvt->rows = rows;
-	vga_alloc_videobuf(vga);
+	vga_screen_resize(vga->pvt->screen, rows, vga->pvt->screen->cols);
+	vga_update(widget);
 }
 
 void vga_set_cols(GtkWidget * widget, int cols)
@@ -1286,12 +1377,8 @@ void vga_set_cols(GtkWidget * widget, int cols)
 	g_return_if_fail(VGA_IS_TEXT(widget));
 	vga = VGA_TEXT(widget);
 
-	if(cols == vga->pvt->cols){
-	  return;
-	}
-
-	vga->pvt->cols = cols;
-	vga_alloc_videobuf(vga);
+	vga_screen_resize(vga->pvt->screen, vga->pvt->screen->rows, cols);
+	vga_update(widget);
 }
 
 int vga_get_rows(GtkWidget * widget)
@@ -1302,7 +1389,7 @@ int vga_get_rows(GtkWidget * widget)
 	g_return_val_if_fail(VGA_IS_TEXT(widget), -1);
 	vga = VGA_TEXT(widget);
 
-	return vga->pvt->rows;
+	return vga->pvt->screen->rows;
 }
 
 int vga_get_cols(GtkWidget * widget)
@@ -1313,61 +1400,331 @@ int vga_get_cols(GtkWidget * widget)
 	g_return_val_if_fail(VGA_IS_TEXT(widget), -1);
 	vga = VGA_TEXT(widget);
 
-	return vga->pvt->cols;
+	return vga->pvt->screen->cols;
 }
 
+void vga_clear_area(GtkWidget * widget, guchar attr, int top_left_x,
+		int top_left_y, int cols, int rows)
+{
+	VGAText * vga;
+
+	g_return_if_fail(widget != NULL);
+	g_return_if_fail(VGA_IS_TEXT(widget));
+	vga = VGA_TEXT(widget);
+
+	vga_screen_clear_area(vga->pvt->screen, attr, top_left_x, top_left_y,
+			cols, rows);
+	vga_update(widget);
+}
+
+/* Clear screen / eol will be done in the terminal widget since it is
+ * based on the screen 'textattr'. */
+
+/* Delete a line, scrolling .. hmm question.. should we have the 'window'
+ * concept in here?  i think the BIOS might have actually had something
+ * like that but i doubt it now that i think about it. */
+
 /**
- * memsetword:
- * @s: Pointer to the start of the area
- * @c: The word to fill the area with
- * @count: The size of the area
+ * vga_get_screen:
+ * @widget: VGAText widget
+ *
+ * Get the screen model the widget displays.  Changes made to it are not
+ * drawn until vga_update() is called.
  *
- * Fill a memory area with a 16-byte word value
+ * Returns: The widget's VGAScreen.  It belongs to the widget.
  */
-static void * memsetword(void * s, gint16 c, size_t count)
+VGAScreen *
+vga_get_screen(GtkWidget * widget)
 {
-	/* Simple portable way of doing it */
-	gint16 * xs = (gint16 *) s;
+	VGAText * vga;
 
-	while (count--)
-		*xs++ = c;
+	g_return_val_if_fail(widget != NULL, NULL);
+	g_return_val_if_fail(VGA_IS_TEXT(widget), NULL);
+	vga = VGA_TEXT(widget);
 
-	return s;
+	return vga->pvt->screen;
 }
 
-void vga_clear_area(GtkWidget * widget, guchar attr, int top_left_x,
-		int top_left_y, int cols, int rows)
+/*
+ * vga_invalidate_damage:
+ * @vga: VGAText structure pointer
+ *
+ * Invalidate the screen's damage instead of drawing it: the dirty span of
+ * each row, with rows whose spans match joined into one rectangle.  GDK
+ * gathers these into the window's update region and paints it on the
+ * next expose.
+ */
+static void
+vga_invalidate_damage(VGAText * vga)
+{
+	VGAScreen * scr = vga->pvt->screen;
+	int y, top;
+
+	if (scr->changes & VGA_SCREEN_DIRTY)
+	{
+		vga_invalidate_all(vga);
+		return;
+	}
+
+	y = scr->dirty_top;
+	while (y < scr->dirty_bottom)
+	{
+		top = y++;
+		while (y < scr->dirty_bottom &&
+				scr->dirty_start[y] == scr->dirty_start[top] &&
+				scr->dirty_end[y] == scr->dirty_end[top])
+			y++;
+		if (scr->dirty_start[top] >= 0)
+			vga_invalidate_cells(vga, scr->dirty_start[top],
+					scr->dirty_end[top] -
+					scr->dirty_start[top], top, y - top);
+	}
+}
+
+/**
+ * vga_update:
+ * @widget: VGAText widget
+ *
+ * Bring the display up to date with the damage recorded in the widget's
+ * screen, then clear the damage.  Only the dirty span of each row is
+ * redrawn unless the palette, font or size changed.  With drawing
+ * deferred (see vga_set_deferred_drawing()) the damage is invalidated to
+ * be painted later instead.
+ */
+void
+vga_update(GtkWidget * widget)
 {
 	VGAText * vga;
-	gint16 cellword;
-	int ofs, y, endrow;
+	VGAScreen * scr;
+	int y;
 
 	g_return_if_fail(widget != NULL);
 	g_return_if_fail(VGA_IS_TEXT(widget));
 	vga = VGA_TEXT(widget);
-	/* FIXME: Endianness.  No << 8 for big endian */
-	cellword = 0x0000 | ((gint16) attr << 8);
-	/* Special case optimization */
-	if (cols == vga->pvt->cols)
+	scr = vga->pvt->screen;
+
+	/* The damage is kept for when fast-forwarding stops */
+	if (vga->pvt->fast_forward)
+		return;
+
+	if (scr->changes & VGA_SCREEN_RESIZE)
+		gtk_widget_queue_resize(widget);
+
+	if (scr->bells > 0)
+		gdk_beep();
+
+	if (scr->changes & VGA_SCREEN_CURSOR)
 	{
-		ofs = top_left_y * cols;
-		memsetword(vga->pvt->video_buf + ofs, cellword, cols * rows);
+		if (scr->cursor_visible && vga->pvt->cursor_timeout_id == -1)
+		{
+			/* Restart the cursor blink timer */
+			vga->pvt->cursor_timeout_id =
+				g_timeout_add(CURSOR_BLINK_PERIOD_MS,
+						vga_blink_cursor, vga);
+		}
+		else if (!scr->cursor_visible &&
+				vga->pvt->cursor_timeout_id != -1)
+		{
+			g_source_remove(vga->pvt->cursor_timeout_id);
+			vga->pvt->cursor_timeout_id = -1;
+		}
 	}
-	else
+
+	if (GTK_WIDGET_REALIZED(widget))
 	{
-		endrow = top_left_y + rows;
-		for (y = top_left_y; y < endrow; y++)
+		if (scr->changes & VGA_SCREEN_FONT)
+		{
+			vga_fit_zoom(vga);
+			vga_refresh_font(widget);
+		}
+
+		/* Make vga_set_textattr() reload the colors from the palette */
+		if (scr->changes & VGA_SCREEN_PALETTE)
 		{
-			ofs = (y * vga->pvt->cols + top_left_x);
-			memsetword(vga->pvt->video_buf + ofs, cellword, cols);
+			vga->pvt->fg = 0xFF;
+			vga->pvt->bg = 0xFF;
 		}
+
+		if (vga->pvt->deferred)
+			vga_invalidate_damage(vga);
+		else if (scr->changes & VGA_SCREEN_DIRTY)
+			vga_refresh(widget);
+		else
+			for (y = scr->dirty_top; y < scr->dirty_bottom; y++)
+			{
+				if (scr->dirty_start[y] < 0)
+					continue;
+				vga_refresh_region(widget, scr->dirty_start[y],
+					y, scr->dirty_end[y] -
+					scr->dirty_start[y], 1);
+			}
 	}
-	vga_refresh_region(widget, top_left_x, top_left_y, cols, rows);
+
+	vga_screen_clear_damage(scr);
 }
 
-/* Clear screen / eol will be done in the terminal widget since it is
- * based on the screen 'textattr'. */
+/**
+ * vga_set_fast_forward:
+ * @widget: VGAText widget
+ * @status: Whether to fast-forward
+ *
+ * While fast-forwarding, the widget draws nothing at all: not changes to
+ * the screen, cursor or character blinking, palette and font changes, nor
+ * exposes.  The screen itself is still updated, but without tracking
+ * which cells changed.  Turning it off repaints the whole widget once.
+ * This is for parsing a lot of input of which only the end result is
+ * wanted, e.g. when seeking.  Use vga_term_set_fast_forward() on a
+ * VGATerm.
+ */
+void
+vga_set_fast_forward(GtkWidget * widget, gboolean status)
+{
+	VGAText * vga;
 
-/* Delete a line, scrolling .. hmm question.. should we have the 'window'
- * concept in here?  i think the BIOS might have actually had something
- * like that but i doubt it now that i think about it. */
+	g_return_if_fail(widget != NULL);
+	g_return_if_fail(VGA_IS_TEXT(widget));
+	vga = VGA_TEXT(widget);
+
+	if (vga->pvt->fast_forward == status)
+		return;
+
+	/* Once everything is dirty, damage stops being tracked per cell */
+	vga_screen_damage_all(vga->pvt->screen);
+	vga->pvt->fast_forward = status;
+	if (!status)
+		vga_update(widget);
+}
+
+gboolean
+vga_get_fast_forward(GtkWidget * widget)
+{
+	g_return_val_if_fail(widget != NULL, FALSE);
+	g_return_val_if_fail(VGA_IS_TEXT(widget), FALSE);
+
+	return VGA_TEXT(widget)->pvt->fast_forward;
+}
+
+/**
+ * vga_set_deferred_drawing:
+ * @widget: VGAText widget
+ * @status: Whether to defer drawing
+ *
+ * Normally vga_update(), and so every vga_put_char(), vga_clear_area()
+ * and the like, draws the changes before it returns.  With drawing
+ * deferred it only invalidates the cells that changed, and GTK+ paints
+ * everything invalidated since the last frame in one go when it next
+ * processes updates.  A burst of output then costs one repaint instead of
+ * one per call.
+ */
+void
+vga_set_deferred_drawing(GtkWidget * widget, gboolean status)
+{
+	g_return_if_fail(widget != NULL);
+	g_return_if_fail(VGA_IS_TEXT(widget));
+
+	VGA_TEXT(widget)->pvt->deferred = status;
+}
+
+gboolean
+vga_get_deferred_drawing(GtkWidget * widget)
+{
+	g_return_val_if_fail(widget != NULL, FALSE);
+	g_return_val_if_fail(VGA_IS_TEXT(widget), FALSE);
+
+	return VGA_TEXT(widget)->pvt->deferred;
+}
+
+/**
+ * vga_set_zoom:
+ * @widget: VGAText widget
+ * @zoom: Screen pixels per font pixel, each way, from 1 to 4
+ *
+ * Draw the text @zoom times its normal size, e.g. on a high resolution
+ * display.  The glyphs are rendered at that size once, so a zoomed widget
+ * draws no more than an unzoomed one.  The widget asks to be resized.
+ *
+ * All 256 glyphs have to fit in one X bitmap, so fonts taller than 16
+ * lines are zoomed less than @zoom if need be; vga_get_zoom() tells how
+ * much.  The zoom asked for comes back when the font allows it.
+ */
+void
+vga_set_zoom(GtkWidget * widget, int zoom)
+{
+	VGAText * vga;
+
+	g_return_if_fail(widget != NULL);
+	g_return_if_fail(VGA_IS_TEXT(widget));
+	g_return_if_fail(zoom >= 1 && zoom <= 4);
+	vga = VGA_TEXT(widget);
+
+	vga->pvt->zoom_wanted = zoom;
+	if (vga_fit_zoom(vga))
+		vga_refresh_font(widget);
+}
+
+int
+vga_get_zoom(GtkWidget * widget)
+{
+	g_return_val_if_fail(widget != NULL, 1);
+	g_return_val_if_fail(VGA_IS_TEXT(widget), 1);
+
+	return VGA_TEXT(widget)->pvt->zoom;
+}
+
+/**
+ * vga_set_renderer:
+ * @widget: VGAText widget
+ * @renderer: How to draw the text
+ *
+ * Choose how the widget draws.  %VGA_RENDERER_GC fills each cell with a
+ * stippled GC and works on any display.  %VGA_RENDERER_XRENDER keeps the
+ * font on the X server as a glyph set and draws each color's backgrounds
+ * and text in one request apiece, so a repaint takes a few dozen requests
+ * rather than one or more per cell.  %VGA_RENDERER_XSHM draws the text
+ * into an image on the client and sends each area drawn as one image,
+ * through shared memory if the X server is local; this suits screens
+ * that change all over, such as palette morphs.  A renderer the display
+ * can't do falls back to %VGA_RENDERER_GC.
+ *
+ * Returns: FALSE if the widget is realized and fell back
+ */
+gboolean
+vga_set_renderer(GtkWidget * widget, VGARenderer renderer)
+{
+	VGAText * vga;
+
+	g_return_val_if_fail(widget != NULL, FALSE);
+	g_return_val_if_fail(VGA_IS_TEXT(widget), FALSE);
+	vga = VGA_TEXT(widget);
+
+	vga->pvt->renderer = renderer;
+	if (!GTK_WIDGET_REALIZED(widget))
+		return TRUE;
+
+	vga_backend_stop(vga);
+	vga_backend_start(vga);
+	vga_invalidate_all(vga);
+
+	return vga->pvt->backend == vga_renderer_backend(renderer);
+}
+
+/**
+ * vga_get_renderer:
+ * @widget: VGAText widget
+ *
+ * Returns: The renderer in use, once the widget is realized; until then,
+ * the one asked for
+ */
+VGARenderer
+vga_get_renderer(GtkWidget * widget)
+{
+	VGAText * vga;
+
+	g_return_val_if_fail(widget != NULL, VGA_RENDERER_GC);
+	g_return_val_if_fail(VGA_IS_TEXT(widget), VGA_RENDERER_GC);
+	vga = VGA_TEXT(widget);
+
+	if (GTK_WIDGET_REALIZED(widget) && vga->pvt->backend == NULL)
+		return VGA_RENDERER_GC;
+	return vga->pvt->renderer;
+}
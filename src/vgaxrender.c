@@ -0,0 +1,358 @@
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of version 2 of the GNU General Public License as
+ *  published by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ *****************************************************************************
+ *
+ *  XRender backend for VGAText.  The font is uploaded to the X server once
+ *  as a glyph set of 8 bit masks, at the widget's zoom, with the character
+ *  codes as glyph ids.  Drawing an area then takes, for each of the 16
+ *  text colors in use, one request filling all the backgrounds of that
+ *  color and one compositing all the characters of that color, each run
+ *  of same-colored cells a glyph string of its own.
+ *
+ *  The glyph set is uploaded again whenever the font or zoom changes.
+ */
+
+#include "vgabackend.h"
+
+#ifdef GDK_WINDOWING_X11
+
+#include <gdk/gdkx.h>
+#include <X11/extensions/Xrender.h>
+
+#define XR_COLORS	16
+#define XR_UPLOAD	32	/* Glyphs per request when uploading */
+
+typedef struct
+{
+	Display * dpy;
+	Picture dst;		/* The widget's window */
+	Picture pen[XR_COLORS];	/* 1x1 repeating, one per text color */
+	XRenderColor color[XR_COLORS];	/* What the pens are filled with */
+
+	GlyphSet glyphs;
+	VGAFont * font;		/* What glyphs was made from */
+	guint font_serial;
+	int zoom;
+
+	/* Reused from draw to draw */
+	GArray * rects[XR_COLORS];	/* Backgrounds, by color */
+	GArray * runs[XR_COLORS];	/* XGlyphElt8 strings, by color */
+	guchar * chars;			/* What runs point into */
+	gsize chars_size;
+} XRState;
+
+/* Upload @font at @zoom as the glyph set */
+static void
+xr_load_glyphs(XRState * xr, VGAFont * font, int zoom)
+{
+	XRenderPictFormat * a8;
+	Glyph ids[XR_UPLOAD];
+	XGlyphInfo info[XR_UPLOAD];
+	const guchar * cov;
+	guchar * buf, * out;
+	int cw, ch, stride, size, c, i, x, y;
+
+	if (xr->glyphs)
+		XRenderFreeGlyphSet(xr->dpy, xr->glyphs);
+	a8 = XRenderFindStandardFormat(xr->dpy, PictStandardA8);
+	xr->glyphs = XRenderCreateGlyphSet(xr->dpy, a8);
+
+	cw = font->width * zoom;
+	ch = font->height * zoom;
+	stride = (cw + 3) & ~3;		/* A8 rows are padded to 32 bits */
+	size = stride * ch;
+	buf = g_malloc0(size * XR_UPLOAD);
+	cov = vga_font_get_coverage(font);
+
+	for (c = 0; c < 256; c += XR_UPLOAD)
+	{
+		for (i = 0; i < XR_UPLOAD; i++)
+		{
+			ids[i] = c + i;
+			info[i].width = cw;
+			info[i].height = ch;
+			info[i].x = 0;
+			info[i].y = 0;
+			info[i].xOff = cw;
+			info[i].yOff = 0;
+
+			out = buf + i * size;
+			for (y = 0; y < ch; y++, out += stride)
+				for (x = 0; x < cw; x++)
+					out[x] = cov[((c + i) * font->height +
+						y / zoom) * font->width +
+						x / zoom];
+		}
+		XRenderAddGlyphs(xr->dpy, xr->glyphs, ids, info, XR_UPLOAD,
+				(const char *) buf, size * XR_UPLOAD);
+	}
+	g_free(buf);
+
+	if (xr->font != font)
+	{
+		if (xr->font)
+			vga_font_destroy(xr->font);
+		xr->font = vga_font_ref(font);
+	}
+	xr->font_serial = font->serial;
+	xr->zoom = zoom;
+}
+
+/* Bring the pens into line with the palette */
+static void
+xr_update_pens(XRState * xr, VGAPalette * pal)
+{
+	XRenderColor color;
+	GdkColor * gc;
+	int i;
+
+	for (i = 0; i < XR_COLORS; i++)
+	{
+		gc = &pal->color[vga_palette_text_regs[i]];
+		color.red = gc->red;
+		color.green = gc->green;
+		color.blue = gc->blue;
+		color.alpha = 0xFFFF;
+		if (memcmp(&color, &xr->color[i], sizeof(color)) == 0)
+			continue;
+
+		xr->color[i] = color;
+		XRenderFillRectangle(xr->dpy, PictOpSrc, xr->pen[i], &color,
+				0, 0, 1, 1);
+	}
+}
+
+static gpointer
+xr_new(GtkWidget * widget)
+{
+	XRState * xr;
+	XRenderPictFormat * format, * argb;
+	XRenderPictureAttributes attr;
+	Display * dpy;
+	Pixmap pixmap;
+	int event_base, error_base, i;
+
+	dpy = GDK_WINDOW_XDISPLAY(widget->window);
+	if (!XRenderQueryExtension(dpy, &event_base, &error_base))
+		return NULL;
+	format = XRenderFindVisualFormat(dpy, GDK_VISUAL_XVISUAL(
+				gdk_drawable_get_visual(widget->window)));
+	argb = XRenderFindStandardFormat(dpy, PictStandardARGB32);
+	if (format == NULL || argb == NULL)
+		return NULL;
+
+	xr = g_new0(XRState, 1);
+	xr->dpy = dpy;
+	xr->dst = XRenderCreatePicture(dpy, GDK_WINDOW_XID(widget->window),
+			format, 0, NULL);
+
+	attr.repeat = True;
+	for (i = 0; i < XR_COLORS; i++)
+	{
+		pixmap = XCreatePixmap(dpy, GDK_WINDOW_XID(widget->window),
+				1, 1, 32);
+		xr->pen[i] = XRenderCreatePicture(dpy, pixmap, argb,
+				CPRepeat, &attr);
+		XFreePixmap(dpy, pixmap);
+		/* Transparent, so the first xr_update_pens() fills it */
+		memset(&xr->color[i], 0, sizeof(XRenderColor));
+		XRenderFillRectangle(dpy, PictOpSrc, xr->pen[i],
+				&xr->color[i], 0, 0, 1, 1);
+
+		xr->rects[i] = g_array_new(FALSE, FALSE, sizeof(XRectangle));
+		xr->runs[i] = g_array_new(FALSE, FALSE, sizeof(XGlyphElt8));
+	}
+
+	return xr;
+}
+
+static void
+xr_destroy(gpointer data)
+{
+	XRState * xr = data;
+	int i;
+
+	for (i = 0; i < XR_COLORS; i++)
+	{
+		XRenderFreePicture(xr->dpy, xr->pen[i]);
+		g_array_free(xr->rects[i], TRUE);
+		g_array_free(xr->runs[i], TRUE);
+	}
+	if (xr->glyphs)
+		XRenderFreeGlyphSet(xr->dpy, xr->glyphs);
+	XRenderFreePicture(xr->dpy, xr->dst);
+	if (xr->font)
+		vga_font_destroy(xr->font);
+	g_free(xr->chars);
+	g_free(xr);
+}
+
+/* Add a background rectangle, merging it with the last one if they meet */
+static void
+xr_add_rect(GArray * rects, int x, int y, int w, int h)
+{
+	XRectangle * last, r;
+
+	if (rects->len > 0)
+	{
+		last = &g_array_index(rects, XRectangle, rects->len - 1);
+		if (last->y == y && last->x + last->width == x)
+		{
+			last->width += w;
+			return;
+		}
+	}
+
+	r.x = x;
+	r.y = y;
+	r.width = w;
+	r.height = h;
+	g_array_append_val(rects, r);
+}
+
+static void
+xr_draw(gpointer data, GtkWidget * widget, GdkRectangle * area)
+{
+	XRState * xr = data;
+	VGAScreen * scr;
+	vga_charcell * cell;
+	XRectangle clip;
+	XGlyphElt8 run;
+	int pen_x[XR_COLORS], pen_y[XR_COLORS];
+	int cw, ch, zoom, col0, col1, row0, row1, row, col, x, y;
+	guchar fg, bg, run_fg;
+	guchar * chars;
+	gsize cells;
+	int i;
+
+	scr = vga_get_screen(widget);
+	zoom = vga_get_zoom(widget);
+	cw = scr->font->width * zoom;
+	ch = scr->font->height * zoom;
+
+	if (scr->font != xr->font || scr->font->serial != xr->font_serial ||
+		zoom != xr->zoom)
+		xr_load_glyphs(xr, scr->font, zoom);
+	xr_update_pens(xr, scr->pal);
+
+	col0 = area->x / cw;
+	row0 = area->y / ch;
+	col1 = MIN((area->x + area->width + cw - 1) / cw, scr->cols);
+	row1 = MIN((area->y + area->height + ch - 1) / ch, scr->rows);
+	if (col0 >= col1 || row0 >= row1)
+		return;
+
+	cells = (gsize) (col1 - col0) * (row1 - row0);
+	if (cells > xr->chars_size)
+	{
+		g_free(xr->chars);
+		xr->chars = g_malloc(cells);
+		xr->chars_size = cells;
+	}
+	chars = xr->chars;
+
+	for (i = 0; i < XR_COLORS; i++)
+	{
+		g_array_set_size(xr->rects[i], 0);
+		g_array_set_size(xr->runs[i], 0);
+		pen_x[i] = pen_y[i] = 0;
+	}
+
+	/* Sort the cells into runs of each color */
+	run.glyphset = xr->glyphs;
+	for (row = row0; row < row1; row++)
+	{
+		y = row * ch;
+		cell = &scr->video_buf[row * scr->cols + col0];
+		run.nchars = 0;
+		run_fg = 0;
+		for (col = col0; col < col1; col++, cell++)
+		{
+			x = col * cw;
+			vga_text_attr_colors(widget, cell->attr, &fg, &bg);
+			xr_add_rect(xr->rects[bg], x, y, cw, ch);
+
+			/* A run ends at a color change or a hidden cell */
+			if (run.nchars > 0 && (fg != run_fg || fg == bg))
+			{
+				g_array_append_val(xr->runs[run_fg], run);
+				run.nchars = 0;
+			}
+			if (fg == bg)
+				continue;
+
+			if (run.nchars == 0)
+			{
+				/* Each string starts where the last one of
+				 * the color left the pen */
+				run_fg = fg;
+				run.chars = (char *) chars;
+				run.xOff = x - pen_x[fg];
+				run.yOff = y - pen_y[fg];
+			}
+			*chars++ = cell->c;
+			run.nchars++;
+			pen_x[fg] = x + cw;
+			pen_y[fg] = y;
+		}
+		if (run.nchars > 0)
+			g_array_append_val(xr->runs[run_fg], run);
+	}
+
+	clip.x = area->x;
+	clip.y = area->y;
+	clip.width = area->width;
+	clip.height = area->height;
+	XRenderSetPictureClipRectangles(xr->dpy, xr->dst, 0, 0, &clip, 1);
+
+	for (i = 0; i < XR_COLORS; i++)
+		if (xr->rects[i]->len > 0)
+			XRenderFillRectangles(xr->dpy, PictOpSrc, xr->dst,
+					&xr->color[i],
+					(XRectangle *) xr->rects[i]->data,
+					xr->rects[i]->len);
+
+	for (i = 0; i < XR_COLORS; i++)
+		if (xr->runs[i]->len > 0)
+			XRenderCompositeText8(xr->dpy, PictOpOver, xr->pen[i],
+					xr->dst, NULL, 0, 0, 0, 0,
+					(XGlyphElt8 *) xr->runs[i]->data,
+					xr->runs[i]->len);
+}
+
+const VGABackend vga_xrender_backend =
+{
+	xr_new,
+	xr_destroy,
+	xr_draw
+};
+
+#else	/* GDK_WINDOWING_X11 */
+
+/* Nothing to set up; VGAText falls back to the GC fills */
+static gpointer
+xr_new(GtkWidget * widget)
+{
+	return NULL;
+}
+
+const VGABackend vga_xrender_backend =
+{
+	xr_new,
+	NULL,
+	NULL
+};
+
+#endif	/* GDK_WINDOWING_X11 */
@@ -0,0 +1,460 @@
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of version 2 of the GNU General Public License as
+ *  published by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ *****************************************************************************
+ *
+ *  Client-side rendering backend for VGAText.  The text of each area being
+ *  drawn is rasterized into an XImage, a cell at a time, and sent with a
+ *  single put-image.  The image lives in MIT-SHM shared memory when the
+ *  X server can see it, so sending it costs no copying through the
+ *  protocol; otherwise it is an ordinary XImage sent with XPutImage.
+ *
+ *  The image only needs to cover what can be on the display at once, not
+ *  the whole widget, which may be a long scrollback.  Areas are drawn into
+ *  successive bands of it, wrapping round at the bottom, and bigger areas
+ *  in tiles.  The server reads shared memory after XShmPutImage returns,
+ *  so each put is remembered until its completion event comes back, and a
+ *  band is only waited for when it is about to be reused while a put from
+ *  it is still outstanding.
+ *
+ *  Only 32 bit per pixel TrueColor visuals are handled, which is what
+ *  nearly every display uses; anything else falls back to the GC fills.
+ */
+
+#include "vgabackend.h"
+
+#ifdef GDK_WINDOWING_X11
+
+#include <sys/ipc.h>
+#include <sys/shm.h>
+#include <gdk/gdkx.h>
+#include <X11/Xutil.h>
+#include <X11/extensions/XShm.h>
+
+#define XS_COLORS	16
+
+typedef struct
+{
+	Display * dpy;
+	Window win;
+	GC gc;
+	Visual * visual;
+	int depth;
+	gboolean use_shm;	/* The server has MIT-SHM and it works */
+
+	XImage * image;		/* NULL until the first draw */
+	XShmSegmentInfo shm;	/* shmaddr is NULL if not shared */
+	int completion;		/* ShmCompletion event type */
+	GQueue * busy;		/* GdkRectangles of image still being read */
+	int next_y;		/* Where the next band starts */
+
+	GdkVisual * gvis;
+	guint32 pixel[XS_COLORS];	/* Text colors as image pixels */
+} XSState;
+
+/* The pixel value of a color on a TrueColor visual */
+static guint32
+xs_pixel(GdkVisual * v, const GdkColor * c)
+{
+	return ((guint32) (c->red >> (16 - v->red_prec)) << v->red_shift) |
+		((guint32) (c->green >> (16 - v->green_prec)) << v->green_shift) |
+		((guint32) (c->blue >> (16 - v->blue_prec)) << v->blue_shift);
+}
+
+/* Is @event the completion of one of our puts? */
+static Bool
+xs_is_completion(Display * dpy, XEvent * event, XPointer data)
+{
+	XSState * xs = (XSState *) data;
+
+	return event->type == xs->completion &&
+		((XShmCompletionEvent *) event)->drawable == xs->win;
+}
+
+/* Completions that come through the main loop; puts finish in order */
+static GdkFilterReturn
+xs_filter(GdkXEvent * xevent, GdkEvent * event, gpointer data)
+{
+	XSState * xs = data;
+
+	if (!xs_is_completion(xs->dpy, xevent, data))
+		return GDK_FILTER_CONTINUE;
+
+	g_free(g_queue_pop_head(xs->busy));
+	return GDK_FILTER_REMOVE;
+}
+
+static gboolean
+xs_is_busy(XSState * xs, GdkRectangle * rect)
+{
+	GdkRectangle dummy;
+	GList * l;
+
+	for (l = xs->busy->head; l != NULL; l = l->next)
+		if (gdk_rectangle_intersect(l->data, rect, &dummy))
+			return TRUE;
+
+	return FALSE;
+}
+
+/* Wait until the server has read all of @rect of the image, or all of it
+ * if @rect is NULL */
+static void
+xs_wait(XSState * xs, GdkRectangle * rect)
+{
+	XEvent event;
+
+	/* Take what has come back already without waiting */
+	while (!g_queue_is_empty(xs->busy) &&
+		XCheckIfEvent(xs->dpy, &event, xs_is_completion, (XPointer) xs))
+		g_free(g_queue_pop_head(xs->busy));
+
+	while (!g_queue_is_empty(xs->busy) &&
+		(rect == NULL || xs_is_busy(xs, rect)))
+	{
+		XIfEvent(xs->dpy, &event, xs_is_completion, (XPointer) xs);
+		g_free(g_queue_pop_head(xs->busy));
+	}
+}
+
+static void
+xs_free_image(XSState * xs)
+{
+	if (xs->image == NULL)
+		return;
+
+	if (xs->shm.shmaddr)
+	{
+		xs_wait(xs, NULL);
+		XShmDetach(xs->dpy, &xs->shm);
+		xs->image->data = NULL;
+		XDestroyImage(xs->image);
+		shmdt(xs->shm.shmaddr);
+		xs->shm.shmaddr = NULL;
+	}
+	else
+		XDestroyImage(xs->image);	/* Frees data too */
+	xs->image = NULL;
+}
+
+/* A shared memory image, or NULL if the server can't use one */
+static XImage *
+xs_new_shm_image(XSState * xs, int width, int height)
+{
+	XImage * image;
+	gint error;
+
+	image = XShmCreateImage(xs->dpy, xs->visual, xs->depth, ZPixmap,
+			NULL, &xs->shm, width, height);
+	if (image == NULL)
+		return NULL;
+
+	xs->shm.shmid = shmget(IPC_PRIVATE,
+			image->bytes_per_line * image->height,
+			IPC_CREAT | 0600);
+	if (xs->shm.shmid < 0)
+	{
+		XDestroyImage(image);
+		return NULL;
+	}
+	xs->shm.shmaddr = image->data = shmat(xs->shm.shmid, NULL, 0);
+	xs->shm.readOnly = True;
+
+	/* Attaching fails on a server on another machine */
+	error = xs->shm.shmaddr == (char *) -1;
+	if (!error)
+	{
+		gdk_error_trap_push();
+		XShmAttach(xs->dpy, &xs->shm);
+		XSync(xs->dpy, False);
+		error = gdk_error_trap_pop();
+	}
+
+	/* Gone once both sides detach, however we exit */
+	shmctl(xs->shm.shmid, IPC_RMID, NULL);
+
+	if (error)
+	{
+		if (xs->shm.shmaddr != (char *) -1)
+			shmdt(xs->shm.shmaddr);
+		xs->shm.shmaddr = NULL;
+		image->data = NULL;
+		XDestroyImage(image);
+		return NULL;
+	}
+
+	return image;
+}
+
+/* Bits per pixel of images @depth deep, 0 if there are none */
+static int
+xs_bits_per_pixel(Display * dpy, int depth)
+{
+	XPixmapFormatValues * formats;
+	int i, n, bpp = 0;
+
+	formats = XListPixmapFormats(dpy, &n);
+	for (i = 0; i < n; i++)
+		if (formats[i].depth == depth)
+			bpp = formats[i].bits_per_pixel;
+	if (formats)
+		XFree(formats);
+
+	return bpp;
+}
+
+/* Make sure there's an image of at least @width by @height */
+static gboolean
+xs_get_image(XSState * xs, int width, int height)
+{
+	XImage * image;
+
+	if (xs->image && xs->image->width >= width &&
+		xs->image->height >= height)
+		return TRUE;
+
+	xs_free_image(xs);
+
+	image = NULL;
+	if (xs->use_shm)
+	{
+		image = xs_new_shm_image(xs, width, height);
+		xs->use_shm = image != NULL;
+	}
+	if (image == NULL)
+	{
+		image = XCreateImage(xs->dpy, xs->visual, xs->depth, ZPixmap,
+				0, NULL, width, height, 32, 0);
+		if (image == NULL)
+			return FALSE;
+		image->data = malloc(image->bytes_per_line * height);
+		if (image->data == NULL)
+		{
+			XDestroyImage(image);
+			return FALSE;
+		}
+		/* Pixels are written as native integers; Xlib swaps them */
+		image->byte_order = G_BYTE_ORDER == G_LITTLE_ENDIAN ?
+			LSBFirst : MSBFirst;
+	}
+
+	xs->image = image;
+	xs->next_y = 0;
+	return TRUE;
+}
+
+static gpointer
+xs_new(GtkWidget * widget)
+{
+	XSState * xs;
+	GdkVisual * gvis;
+	Display * dpy;
+	int major, minor;
+	Bool pixmaps;
+
+	dpy = GDK_WINDOW_XDISPLAY(widget->window);
+	gvis = gdk_drawable_get_visual(widget->window);
+	if (gvis->type != GDK_VISUAL_TRUE_COLOR ||
+		xs_bits_per_pixel(dpy, gvis->depth) != 32)
+		return NULL;
+
+	xs = g_new0(XSState, 1);
+	xs->dpy = dpy;
+	xs->win = GDK_WINDOW_XID(widget->window);
+	xs->gc = XCreateGC(xs->dpy, xs->win, 0, NULL);
+	xs->visual = GDK_VISUAL_XVISUAL(gvis);
+	xs->depth = gvis->depth;
+	xs->gvis = gvis;
+	xs->use_shm = XShmQueryVersion(xs->dpy, &major, &minor, &pixmaps);
+	xs->completion = XShmGetEventBase(xs->dpy) + ShmCompletion;
+	xs->busy = g_queue_new();
+	gdk_window_add_filter(NULL, xs_filter, xs);
+
+	return xs;
+}
+
+static void
+xs_destroy(gpointer data)
+{
+	XSState * xs = data;
+
+	xs_free_image(xs);
+	gdk_window_remove_filter(NULL, xs_filter, xs);
+	while (!g_queue_is_empty(xs->busy))
+		g_free(g_queue_pop_head(xs->busy));
+	g_queue_free(xs->busy);
+	XFreeGC(xs->dpy, xs->gc);
+	g_free(xs);
+}
+
+/* Rasterize cells @col0 to @col1 - 1 of rows @row0 to @row1 - 1 into the
+ * image, the first one at the top left of line @top */
+static void
+xs_render(XSState * xs, GtkWidget * widget, VGAScreen * scr, int zoom,
+		int col0, int col1, int row0, int row1, int top)
+{
+	VGAFont * font = scr->font;
+	vga_charcell * cell;
+	const guchar * glyphs, * cov;
+	guint32 * p, fgp, bgp;
+	guchar fg, bg;
+	char * line;
+	int cw, ch, bpl, width, row, col, y, i, k;
+
+	cw = font->width * zoom;
+	ch = font->height * zoom;
+	bpl = xs->image->bytes_per_line;
+	width = (col1 - col0) * cw * 4;
+	glyphs = vga_font_get_coverage(font);
+
+	for (row = row0; row < row1; row++)
+	{
+		for (y = 0; y < font->height; y++)
+		{
+			line = xs->image->data +
+				(top + (row - row0) * ch + y * zoom) * bpl;
+			p = (guint32 *) line;
+			cell = &scr->video_buf[row * scr->cols + col0];
+			for (col = col0; col < col1; col++, cell++)
+			{
+				vga_text_attr_colors(widget, cell->attr,
+						&fg, &bg);
+				fgp = xs->pixel[fg];
+				bgp = xs->pixel[bg];
+				cov = glyphs + (cell->c * font->height + y) *
+					font->width;
+				for (i = 0; i < font->width; i++)
+					for (k = 0; k < zoom; k++)
+						*p++ = cov[i] ? fgp : bgp;
+			}
+
+			for (k = 1; k < zoom; k++)
+				memcpy(line + k * bpl, line, width);
+		}
+	}
+}
+
+/* Draw the part of @area in one tile of cells, from the next band */
+static void
+xs_draw_tile(XSState * xs, GtkWidget * widget, VGAScreen * scr, int zoom,
+		GdkRectangle * area, int col0, int col1, int row0, int row1)
+{
+	GdkRectangle tile, put, band, dest;
+	int cw, ch;
+
+	cw = scr->font->width * zoom;
+	ch = scr->font->height * zoom;
+	tile.x = col0 * cw;
+	tile.y = row0 * ch;
+	tile.width = (col1 - col0) * cw;
+	tile.height = (row1 - row0) * ch;
+	if (!gdk_rectangle_intersect(area, &tile, &put))
+		return;
+
+	if (xs->next_y + tile.height > xs->image->height)
+		xs->next_y = 0;
+	band.x = put.x - tile.x;
+	band.y = xs->next_y + put.y - tile.y;
+	band.width = put.width;
+	band.height = put.height;
+
+	/* The whole tile is rendered, so none of it may still be waiting
+	 * for the server to read it */
+	if (xs->shm.shmaddr)
+	{
+		dest.x = 0;
+		dest.y = xs->next_y;
+		dest.width = tile.width;
+		dest.height = tile.height;
+		xs_wait(xs, &dest);
+	}
+	xs_render(xs, widget, scr, zoom, col0, col1, row0, row1, xs->next_y);
+	xs->next_y += tile.height;
+
+	if (xs->shm.shmaddr)
+	{
+		XShmPutImage(xs->dpy, xs->win, xs->gc, xs->image, band.x,
+				band.y, put.x, put.y, put.width, put.height,
+				True);
+		g_queue_push_tail(xs->busy, g_memdup(&band, sizeof(band)));
+	}
+	else
+		XPutImage(xs->dpy, xs->win, xs->gc, xs->image, band.x, band.y,
+				put.x, put.y, put.width, put.height);
+}
+
+static void
+xs_draw(gpointer data, GtkWidget * widget, GdkRectangle * area)
+{
+	XSState * xs = data;
+	VGAScreen * scr;
+	GdkScreen * screen;
+	int cw, ch, zoom, col0, col1, row0, row1, cols, rows, row, col, i;
+
+	scr = vga_get_screen(widget);
+	zoom = vga_get_zoom(widget);
+	cw = scr->font->width * zoom;
+	ch = scr->font->height * zoom;
+
+	col0 = area->x / cw;
+	row0 = area->y / ch;
+	col1 = MIN((area->x + area->width + cw - 1) / cw, scr->cols);
+	row1 = MIN((area->y + area->height + ch - 1) / ch, scr->rows);
+	if (col0 >= col1 || row0 >= row1)
+		return;
+
+	/* Enough for as many cells as fit on the display at once */
+	screen = gtk_widget_get_screen(widget);
+	cols = MIN(gdk_screen_get_width(screen) / cw + 2, scr->cols);
+	rows = MIN(gdk_screen_get_height(screen) / ch + 2, scr->rows);
+	if (!xs_get_image(xs, cols * cw, rows * ch))
+		return;
+	cols = xs->image->width / cw;
+	rows = xs->image->height / ch;
+
+	for (i = 0; i < XS_COLORS; i++)
+		xs->pixel[i] = xs_pixel(xs->gvis,
+				&scr->pal->color[vga_palette_text_regs[i]]);
+
+	for (row = row0; row < row1; row += rows)
+		for (col = col0; col < col1; col += cols)
+			xs_draw_tile(xs, widget, scr, zoom, area, col,
+					MIN(col + cols, col1), row,
+					MIN(row + rows, row1));
+}
+
+const VGABackend vga_xshm_backend =
+{
+	xs_new,
+	xs_destroy,
+	xs_draw
+};
+
+#else	/* GDK_WINDOWING_X11 */
+
+/* Nothing to set up; VGAText falls back to the GC fills */
+static gpointer
+xs_new(GtkWidget * widget)
+{
+	return NULL;
+}
+
+const VGABackend vga_xshm_backend =
+{
+	xs_new,
+	NULL,
+	NULL
+};
+
+#endif	/* GDK_WINDOWING_X11 */
@@ -0,0 +1,113 @@
+/*
+ * Round trip check for vgadiff: every dialect's diff between two random
+ * screens, parsed by libvga's own emulator on top of the first screen,
+ * must give the second.  Needs no display; run with "make check".
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "vgadiff.h"
+#include "emulation.h"
+
+#define ROWS	25
+#define COLS	80
+#define TRIALS	50
+
+static const char * dialect_name[] = { "ANSI", "Avatar", "TextFX" };
+
+/* A character every dialect sends as itself, now and then a blank */
+static guchar random_char(void)
+{
+	static const guchar blanks[] = { 0, ' ', 255 };
+	int c;
+
+	if (rand() % 4 == 0)
+		return blanks[rand() % 3];
+	do
+		c = 33 + rand() % 222;
+	while (c == 127 || c == 255);
+	return c;
+}
+
+static void random_cell(vga_charcell * cell)
+{
+	cell->c = random_char();
+	cell->attr = rand() % 256;
+}
+
+/* Cells as they look: blanks are all alike, whatever their foreground */
+static gboolean cell_looks_same(vga_charcell a, vga_charcell b)
+{
+	gboolean a_blank = a.c == 0 || a.c == ' ' || a.c == 255;
+	gboolean b_blank = b.c == 0 || b.c == ' ' || b.c == 255;
+
+	if (a_blank || b_blank)
+		return a_blank && b_blank && (a.attr & 0xF0) == (b.attr & 0xF0);
+	return a.c == b.c && a.attr == b.attr;
+}
+
+static gboolean check_dialect(VGADiffDialect dialect,
+		const vga_charcell * from, const vga_charcell * to, int trial)
+{
+	GByteArray * out;
+	VGAScreen * scr;
+	EmuData * emu;
+	int i;
+	gboolean ok = TRUE;
+
+	out = g_byte_array_new();
+	vga_diff_buffers(dialect, out, from, to, ROWS, COLS);
+
+	scr = vga_screen_new(ROWS, COLS);
+	memcpy(scr->video_buf, from, ROWS * COLS * sizeof(vga_charcell));
+	emu = vga_emu_new(scr);
+	vga_emu_write(emu, out->data, out->len);
+
+	/* The bottom right cell is never sent, see vgadiff.h */
+	for (i = 0; i < ROWS * COLS - 1; i++)
+		if (!cell_looks_same(scr->video_buf[i], to[i]))
+		{
+			printf("%s, trial %d: row %d col %d is %02x/%02x, "
+					"not %02x/%02x\n", dialect_name[dialect],
+					trial, i / COLS, i % COLS,
+					scr->video_buf[i].c,
+					scr->video_buf[i].attr,
+					to[i].c, to[i].attr);
+			ok = FALSE;
+			break;
+		}
+
+	vga_emu_destroy(emu);
+	vga_screen_destroy(scr);
+	g_byte_array_free(out, TRUE);
+
+	return ok;
+}
+
+int main(void)
+{
+	vga_charcell from[ROWS * COLS], to[ROWS * COLS];
+	int trial, i, d, failed = 0;
+
+	srand(1);
+	for (trial = 0; trial < TRIALS; trial++)
+	{
+		for (i = 0; i < ROWS * COLS; i++)
+			random_cell(&from[i]);
+
+		/* Change runs of cells, more of them each time */
+		memcpy(to, from, sizeof(to));
+		for (i = 0; i < ROWS * COLS; i++)
+			if (rand() % TRIALS < trial)
+				random_cell(&to[i]);
+
+		for (d = VGA_DIFF_ANSI; d <= VGA_DIFF_TEXTFX; d++)
+			if (!check_dialect(d, from, to, trial))
+				failed++;
+	}
+
+	printf("%s\n", failed ? "FAILED" : "OK");
+	return failed ? 1 : 0;
+}
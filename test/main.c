@@ -2,6 +2,8 @@
 #include <gdk/gdkkeysyms.h>
 #include <stdlib.h>
 #include <stdio.h>
+#include <fcntl.h>
+#include <unistd.h>
 
 #include "vgatext.h"
 #include "vgaterm.h"
@@ -136,31 +138,18 @@ void draw_test_pattern(GtkWidget * widget){
 
 void terminal_dump_file(gchar * fname)
 {
-	FILE * f;
-	guchar buf[4096];
-	int n, i, line_count;
+	int fd;
 
-	f = fopen(fname, "rb");
-	if (f == NULL)
+	fd = open(fname, O_RDONLY);
+	if (fd < 0)
 		return;
 
-	line_count = 0;
-	n = fread(buf, 1, 4096, f);
-	while (n > 0)
-	{
-	  for (i = 0; i < n; i++)
-	  {
-	    vga_term_emu_writec(vgaterm, buf[i]);
-	    if( (buf[i] == 10) && (buf[i-1] == 13))
-	    {
-	      line_count++;
-	    }
-	  }
-	  
-	  line_count = 0;
-	  n = fread(buf, 1, 4096, f);
-	}
-	fclose(f);
+	/* Parsed from the main loop in idle time; fails if a file is
+	 * already being shown */
+	if (!vga_term_emu_attach_fd_full(vgaterm, fd,
+			VGA_EMU_FD_MMAP | VGA_EMU_FD_CLOSE |
+				VGA_EMU_FD_SAUCE, NULL, NULL))
+		close(fd);
 }
 
 void process_input_key(GdkEventKey * event)
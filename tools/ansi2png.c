@@ -0,0 +1,369 @@
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of version 2 of the GNU General Public License as
+ *  published by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ *****************************************************************************
+ *
+ *  ansi2png: render ANSI, iCE and TextFX files to PNG images without a
+ *  display.
+ *
+ *	ansi2png [OPTION...] [FILE...]
+ *
+ *  Files are read from the command line, or one per line from standard
+ *  input if there are none.  Each worker thread keeps its own screen,
+ *  emulator and raster for all the files it renders, and only ever holds
+ *  one text row of pixels, so memory use depends on the options and the
+ *  number of jobs, never on the number of files.
+ *
+ *  With a font pack, the fonts SAUCE records name are taken from it.  All
+ *  the workers share them, and their data stays in the pack's mapping.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "vgascreen.h"
+#include "vgaraster.h"
+#include "vgasauce.h"
+#include "emulation.h"
+
+#define DEFAULT_COLS	80
+
+typedef struct
+{
+	VGAScreen * scr;
+	EmuData * emu;
+	VGARaster * raster;
+	guint font_serial;	/* What a clean screen has */
+	guint pal_serial;
+	GThread * thread;
+} Worker;
+
+static gchar * opt_font = NULL;
+static gchar * opt_pack = NULL;
+static gchar * opt_outdir = NULL;
+static gint opt_cols = 0;
+static gint opt_rows = 1000;
+static gint opt_scale = 1;
+static gint opt_jobs = 0;
+static gboolean opt_ice = FALSE;
+
+static GOptionEntry entries[] =
+{
+	{ "font", 'f', 0, G_OPTION_ARG_FILENAME, &opt_font,
+		"Raw VGA font, or font in the pack, to use instead of the "
+		"default", "FILE" },
+	{ "font-pack", 'p', 0, G_OPTION_ARG_FILENAME, &opt_pack,
+		"Font pack to find the fonts SAUCE records name in", "FILE" },
+	{ "cols", 'c', 0, G_OPTION_ARG_INT, &opt_cols,
+		"Screen width in characters (from SAUCE, or 80)", "N" },
+	{ "rows", 'r', 0, G_OPTION_ARG_INT, &opt_rows,
+		"Height in characters, unless SAUCE says more (1000)", "N" },
+	{ "scale", 's', 0, G_OPTION_ARG_INT, &opt_scale,
+		"Pixel size, 1 to 8 (1)", "N" },
+	{ "output", 'o', 0, G_OPTION_ARG_FILENAME, &opt_outdir,
+		"Directory for the images, instead of next to each file",
+		"DIR" },
+	{ "jobs", 'j', 0, G_OPTION_ARG_INT, &opt_jobs,
+		"Number of files to render at once (one per CPU)", "N" },
+	{ "ice", 'i', 0, G_OPTION_ARG_NONE, &opt_ice,
+		"Use iCE colors for every file, not just .ICE files", NULL },
+	{ NULL }
+};
+
+static GPtrArray * files;
+static gint next_file = 0;
+static gint failures = 0;
+static VGAFont * font;
+static VGAFontPack * pack;
+
+static gchar *
+output_name(const gchar * fname)
+{
+	gchar * base, * dot, * name;
+
+	if (opt_outdir)
+	{
+		base = g_path_get_basename(fname);
+		dot = strrchr(base, '.');
+		if (dot)
+			*dot = '\0';
+		name = g_strdup_printf("%s/%s.png", opt_outdir, base);
+	}
+	else
+	{
+		base = g_strdup(fname);
+		dot = strrchr(base, '.');
+		if (dot && strchr(dot, '/') == NULL)
+			*dot = '\0';
+		name = g_strdup_printf("%s.png", base);
+	}
+
+	g_free(base);
+	return name;
+}
+
+/* Rows down to the last one with anything visible on it */
+static int
+used_rows(VGAScreen * scr)
+{
+	vga_charcell * cell;
+	int row, x;
+
+	for (row = scr->rows - 1; row > 0; row--)
+	{
+		cell = &scr->video_buf[row * scr->cols];
+		for (x = 0; x < scr->cols; x++, cell++)
+			if ((cell->c != ' ' && cell->c != '\0') ||
+				GETBG(cell->attr) != BLACK)
+				return row + 1;
+	}
+	return 1;
+}
+
+/* Put the screen and emulator back the way they were at the start */
+static void
+worker_reset(Worker * w, const gchar * fname)
+{
+	VGAScreen * scr = w->scr;
+	gchar * lower;
+
+	if (scr->font_serial != w->font_serial)
+	{
+		vga_screen_set_font(scr, font);
+		w->font_serial = scr->font_serial;
+	}
+	if (scr->pal_serial != w->pal_serial)
+	{
+		vga_palette_load_default(scr->pal);
+		vga_screen_palette_changed(scr);
+		w->pal_serial = scr->pal_serial;
+	}
+
+	vga_screen_resize(scr, opt_rows, opt_cols ? opt_cols : DEFAULT_COLS);
+	vga_screen_window(scr, 1, 1, scr->cols, scr->rows);
+	vga_screen_set_attr(scr, ATTR(GREY, BLACK));
+	vga_screen_clrscr(scr);
+	vga_emu_reset(w->emu);
+
+	lower = g_ascii_strdown(fname, -1);
+	vga_screen_set_icecolor(scr, opt_ice || g_str_has_suffix(lower, ".ice"));
+	g_free(lower);
+}
+
+static gboolean
+render_file(Worker * w, const gchar * fname)
+{
+	GMappedFile * map;
+	GError * error = NULL;
+	VGASauce sauce;
+	const guchar * data;
+	gsize len;
+	gchar * out;
+	gboolean ok;
+
+	map = g_mapped_file_new(fname, FALSE, &error);
+	if (map == NULL)
+	{
+		g_printerr("%s\n", error->message);
+		g_error_free(error);
+		return FALSE;
+	}
+
+	worker_reset(w, fname);
+	data = (const guchar *) g_mapped_file_get_contents(map);
+	len = g_mapped_file_get_length(map);
+
+	/* Size the screen before parsing, so it never has to change */
+	if (vga_sauce_parse(data, len, &sauce))
+	{
+		if (opt_cols)
+			sauce.cols = 0;
+		vga_sauce_apply_screen(&sauce, w->scr, pack);
+		if (opt_ice)
+			vga_screen_set_icecolor(w->scr, TRUE);
+	}
+
+	vga_emu_write(w->emu, data, vga_sauce_content_length(data, len));
+	g_mapped_file_free(map);
+
+	out = output_name(fname);
+	ok = vga_raster_save_png(w->raster, w->scr, used_rows(w->scr), out,
+			&error);
+	if (!ok)
+	{
+		g_printerr("%s\n", error->message);
+		g_error_free(error);
+	}
+	g_free(out);
+
+	return ok;
+}
+
+static gpointer
+worker_main(gpointer data)
+{
+	Worker * w = data;
+	guint i;
+
+	while ((i = g_atomic_int_exchange_and_add(&next_file, 1)) <
+			files->len)
+	{
+		if (!render_file(w, g_ptr_array_index(files, i)))
+			g_atomic_int_inc(&failures);
+	}
+
+	return NULL;
+}
+
+/* Everything is created here, on the main thread, before any worker runs */
+static Worker *
+worker_new(void)
+{
+	Worker * w;
+
+	w = g_new0(Worker, 1);
+	w->scr = vga_screen_new(opt_rows, opt_cols ? opt_cols : DEFAULT_COLS);
+	vga_screen_set_font(w->scr, font);
+	w->font_serial = w->scr->font_serial;
+	w->pal_serial = w->scr->pal_serial;
+
+	w->emu = vga_emu_new(w->scr);
+	w->raster = vga_raster_new();
+	vga_raster_set_scale(w->raster, opt_scale);
+
+	return w;
+}
+
+static void
+worker_destroy(Worker * w)
+{
+	vga_raster_destroy(w->raster);
+	vga_emu_destroy(w->emu);
+	vga_screen_destroy(w->scr);
+	g_free(w);
+}
+
+static void
+read_file_list(FILE * f)
+{
+	gchar line[4096];
+	gsize len;
+
+	while (fgets(line, sizeof(line), f))
+	{
+		len = strlen(line);
+		while (len > 0 && (line[len - 1] == '\n' || line[len - 1] == '\r'))
+			line[--len] = '\0';
+		if (len > 0)
+			g_ptr_array_add(files, g_strdup(line));
+	}
+}
+
+int
+main(int argc, char * argv[])
+{
+	GOptionContext * context;
+	GError * error = NULL;
+	Worker ** workers;
+	int i;
+
+	context = g_option_context_new("[FILE...] - render ANSI art to PNG");
+	g_option_context_add_main_entries(context, entries, NULL);
+	if (!g_option_context_parse(context, &argc, &argv, &error))
+	{
+		g_printerr("%s\n", error->message);
+		return 2;
+	}
+	g_option_context_free(context);
+
+	if (opt_cols < 0 || opt_rows < 1 || opt_scale < 1 || opt_scale > 8)
+	{
+		g_printerr("Bad screen size or scale\n");
+		return 2;
+	}
+
+	if (opt_pack)
+	{
+		pack = vga_font_pack_open(opt_pack, &error);
+		if (pack == NULL)
+		{
+			g_printerr("%s\n", error->message);
+			return 2;
+		}
+	}
+
+	/* Every worker's screen shares this one */
+	if (opt_font == NULL)
+		font = vga_font_stock(FONT_DEFAULT);
+	else if (pack && vga_font_pack_lookup(pack, opt_font))
+		font = vga_font_pack_lookup(pack, opt_font);
+	else
+	{
+		font = vga_font_new();
+		if (!g_file_test(opt_font, G_FILE_TEST_IS_REGULAR) ||
+			!vga_font_load_from_file(font, opt_font))
+		{
+			g_printerr("Unable to load font %s\n", opt_font);
+			return 2;
+		}
+	}
+
+	files = g_ptr_array_new();
+	for (i = 1; i < argc; i++)
+		g_ptr_array_add(files, g_strdup(argv[i]));
+	if (files->len == 0)
+		read_file_list(stdin);
+
+	if (opt_jobs <= 0)
+		opt_jobs = MAX(sysconf(_SC_NPROCESSORS_ONLN), 1);
+	opt_jobs = MIN(opt_jobs, MAX(files->len, 1));
+
+	if (!g_thread_supported())
+		g_thread_init(NULL);
+
+	/* The stock palettes are created on first use, which isn't safe to
+	 * do from more than one worker at once */
+	for (i = PAL_DEFAULT; i <= PAL_GREYSCALE; i++)
+		vga_palette_stock(i);
+
+	workers = g_new(Worker *, opt_jobs);
+	for (i = 0; i < opt_jobs; i++)
+		workers[i] = worker_new();
+
+	/* The main thread works too */
+	for (i = 1; i < opt_jobs; i++)
+	{
+		workers[i]->thread = g_thread_create(worker_main, workers[i],
+				TRUE, &error);
+		if (workers[i]->thread == NULL)
+		{
+			g_printerr("Unable to start worker: %s\n",
+					error->message);
+			g_clear_error(&error);
+		}
+	}
+	worker_main(workers[0]);
+
+	for (i = 0; i < opt_jobs; i++)
+	{
+		if (workers[i]->thread)
+			g_thread_join(workers[i]->thread);
+		worker_destroy(workers[i]);
+	}
+	g_free(workers);
+
+	return failures ? 1 : 0;
+}
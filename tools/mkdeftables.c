@@ -0,0 +1,220 @@
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of version 2 of the GNU General Public License as
+ *  published by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ *****************************************************************************
+ *
+ *  mkdeftables: write the built-in font and palette, and the tables used to
+ *  convert others, in the forms the library renders from, so that none of
+ *  it is converted at run time.
+ *
+ *	mkdeftables font > src/def_font_tables.h
+ *	mkdeftables palette > src/def_palette_tables.h
+ *
+ *  This runs on the build machine, so it uses plain C and no GLib.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+#include "def_font.h"
+#include "def_palette.h"
+
+#define MAX_VALUES	(4096 * 8)	/* The 8x16 font's coverage mask */
+
+static unsigned values[MAX_VALUES];
+
+static void
+put_header(const char * guard, const char * from)
+{
+	printf("/* Generated by tools/mkdeftables from %s -- do not edit */\n\n",
+			from);
+	printf("#ifndef %s\n#define %s\n\n", guard, guard);
+}
+
+/* Start a table; @decl is everything before the " = {" */
+static void
+put_begin(const char * decl)
+{
+	printf("%s =\n{", decl);
+}
+
+/* Write @n of values[], @per_line to a line */
+static void
+put_values(int n, int per_line, const char * fmt)
+{
+	int i;
+
+	for (i = 0; i < n; i++)
+	{
+		if (i % per_line == 0)
+			printf("\n\t");
+		else
+			printf(" ");
+		printf(fmt, values[i]);
+		if (i < n - 1)
+			printf(",");
+	}
+}
+
+static void
+put_end(void)
+{
+	printf("\n};\n\n");
+}
+
+static unsigned
+mirror(unsigned b)
+{
+	unsigned m = 0;
+	int i;
+
+	for (i = 0; i < 8; i++)
+		if (b & (1 << i))
+			m |= 0x80 >> i;
+	return m;
+}
+
+/* The mirrored rows and coverage mask of a built-in font */
+static void
+put_font(const char * name, const unsigned char * data, int size)
+{
+	char decl[128];
+	int i, j;
+
+	for (i = 0; i < size; i++)
+		values[i] = mirror(data[i]);
+	snprintf(decl, sizeof(decl),
+			"static const unsigned char %s_xbm[%d]", name, size);
+	put_begin(decl);
+	put_values(size, 12, "0x%02x");
+	put_end();
+
+	for (i = 0; i < size; i++)
+		for (j = 0; j < 8; j++)
+			values[i * 8 + j] = (data[i] & (0x80 >> j)) ? 0xFF : 0;
+	snprintf(decl, sizeof(decl),
+			"static const unsigned char %s_coverage[%d]",
+			name, size * 8);
+	put_begin(decl);
+	put_values(size * 8, 8, "0x%02x");
+	put_end();
+}
+
+static void
+write_font(void)
+{
+	int i, j;
+
+	put_header("__DEF_FONT_TABLES_H__", "def_font.h");
+
+	printf("/* Every byte with its bits mirrored, for XBM */\n");
+	for (i = 0; i < 256; i++)
+		values[i] = mirror(i);
+	put_begin("static const unsigned char bit_mirror[256]");
+	put_values(256, 12, "0x%02x");
+	put_end();
+
+	/* Defined here, declared in vgafont.h; only vgafont.c includes this */
+	printf("/* Each row byte of a glyph as 8 coverage bytes */\n");
+	put_begin("const unsigned char vga_font_row_expand[256][8]");
+	for (i = 0; i < 256; i++)
+	{
+		printf("\n\t{ ");
+		for (j = 0; j < 8; j++)
+			printf("0x%02x%s", (i & (0x80 >> j)) ? 0xFF : 0,
+					j < 7 ? ", " : " ");
+		printf("}%s", i < 255 ? "," : "");
+	}
+	put_end();
+
+	printf("/* The built-in fonts, ready to render */\n");
+	put_font("default_font", default_font, sizeof(default_font));
+	put_font("default_font_8x8", default_font_8x8,
+			sizeof(default_font_8x8));
+
+	printf("#endif\n");
+}
+
+/* What TO_GDK_RGB() gives for a 6-bit level */
+static unsigned
+to_gdk(unsigned level)
+{
+	return (unsigned) floor(level * 1040.23809 + 0.5);
+}
+
+/* A 6-bit level scaled to 0-255, rounded */
+static unsigned
+to_rgb(unsigned level)
+{
+	return (level * 255 + 31) / 63;
+}
+
+static void
+write_palette(void)
+{
+	int i, n = sizeof(default_palette);
+
+	put_header("__DEF_PALETTE_TABLES_H__", "def_palette.h");
+
+	printf("/* TO_GDK_RGB() of each 6-bit level */\n");
+	for (i = 0; i < 64; i++)
+		values[i] = to_gdk(i);
+	put_begin("static const guint16 gdk_levels[64]");
+	put_values(64, 8, "%5u");
+	put_end();
+
+	printf("/* Each 6-bit level scaled to 0-255, rounded */\n");
+	for (i = 0; i < 64; i++)
+		values[i] = to_rgb(i);
+	put_begin("static const guchar rgb_levels[64]");
+	put_values(64, 8, "%3u");
+	put_end();
+
+	printf("#define DEFAULT_PALETTE_REGS\t%d\n\n", n / 3);
+
+	printf("/* The default palette, ready to copy into a VGAPalette */\n");
+	put_begin("static const GdkColor default_palette_color[]");
+	for (i = 0; i < n; i += 3)
+		printf("\n\t{ 0x%08x, %5u, %5u, %5u }%s", 0xFFFFFFFFu,
+			to_gdk(default_palette[i] & 0x3F),
+			to_gdk(default_palette[i + 1] & 0x3F),
+			to_gdk(default_palette[i + 2] & 0x3F),
+			i < n - 3 ? "," : "");
+	put_end();
+
+	for (i = 0; i < n; i++)
+		values[i] = to_rgb(default_palette[i] & 0x3F);
+	put_begin("static const guchar default_palette_rgb[]");
+	put_values(n, 12, "0x%02x");
+	put_end();
+
+	printf("#endif\n");
+}
+
+int
+main(int argc, char ** argv)
+{
+	if (argc == 2 && strcmp(argv[1], "font") == 0)
+		write_font();
+	else if (argc == 2 && strcmp(argv[1], "palette") == 0)
+		write_palette();
+	else
+	{
+		fprintf(stderr, "usage: %s font|palette\n", argv[0]);
+		return 2;
+	}
+
+	return ferror(stdout) ? 1 : 0;
+}
@@ -0,0 +1,75 @@
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of version 2 of the GNU General Public License as
+ *  published by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ *****************************************************************************
+ *
+ *  mkfontpack: put raw VGA font files in a font pack (see vgafontpack.h).
+ *
+ *	mkfontpack PACK NAME=FILE...
+ *
+ *  Each font is called NAME in the pack; use the names SAUCE records give
+ *  fonts, e.g. "IBM VGA" or "Amiga Topaz 1", for ansi2png --font-pack to
+ *  find them.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "vgafontpack.h"
+
+int
+main(int argc, char ** argv)
+{
+	GError * error = NULL;
+	gchar ** names;
+	VGAFont ** fonts;
+	gchar * eq;
+	int i, n;
+
+	if (argc < 3)
+	{
+		g_printerr("usage: %s PACK NAME=FILE...\n", argv[0]);
+		return 2;
+	}
+
+	n = argc - 2;
+	names = g_new(gchar *, n);
+	fonts = g_new(VGAFont *, n);
+	for (i = 0; i < n; i++)
+	{
+		eq = strchr(argv[i + 2], '=');
+		if (eq == NULL || eq == argv[i + 2])
+		{
+			g_printerr("Expected NAME=FILE, not %s\n", argv[i + 2]);
+			return 2;
+		}
+		names[i] = g_strndup(argv[i + 2], eq - argv[i + 2]);
+
+		fonts[i] = vga_font_new();
+		if (!vga_font_load_from_file(fonts[i], eq + 1))
+		{
+			g_printerr("Unable to load font %s\n", eq + 1);
+			return 1;
+		}
+	}
+
+	if (!vga_font_pack_write(argv[1], (const gchar * const *) names,
+				fonts, n, &error))
+	{
+		g_printerr("%s\n", error->message);
+		return 1;
+	}
+
+	return 0;
+}